@@ -0,0 +1,300 @@
+#include "App.h"
+#include "Society.h"
+#include "Simulation.h"
+#include "Trust.h"
+#include "Distribution.h"
+#include "StatisticsBlock.h"
+#include "Files.h"
+#include "Random.h"
+#include <FL/filename.H>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// laputa-bench - times the functions the program spends the most time in, without opening any windows, and writes
+// the results as JSON, so that builds and changes can be compared over time. Each piece of code is run until it has
+// taken at least the minimum time, in batches that double in size, and the time per call is reported.
+//
+//   laputa-bench [-data directory] [-time seconds] [-max inquirers] [-only name] [-o file.json]
+
+using namespace std;
+using namespace std::chrono;
+
+// how long to run each benchmark, in seconds, and the largest society by default
+#define BENCH_MIN_TIME 0.5
+#define BENCH_DEFAULT_MAX_INQUIRERS 10000
+
+// link keys hold the index of an inquirer in 16 bits, so societies can't be larger than this
+#define BENCH_LIMIT_INQUIRERS 65535
+
+// links to each inquirer in the societies that are run
+#define BENCH_LINKS_PER_INQUIRER 4
+
+// largest society generated from a setup - generation takes time proportional to the square of the population
+#define BENCH_MAX_GENERATED 10000
+
+// BenchResult - how long one benchmark took
+
+class BenchResult {
+public:
+	string name;
+	t_int size;
+	long long calls;
+	double seconds;
+
+	// things done in each call, e.g. inquirers in a step of a society
+	t_int items;
+};
+
+static vector<BenchResult> results;
+static double minTime = BENCH_MIN_TIME;
+static string only;
+
+// keeps results from being optimised away
+static volatile double sink;
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+template<class F> static void Measure(const string& name, t_int size, t_int items, F f) {
+	if(only != "" && name.find(only) == string::npos) return;
+
+	// once to warm up, then in batches until the time is up
+	f();
+	long long calls = 0, batch = 1;
+	double t = 0;
+	steady_clock::time_point start = steady_clock::now();
+	while(t < minTime) {
+		for(long long i = 0; i < batch; ++i) f();
+		calls += batch;
+		t = duration<double>(steady_clock::now() - start).count();
+		if(batch < (1 << 20)) batch *= 2;
+	}
+
+	BenchResult r;
+	r.name = name;
+	r.size = size;
+	r.calls = calls;
+	r.seconds = t;
+	r.items = items;
+	results.push_back(r);
+	fprintf(stderr, "%-40s %8d %14.1f ns\n", name.c_str(), size, t * 1e9 / (double)calls);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+// society of n inquirers, each listening to a few others picked at random - made directly rather than from a setup,
+// so that large societies don't take long to make
+static Society* MakeSociety(SocietySetup* setup, t_int n) {
+	Society* soc = new Society;
+	soc->people.reserve(n);
+	for(t_int i = 0; i < n; ++i) soc->people.push_back(Inquirer(100, 100, setup));
+	for(t_int i = 0; i < n; ++i) {
+		for(t_int k = 0; k < BENCH_LINKS_PER_INQUIRER && k < n - 1; ++k) {
+			t_int j = gsl_rng_uniform_int(rng, n - 1);
+			soc->addLink(j < i ? j : j + 1, i, setup);
+		}
+	}
+	return soc;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+static void BenchTrust(void) {
+	TrustFunction tf;
+	tf.setFromPreset(TF_AVERAGE);
+	Measure("TrustFunction::expectation", 0, 1, [&]() {
+		tf.expValid = false;
+		sink += tf.expectation();
+	});
+	bool pTrue = false;
+	Measure("TrustFunction::update", 0, 1, [&]() {
+		tf.update(0.7, pTrue = !pTrue);
+	});
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+static void BenchSocieties(SocietySetup* setup, t_int maxInquirers) {
+	// powers of ten, and the largest size asked for
+	vector<t_int> sizes;
+	for(t_int n = 100; n <= maxInquirers; n *= 10) sizes.push_back(n);
+	if(sizes.empty() || sizes.back() != maxInquirers) sizes.push_back(maxInquirers);
+
+	for(t_int m = 0; m < sizes.size(); ++m) {
+		// run the society the way a batch does, on this thread
+		t_int n = sizes[m];
+		Society* soc = MakeSociety(setup, n);
+		curSociety = soc;
+		Simulation sim;
+		sim.reset();
+
+		t_int i = 0;
+		Measure("Inquirer::doInquiry", n, 1, [&]() {
+			soc->people[i].doInquiry(&sim, soc, i);
+			soc->people[i].belief = soc->people[i].newBelief;
+			if(++i == n) i = 0;
+		});
+		Measure("Society::evolve", n, n, [&]() {
+			soc->evolve(&sim);
+			++sim.curStep;
+		});
+		delete soc;
+		curSociety = 0;
+	}
+
+	// generation picks the source of each link by going through every inquirer
+	SocietySetup gen = *setup;
+	gen.linkDistributionMethod = LDM_PER_INQUIRER | LDM_TO_NUMBER_BIT;
+	gen.linkDensityDistribution.min = gen.linkDensityDistribution.max = BENCH_LINKS_PER_INQUIRER;
+	for(t_int n = 100; n <= maxInquirers && n <= BENCH_MAX_GENERATED; n *= 10) {
+		gen.populationDistribution.min = gen.populationDistribution.max = n;
+		Measure("Society::generateFromSetup", n, n, [&]() {
+			Society soc;
+			soc.generateFromSetup(&gen);
+			sink += soc.links.size();
+		});
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+static void BenchDistributions(void) {
+	const char* names[N_DISTRIBUTION_TYPES] = {"point", "interval", "normal", "beta", "freeform"};
+	for(t_int t = 0; t < N_DISTRIBUTION_TYPES; ++t) {
+		Distribution d;
+		for(t_int i = 0; i < N_DISTRIBUTION_TYPES; ++i) d.weights[i] = i == t ? 1.0 : 0;
+		Measure(string("Distribution::getRandomValue/") + names[t], 0, 1, [&]() {
+			sink += d.getRandomValue();
+		});
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+static void BenchStatistics(void) {
+	// inquirers x time x trials, as e-values are kept over time
+	const t_int w = 100, h = 100, d = 100;
+	StatisticsBlock b(w, h, d);
+	for(t_int k = 0; k < d; ++k) for(t_int j = 0; j < h; ++j) for(t_int i = 0; i < w; ++i) b.v(i, j, k) = gsl_rng_uniform(rng);
+	for(t_int dim = DIM_X; dim <= DIM_Z; ++dim) {
+		Measure(string("StatisticsBlock::average/") + (char)('x' + dim), w * h * d, w * h * d, [&]() {
+			StatisticsBlock a = b.average(dim);
+			sink += a.width;
+		});
+	}
+	Measure("StatisticsBlock::permute", w * h * d, w * h * d, [&]() {
+		StatisticsBlock p = b.permute(DIM_Z, DIM_X, DIM_Y);
+		sink += p.width;
+	});
+
+	// sorting leaves the block sorted, so it is filled again each time, which is timed too
+	const t_int n = w * h * d;
+	StatisticsBlock s;
+	s.allocate(n);
+	vector<float> values(n);
+	for(t_int i = 0; i < n; ++i) values[i] = gsl_rng_uniform(rng);
+	Measure("StatisticsBlock::xSort", n, n, [&]() {
+		for(t_int i = 0; i < n; ++i) s.v(i) = values[i];
+		s.xSort(0, n);
+		sink += s.v(0);
+	});
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+static void BenchSpreadsheet(void) {
+	// a table like a multibatch writes, with the content made & zipped the way it is when saved
+	const t_int w = 20, h = 1000, d = 2;
+	vector<XMLData> data(w * h * d);
+	string sheetNames[d] = {"E-value", "Polarisation"};
+	for(t_int i = 0; i < w * h * d; ++i) {
+		if(i % w == 0) data[i].setString("Batch description");
+		else data[i].setDouble(gsl_rng_uniform(rng));
+	}
+	Measure("SaveDataAsSpreadsheet", w * h * d, w * h * d, [&]() {
+		zipFile f = zipOpen("laputa-bench.ods", APPEND_STATUS_CREATE);
+		if(MakeContentFile(data.data(), w, h, d, sheetNames, "")) AddFileToZipArchive("content.xml", "content.xml", f, true);
+		zipClose(f, NULL);
+	});
+	remove("laputa-bench.ods");
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+static void WriteResults(FILE* f) {
+	fprintf(f, "{\n");
+	fprintf(f, "  \"version\": %d,\n", LAPUTA_VERSION);
+#ifdef __AVX__
+	fprintf(f, "  \"avx\": true,\n");
+#else
+	fprintf(f, "  \"avx\": false,\n");
+#endif
+#ifdef USE_DOUBLE_FLOAT
+	fprintf(f, "  \"double\": true,\n");
+#else
+	fprintf(f, "  \"double\": false,\n");
+#endif
+	fprintf(f, "  \"min_time\": %g,\n", minTime);
+	fprintf(f, "  \"results\": [\n");
+	for(t_int i = 0; i < results.size(); ++i) {
+		const BenchResult& r = results[i];
+		double ns = r.seconds * 1e9 / (double)r.calls;
+		fprintf(f, "    {\"name\": \"%s\", \"size\": %d, \"calls\": %lld, \"seconds\": %.6f, \"ns_per_call\": %.3f, \"ns_per_item\": %.3f}%s\n",
+			r.name.c_str(), r.size, r.calls, r.seconds, ns, ns / (double)(r.items > 0 ? r.items : 1), i + 1 < results.size() ? "," : "");
+	}
+	fprintf(f, "  ]\n");
+	fprintf(f, "}\n");
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char* argv[]) {
+	string dataPath = "data/", outFile;
+	t_int maxInquirers = BENCH_DEFAULT_MAX_INQUIRERS;
+	for(t_int i = 1; i < argc; ++i) {
+		if(!strcmp(argv[i], "-data") && i + 1 < argc) dataPath = string(argv[++i]) + "/";
+		else if(!strcmp(argv[i], "-time") && i + 1 < argc) minTime = atof(argv[++i]);
+		else if(!strcmp(argv[i], "-max") && i + 1 < argc) maxInquirers = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-only") && i + 1 < argc) only = argv[++i];
+		else if(!strcmp(argv[i], "-o") && i + 1 < argc) outFile = argv[++i];
+		else {
+			fprintf(stderr, "usage: laputa-bench [-data directory] [-time seconds] [-max inquirers] [-only name] [-o file.json]\n");
+			return 1;
+		}
+	}
+	if(maxInquirers > BENCH_LIMIT_INQUIRERS) {
+		fprintf(stderr, "Societies can have at most %d inquirers.\n", BENCH_LIMIT_INQUIRERS);
+		maxInquirers = BENCH_LIMIT_INQUIRERS;
+	}
+
+	// the same start as the program, with dice that roll the same way every time
+	string distrPath = dataPath + "distributions/";
+	if(!fl_filename_isdir(distrPath.c_str())) {
+		fprintf(stderr, "Cannot find the data directory %s.\n", dataPath.c_str());
+		return 1;
+	}
+	LoadDefaultDistributions(distrPath.c_str());
+	UseRandomGenerator(RANDOM_GENERATOR_XOSHIRO);
+	SeedRandomStream(rng, 1, 0);
+	SocietySetup setup;
+	setup.setDefault();
+
+	BenchTrust();
+	BenchDistributions();
+	BenchSocieties(&setup, maxInquirers);
+	BenchStatistics();
+	BenchSpreadsheet();
+
+	// results
+	FILE* f = outFile == "" ? stdout : fopen(outFile.c_str(), "w");
+	if(!f) {
+		fprintf(stderr, "Could not write to file %s.\n", outFile.c_str());
+		return 1;
+	}
+	WriteResults(f);
+	if(f != stdout) fclose(f);
+	return 0;
+}
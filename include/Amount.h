@@ -3,6 +3,7 @@
 
 #include "Prefix.h"
 #include <assert.h>
+#include <math.h>
 
 #define amt_type double
 
@@ -55,6 +56,23 @@ public:
 		return v;
 	}
 
+	// exactly 0 or 1? No evidence can move such a value.
+	inline bool certain(void) const {
+		return value == 0 || inverse == 0;
+	}
+
+	// log-odds form, log(value / (1 - value)). Certainty gives +/- infinity.
+	inline amt_type logOdds(void) const {
+		return log(value) - log(inverse);
+	}
+
+	static inline Amount fromLogOdds(amt_type l) {
+		Amount amt;
+		amt.value = 1.0 / (1.0 + exp(-l));
+		amt.inverse = 1.0 / (1.0 + exp(l));
+		return amt;
+	}
+
 	// operators
 	inline Amount operator+=(const Amount val) {
 		value += val.value;
@@ -4,6 +4,7 @@
 
 #include "Prefix.h"
 #include "MultiBatch.h"
+#include "Sweep.h"
 #include <assert.h>
 
 
@@ -19,6 +20,7 @@
 #include <stdio.h>
 #include <string>
 #include "Files.h"
+#include "UndoJournal.h"
 
 using namespace std;
 
@@ -35,9 +37,6 @@ using namespace std;
 #define SELECT_INTERNAL_LINKS 2
 #define SELECT_EXTERNAL_LINKS 4
 
-// undo
-#define MAX_UNDOS 32
-
 //-----------------------------------------------------------------------------------------------------------------------
 
 class UserInterface;
@@ -95,6 +94,10 @@ public:
 	void saveSociety(void);
 	void saveSocietyAs(void);
 	void exportStatistics(void);
+	bool openSweep(void);
+	void runSweep(void);
+	void shardSweep(void);
+	void resumeRun(void);
 	void quit(void);
 	void touchFile(void);
 	void saveSocietyToFile(const char* filename);
@@ -129,13 +132,13 @@ public:
 	Simulation curSimulation;
 	BatchSimulation curBatchSimulation;
 	MultiBatch curMultiBatch;
+	Sweep *curSweep = nullptr;
 
 	// clipboard
 	SocietyFragment* clipboard;
 
 	// Undo/Redo list
-  vector<Society*> undos;
-	t_int curUndoIndex;
+	UndoJournal undos;
 };
 
 
@@ -143,7 +146,9 @@ public:
 
 // global variables
 extern App *app;
-extern gsl_rng *rng;
+
+// dice - each thread has its own, so batches run on worker threads roll their own
+extern thread_local gsl_rng *rng;
 
 
 
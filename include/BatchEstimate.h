@@ -0,0 +1,69 @@
+#ifndef __BATCHESTIMATE_H__
+#define __BATCHESTIMATE_H__
+
+#include "Prefix.h"
+#include "BatchSimulation.h"
+#include "MultiBatch.h"
+#include <string>
+
+using namespace std;
+
+// seconds of trials run to time a batch or multibatch before it is started
+#define ESTIMATE_CALIBRATION_TIME 1.0
+
+// part of the computer's memory a batch may take, and the memory assumed if that can't be told
+#define ESTIMATE_MEMORY_FRACTION 0.5
+#define ESTIMATE_DEFAULT_MEMORY (4LL << 30)
+
+// largest that can be asked for in the record tab, for e-values every so many societies & time steps
+#define ESTIMATE_MAX_RECORD_INTERVAL 1000
+
+// BatchEstimate - how much memory a batch or multibatch will need, and how long it will take, worked out before it is
+// started. Memory is counted for the e-values kept over time (maxInquirers x time steps / timePerEValueStat x trials /
+// societiesPerEValueStat floats), the recorded topologies and the societies alive at once. Time is found by running
+// trials of the actual setup for a short while, in a society & with dice of their own, and scaling up. If the e-values
+// don't fit the budget, recording them less often is suggested.
+
+class BatchEstimate {
+public:
+	BatchEstimate();
+
+	// estimate a batch, run on its own, with results shown if showResults is set - trials are run for up to
+	// calibrationTime seconds to time it, or not at all if it is 0
+	void estimate(const BatchSimulation& bs, bool showResults, double calibrationTime);
+
+	// estimate a multibatch, run on all cores, from trials of batches at its corners & centre
+	void estimate(MultiBatch& mb, double calibrationTime);
+
+	// bytes needed, & the most the batch should take
+	long long eValueBytes, topologyBytes, societyBytes, budget;
+	long long totalBytes(void) const { return eValueBytes + topologyBytes + societyBytes; }
+	bool fits(void) const { return totalBytes() <= budget; }
+
+	// seconds for the whole run, at least & at most if the number of trials is adaptive, or -1 if not timed, and the
+	// trials (and parts of trials) that were timed
+	double minSeconds, seconds;
+	double calibrationTrials;
+
+	// recording of e-values that fits the budget, if it needs changing - with 0 for both, they can't be recorded
+	bool suggestion;
+	t_int suggestedTimePerEValue, suggestedSocietiesPerEValue;
+	void applySuggestion(BatchSimulation& bs) const;
+
+	// all of it as text to show
+	string describe(void) const;
+
+private:
+	// time trials of a batch with this template society, returning seconds per trial, or -1 if none were run, and the
+	// largest society seen
+	double calibrate(const BatchSimulation& bs, const Society& templateSociety, double calibrationTime, t_int& maxPeople, t_int& maxLinks);
+
+	// memory for a society of this size
+	static long long bytesPerSociety(t_int people, t_int links);
+
+	bool multibatch;
+	t_int nThreads, nPoints, nTrials;
+};
+
+
+#endif
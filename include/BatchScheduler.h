@@ -0,0 +1,86 @@
+#ifndef __BATCHSCHEDULER_H__
+#define __BATCHSCHEDULER_H__
+
+#include "Prefix.h"
+#include "BatchSimulation.h"
+#include <vector>
+#include <map>
+#include <functional>
+#include <thread>
+#include <mutex>
+
+using namespace std;
+
+// trials in each piece of work - the same as the blocks of adaptive batches, so that pieces end where they may stop
+#define BATCH_SCHEDULER_PIECE ADAPTIVE_TRIAL_BLOCK
+
+// BatchScheduler - runs the batches of a multibatch on all cores. Batches are made when they are needed and split into
+// pieces of trials, and a thread that runs out of work takes the next piece of the earliest batch that has any left,
+// so threads move on to later batches while the last pieces of one are still running. Every trial rolls the dice of
+// its own stream, so results don't depend on which thread ran it, and pieces are added up in order, so an adaptive
+// batch stops after the same trials as when it is run on its own. Pieces that turn out to be past where an adaptive
+// batch stopped are thrown away.
+//
+// Batches are run on worker threads, each with its own dice & current society, and nothing is shown from them. The
+// main thread picks up finished batches with takeFinished().
+
+class BatchScheduler {
+public:
+	BatchScheduler() { nBatches = nextBatch = nFinished = 0; trialsRun = inquirerSteps = linkVisits = 0; quit = false; }
+	~BatchScheduler() { stop(); }
+
+	// Start running batches 0 to n - 1. make(i) is called on a worker thread, one at a time, and must return a new
+	// batch, which the scheduler owns until it is taken.
+	void start(t_int n, function<BatchSimulation*(t_int)> make);
+	void stop(void);
+	bool isRunning(void) const { return !threads.empty(); }
+
+	// take a batch that has finished, with final statistics worked out, or return -1 if there is none yet
+	t_int takeFinished(BatchSimulation*& bs);
+
+	// how many batches have finished
+	t_int finishedCount(void) { lock_guard<mutex> g(lock); return nFinished; }
+
+	// work done in pieces finished so far, in trials, inquirer-steps & link-visits - it is counted across runs, so that
+	// a multibatch that starts the scheduler again for a finer grid goes on counting from where it was
+	void workDone(long long& trials, long long& inqSteps, long long& visits) {
+		lock_guard<mutex> g(lock);
+		trials = trialsRun;
+		inqSteps = inquirerSteps;
+		visits = linkVisits;
+	}
+
+private:
+	class ScheduledBatch {
+	public:
+		t_int index = 0;
+		BatchSimulation* bs = 0;
+		t_int handedOut = 0, merged = 0;
+		t_int running = 0;
+		bool finished = false;
+
+		// totals of pieces that are done but wait for earlier ones, by first trial
+		map<t_int, pair<t_int, BatchStatistics>> waiting;
+	};
+
+	void worker(void);
+	bool nextPiece(ScheduledBatch*& b, t_int& first, t_int& last);
+	void merge(ScheduledBatch* b, t_int first, t_int last, const BatchStatistics& s);
+
+	function<BatchSimulation*(t_int)> makeBatch;
+	mutex lock;
+	vector<thread> threads;
+	bool quit;
+
+	// batches being run, in order, and finished batches not yet taken
+	t_int nBatches, nextBatch, nFinished;
+	long long trialsRun, inquirerSteps, linkVisits;
+	vector<ScheduledBatch*> open;
+	vector<ScheduledBatch*> done;
+};
+
+// threads shared by all multibatches
+extern BatchScheduler batchScheduler;
+
+
+#endif
@@ -4,6 +4,8 @@
 #include "Prefix.h"
 #include "Simulation.h"
 #include "Topology.h"
+#include "Checkpoint.h"
+#include <time.h>
 
 // how many steps to take per simulation call?
 #define BATCH_SIMULATION_TIMEOUT 1.0
@@ -11,6 +13,9 @@
 // max stages in a batch simulation
 #define MAX_BATCH_STAGES 4
 
+// in adaptive batches, how many trials to run between checks of whether the results are precise enough
+#define ADAPTIVE_TRIAL_BLOCK 50
+
 class BatchStatistics {
 public:
 	t_float totalEValue, totalEValueDelta;
@@ -26,7 +31,7 @@ public:
 	t_float avgBWToPEffect, avgBWToNotPEffect, avgBWToPProb, avgBWToNotPProb;
     
 	// block to store topology data
-	vector<NetworkTopology> topologies;
+	TopologyStore topologies;
 	t_int societiesPerTopology;
 	bool recordTopologies;
 
@@ -35,11 +40,19 @@ public:
 	t_int timePerEValueStat, societiesPerEValueStat;
 	bool recordEValueStats;
 
+	// start totals from nothing, and add the totals of trials run elsewhere, before final statistics are worked out
+	void clearTotals(void);
+	void add(const BatchStatistics& s);
+
+	// write the totals, degrees & topologies so far to a checkpoint, and read them back
+	void saveCheckpoint(CheckpointFile& f) const;
+	void loadCheckpoint(CheckpointFile& f);
 };
 
 // Batch Simulation class - keeps track of statistics during a batch simulation
 
 class MultiBatch;
+class Ensemble;
 
 class BatchSimulation {
 public:
@@ -59,6 +72,9 @@ public:
 	
 	// save statistics to file
 	void saveStatisticsToFile(const char* filename);
+
+	// write the parameters & seed of the last run next to a file of its results
+	void saveManifest(const char* resultsFile);
 	
 	// get a string comparing this batch to another
 	string compareTo(const BatchSimulation& bs);
@@ -66,6 +82,26 @@ public:
 	// batch simulation variables
 	t_int nTrials = 0, nSteps[MAX_BATCH_STAGES] = { 0, 0, 0, 0 }, nStages = 0;
 	t_int curTrial = 0, curStage = 0;
+
+	// work done since the trials were set up, in steps of an inquirer & of a link, to show how fast the batch goes
+	long long inquirerSteps = 0, linkVisits = 0;
+
+	// master seed - every trial has its own stream of random numbers from it. 0 picks a new seed for each run, and
+	// the one used is kept in runSeed.
+	t_int seed = 0, runSeed = 0;
+
+	// Common random numbers - society generation & simulation each have a stream of their own for every trial, so
+	// batches that differ only a little draw the same numbers for the same things, and the differences between their
+	// results are not swamped by chance. With antithetic pairs, every odd trial runs the numbers of the trial before
+	// it turned around.
+	bool commonRandomNumbers = false, antithetic = false;
+
+	// Adaptive trial count - trials are run in blocks until the margin of error of the average e-value (and of the
+	// average polarisation, if asked for) at confidenceLevel is at most targetMargin. At least minTrials and at most
+	// nTrials are run; nTrialsRun is how many were.
+	bool adaptive = false, adaptivePolarisation = false;
+	t_int minTrials = 100, nTrialsRun = 0;
+	t_float targetMargin = 0.01, confidenceLevel = 0.95;
 	
 	// society setup to use
 	SocietySetup setup[MAX_BATCH_STAGES];
@@ -84,6 +120,19 @@ public:
 	
 	// do we need to update display to not seem irresponsible?
 	bool timeOut;
+
+	// run on a worker thread - nothing is shown, and trials are generated in the thread's own current society
+	bool background = false;
+
+	// Checkpoints - every CHECKPOINT_INTERVAL seconds, at the end of a trial, the progress so far is saved in
+	// checkpointFile, and e-values of the trials done are added to a file next to it, so that the batch can be resumed
+	// if it is stopped. They are removed when the batch is done.
+	bool checkpoint = false;
+	string checkpointFile;
+	time_t lastCheckpoint = 0;
+	t_int eValueSlicesSaved = 0;
+	bool saveCheckpoint(void);
+	bool resume(CheckpointFile& f);
 	
 	t_int totalSteps(void) {
 		t_int s = nSteps[0];
@@ -92,13 +141,41 @@ public:
 	}
 	
 	t_int maxInquirers(void);
-	void recordTrialEndStatistics(void);
+	void seedTrial(t_int trial);
+	void seedSimulation(t_int trial);
+	void recordTrialEndStatistics(Simulation& s);
 	void recordFinalStatistics(void);
+
+	// trial at which the current block ends, and whether enough trials have been run
+	t_int blockEnd(void) const;
+	bool preciseEnough(void) const;
+	t_float marginOfError(t_float total, t_float totalS) const;
+
+	// Take some steps of the current trial, or run the next few trials side by side, returning the number of steps
+	// taken. When the last trial needed is done, nTrialsRun is set.
+	t_int advance(void);
+
+	// run the trials from curTrial to nTrials without showing anything, leaving the totals unfinished
+	void runTrials(void);
+
+	// Trials run side by side - they are started together, and then take a few steps each at every call, returning
+	// the number of steps taken, until they are all done. Copies of a batch start them again.
+	Ensemble* ensemble = nullptr;
+	t_int advanceEnsemble(void);
+	void startEnsemble(void);
+	void nextEnsembleStage(void);
+	void finishEnsemble(void);
+
+	// trials run so far, counting the parts done of those under way
+	t_float trialsDone(void);
+
+	// statistics & display when all trials are done
+	void finishTrials(void);
 };
 
 
 void BatchProcess(void *data);
-void StartBatchSimulation(BatchSimulation* bs);
+void StartBatchSimulation(BatchSimulation* bs, bool resumed = false);
 void BatchSimulationTimeout(void* data);
 
 
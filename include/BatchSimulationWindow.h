@@ -27,6 +27,7 @@ public:
 	void configureInquirers(void);
 	void configureLinks(void);
 	void configureEValues(void);
+	void configureTrials(void);
 	void configureRecord(void);
 	
 	void turnOffExcludedVariables(void);
@@ -37,6 +38,9 @@ public:
 	void copyBatch(t_int from, t_int to);
 	void saveBatchSimulation(void);
 	void loadBatchSimulation(void);
+
+	// show how much memory & time the batch will take, offering to record less if it doesn't fit
+	void showEstimate(void);
 	
 	void activateRecursively(void);
 	
@@ -50,6 +54,7 @@ public:
 	Fl_Group *groupInquirers = nullptr;
 	Fl_Group *groupLinks = nullptr;
 	Fl_Group *groupEValues = nullptr;
+	Fl_Group *groupTrials = nullptr;
 	Fl_Group *groupRecord = nullptr;
 	
 	Fl_Value_Input *inputNumTrials = nullptr;
@@ -120,6 +125,18 @@ public:
 	Fl_Value_Input* inputBeliefNoneValue = nullptr;
 	Fl_Value_Input* inputBeliefNotPValue = nullptr;
 	Fl_Value_Input* inputExponent = nullptr;
+	Fl_Check_Button* buttonLogOdds = nullptr;
+	Fl_Check_Button* buttonSkipSampling = nullptr;
+	Fl_Check_Button* buttonContinuousTime = nullptr;
+	Fl_Check_Button* buttonBlockSteps = nullptr;
+	Fl_Choice* choiceRandomGenerator = nullptr;
+
+	Fl_Check_Button* buttonAdaptiveTrials = nullptr;			// trials tab
+	Fl_Value_Input* inputMinTrials = nullptr;
+	Fl_Value_Input* inputTargetMargin = nullptr;
+	Fl_Value_Input* inputConfidenceLevel = nullptr;
+	Fl_Check_Button* buttonAdaptivePolarisation = nullptr;
+	Fl_Check_Button* buttonCheckpoint = nullptr;
 
 	Fl_Check_Button* buttonRecordEValues = nullptr;				// record tab
 	Fl_Value_Input* fieldSocietiesPerEValue = nullptr;
@@ -129,6 +146,7 @@ public:
 	Fl_Check_Button* buttonRecordTopologies = nullptr;
 	Fl_Value_Input* fieldSocietiesPerTopology = nullptr;
 	Fl_Box* labelTopologySocieties = nullptr;
+	Fl_Button* buttonEstimate = nullptr;
 	
 	Fl_Spinner* inputNumStages = nullptr;								// stages
 	Fl_Button* btnStage[4] = { nullptr, nullptr, nullptr, nullptr };
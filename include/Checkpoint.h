@@ -0,0 +1,82 @@
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include "Prefix.h"
+#include "tinyxml.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// what a checkpoint is of
+#define CHECKPOINT_BATCH 0
+#define CHECKPOINT_MULTIBATCH 1
+#define CHECKPOINT_SWEEP_SPOOL 2
+#define CHECKPOINT_SWEEP_UNIT 3
+
+// how often to save a checkpoint, in seconds
+#define CHECKPOINT_INTERVAL 60
+
+class Society;
+
+// CheckpointFile - compact binary record of how far a long run has got, from which it can be resumed. It starts with
+// the settings of the run and the society it was started from, as XML, followed by the progress as numbers written the
+// way they are in memory, so a checkpoint can only be read on the same kind of machine and by the same version.
+//
+// A checkpoint is written to a temporary file and moved into place when it is complete, so that a crash while saving
+// leaves the last one as it was.
+
+class CheckpointFile {
+public:
+	CheckpointFile() { file = 0; ok = true; kind = -1; }
+	~CheckpointFile() { close(); }
+
+	// start writing a checkpoint of a run with these settings & society, if any, and put it in place when done
+	bool create(const char* filename, t_int k, TiXmlElement* settings, Society* soc);
+	bool commit(void);
+
+	// open a checkpoint, reading its kind, settings & society
+	bool open(const char* filename);
+	void close(void);
+
+	void putInt(long long v) { putBytes(&v, sizeof(v)); }
+	void putDouble(double v) { putBytes(&v, sizeof(v)); }
+	void putString(const string& s);
+	void putBytes(const void* data, size_t n) { if(ok && fwrite(data, 1, n, file) != n) ok = false; }
+	template<class T> void putVector(const vector<T>& v) {
+		putInt(v.size());
+		if(v.size()) putBytes(v.data(), v.size() * sizeof(T));
+	}
+
+	long long getInt(void) { long long v = 0; getBytes(&v, sizeof(v)); return v; }
+	double getDouble(void) { double v = 0; getBytes(&v, sizeof(v)); return v; }
+	string getString(void);
+	void getBytes(void* data, size_t n) { if(ok && fread(data, 1, n, file) != n) ok = false; }
+	template<class T> void getVector(vector<T>& v) {
+		long long n = getInt();
+		if(n < 0 || !ok) { ok = false; return; }
+		v.resize(n);
+		if(n) getBytes(v.data(), n * sizeof(T));
+	}
+
+	// did everything read or write as it should?
+	bool good(void) const { return ok; }
+
+	// what the checkpoint is of, its settings & the society it was started from, once opened
+	t_int kind;
+	TiXmlDocument settings;
+	TiXmlElement* runSettings(void) { return settings.RootElement() ? settings.RootElement()->FirstChildElement() : 0; }
+	TiXmlElement* society(void) { return settings.RootElement() ? settings.RootElement()->FirstChildElement("SOCIETY") : 0; }
+
+private:
+	FILE* file;
+	bool ok;
+	string path, tempPath;
+};
+
+// file of the checkpoint kept next to a results file
+string CheckpointFileName(const char* resultsFile);
+
+
+#endif
@@ -196,7 +196,7 @@ float AbnormalBeta(float x, float alpha, float beta);
 // Function to load default distributions
 void LoadDefaultDistributions(const char* directory);
 
-extern gsl_rng *rng;
+extern thread_local gsl_rng *rng;
 extern vector<Distribution> defaultDistributions;
 
 #endif
@@ -0,0 +1,63 @@
+#ifndef __ENSEMBLE_H__
+#define __ENSEMBLE_H__
+
+#include "Prefix.h"
+#include "Simulation.h"
+#include "Inquirer.h"
+#include "Link.h"
+#include <gsl/gsl_rng.h>
+#include <vector>
+
+using namespace std;
+
+class Society;
+class BatchSimulation;
+
+// largest number of trials to run side by side
+#define ENSEMBLE_WIDTH 8
+
+// Ensemble - runs several trials of a batch simulation in lockstep. When links are not varied, every trial has the
+// same inquirers and links, so the links into each inquirer are found once, and that inquirer is then handled in every
+// trial before going on to the next, while its links are still in the cache.
+//
+// Each trial has its own simulation, society & dice, and keeps its state in its society. Inquirers go through the same
+// inquiry code as in the serial engine, in the same order and rolling dice in the same order, so each trial comes out
+// exactly as if it had been run on its own.
+
+class Ensemble {
+public:
+	Ensemble() { nTrials = nPeople = nLinks = 0; stepsLeft = 0; }
+	~Ensemble();
+
+	// can the trials left in the batch be run this way?
+	static bool suitable(const BatchSimulation& bs);
+
+	// the trials, which are freed with the ensemble - except the last society, which is made the current one and is
+	// left to its thread
+	vector<Simulation> sims;
+	vector<Society*> societies;
+	vector<gsl_rng*> rngs;
+
+	// steps left in the current stage
+	t_int stepsLeft;
+
+	// find the links of the trials' societies, which must all have the same links, and start every trial running -
+	// again whenever the societies are remade
+	void load(void);
+
+	// take one synchronous step in every trial still running, returning how many still are
+	t_int step(void);
+
+private:
+	t_int nTrials, nPeople, nLinks;
+	vector<InquiryState> states;
+	vector<char> running;
+
+	// links by target - links into inquirer i are inStart[i] to inStart[i + 1], and link e of trial k is at
+	// links[e * nTrials + k]
+	vector<t_int> inStart;
+	vector<Link*> links;
+};
+
+
+#endif
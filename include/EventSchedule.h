@@ -0,0 +1,83 @@
+#ifndef __EVENTSCHEDULE_H__
+#define __EVENTSCHEDULE_H__
+
+#include "Prefix.h"
+#include "Link.h"
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+class Society;
+
+// number of steps ahead that events are kept in per-step buckets. Events further away wait in a common list.
+#define EVENT_CALENDAR_SIZE 1024
+
+// EventSchedule - keeps track of when inquiry gives results and when links are listened to, so that inquirers and
+// links with nothing happening need not be visited. Events are kept in a calendar queue with one bucket per step.
+//
+// In discrete time the number of steps until each inquirer or link next fires is drawn from a geometric
+// distribution, for skip-sampling of the synchronous simulation. In continuous time the waiting times are
+// exponential, with the chances per step as rates, and events are taken one at a time in order of time.
+//
+// Waiting times are memoryless either way, so the schedule can be thrown away and rebuilt at any time without
+// changing the distribution of outcomes. It is rebuilt whenever the society's generation changes, since the links it
+// points to may then be gone, and their chances different.
+
+class EventSchedule {
+public:
+	EventSchedule() { soc = 0; generation = 0; now = 0; continuous = stepStarted = false; }
+
+	// build a new schedule for the society, with the first events at given step
+	void reset(Society* s, t_int step, bool continuousTime);
+	void invalidate(void) { soc = 0; }
+	bool valid(const Society* s, bool continuousTime) const;
+
+	// discrete time - take the events for given step and schedule the next ones. Events come out grouped by
+	// inquirer, in the order a full pass through the society would have visited them.
+	void collect(t_int step);
+
+	// continuous time - take the next event before the end of given step, and schedule the one after it. Gives
+	// the inquirer concerned and the link listened to, or none if it is an inquiry result. Returns false when
+	// there are no more events during the step.
+	bool next(t_int step, t_int& inq, const LinkIterator*& link);
+
+	// inquirers with at least one event at the current step
+	vector<t_int> inquirers;
+
+	// for each of these, whether inquiry gives a result, and the range of links heard in 'heard'
+	vector<char> inquires;
+	vector<t_int> heardStart;
+	vector<LinkIterator> heard;
+
+	// links going out from an inquirer
+	const LinkIterator* outgoing(t_int inq) const { return outLinks.data() + outStart[inq]; }
+	t_int nOutgoing(t_int inq) const { return outStart[inq + 1] - outStart[inq]; }
+
+private:
+	void schedule(t_int id, t_float time);
+	t_float waitingTime(t_float p) const;
+	void takeBucket(void);
+
+	Society* soc;
+	unsigned long long generation;
+	t_int now, nPeople, nLinks;
+	bool continuous, stepStarted;
+
+	// events are numbered in visiting order - an inquirer's inquiry, followed by the links to that inquirer
+	vector<t_int> eventInquirer;
+	vector<LinkIterator> eventLink;
+	vector<char> eventIsLink;
+
+	// links grouped by source
+	vector<t_int> outStart;
+	vector<LinkIterator> outLinks;
+
+	// calendar of (time, event) pairs, events too far ahead for it, and events of the current step
+	vector<vector<pair<t_float, t_int> > > buckets;
+	vector<pair<t_float, t_int> > later;
+	vector<pair<t_float, t_int> > due;
+};
+
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef __FILEWRITER_H__
+#define __FILEWRITER_H__
+
+#include "Prefix.h"
+#include <stdio.h>
+
+// size of output buffer
+#define FILE_WRITER_BUFFER_SIZE 65536
+
+// Buffered writer for large text output. Numbers are formatted without sprintf, so output is locale independent
+// and several writers may be used from different threads at the same time.
+
+class FileWriter {
+public:
+	FileWriter(FILE* file) { f = file; n = 0; }
+	~FileWriter() { flush(); }
+
+	void flush(void) {
+		if (n) fwrite(buf, 1, n, f);
+		n = 0;
+	}
+
+	void put(char c) {
+		if (n == FILE_WRITER_BUFFER_SIZE) flush();
+		buf[n++] = c;
+	}
+	void put(const char* s);
+	void putInt(long long v);
+	void putFloat(double v, t_int digits = 3);
+	void newLine(void) { put('\r'); put('\n'); }
+
+private:
+	FILE* f;
+	t_int n;
+	char buf[FILE_WRITER_BUFFER_SIZE];
+};
+
+
+#endif
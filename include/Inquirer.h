@@ -7,17 +7,66 @@
 #include "Prefix.h"
 
 #include <forward_list>
+#include <cmath>
 
 #include "SocietySetup.h"
 #include "Link.h"
 #include "Trust.h"
 #include "Amount.h"
+#include "Random.h"
 #include "tinyxml.h"
 
 
 using namespace std;
 class Society;
 class Simulation;
+class SimulationCounters;
+class Inquirer;
+
+// InquirerActivity - when an inquirer last got a result from inquiry or was listened to, as of the start of a step.
+// Used when inquirers are handled in parallel, since the live values may be changed by other threads.
+
+class InquirerActivity {
+public:
+	t_int lastInquiryResult;
+
+	// latest use of a link to this inquirer, its source, and the latest use of a link from any other source
+	t_int lastHeard, lastHeardFrom, lastHeardOtherwise;
+};
+
+// InquiryState - the evidence an inquirer has gathered so far during one step, and where to roll dice & count
+// results while doing so
+
+class InquiryState {
+public:
+	InquiryState(gsl_rng* r, SimulationCounters* c, const InquirerActivity* a = 0, RandomBuffer* u = 0) : rand(r), counts(c), activity(a), uniforms(u) {}
+	void start(Simulation* sim, const Inquirer& inq, t_int index);
+	void start(Simulation* sim, const Amount& belief);
+
+	// take a message into account, given the expected trust in its source
+	void add(Amount expectation, bool saysP);
+
+	// belief given the evidence so far (left hand side / (left hand side + right hand side))
+	bool contradictory(void) const { return logOdds ? std::isnan(l) : !(lhs + rhs > 0); }
+	Amount result(void) const { return logOdds ? Amount::fromLogOdds(l) : lhs.dividedByAdded(rhs); }
+
+	bool informationReceived;
+	Amount inqEffect;
+	char inqName[64];
+
+	// roll a die, in bulk if there is a buffer for it
+	inline double uniform(void) { return uniforms ? uniforms->uniform(rand) : gsl_rng_uniform(rand); }
+
+	gsl_rng* rand;
+	SimulationCounters* counts;
+	const InquirerActivity* activity;
+	RandomBuffer* uniforms;
+
+private:
+	bool logOdds;
+	amt_type l;
+	Amount lhs, rhs;
+};
 
 // Inquirer - represents a Bayesian inquirer, and also handles saving and loading of said inquirer.
 
@@ -32,6 +81,16 @@ public:
 
 	// handle inquiry
 	void doInquiry(Simulation* sim, Society *soc, t_int index);
+	void doInquiry(Simulation* sim, Society *soc, t_int index, InquiryState& st);
+	void doScheduledInquiry(Simulation* sim, Society *soc, t_int index, bool inquire, const LinkIterator* heard, t_int nHeard);
+
+	// the parts of doInquiry - inquiry, then listening to each link into the inquirer in turn, then finishInquiry
+	void startInquiry(Simulation* sim, t_int index, InquiryState& st);
+	void listenTo(Simulation* sim, Society *soc, Link& link, t_int index, InquiryState& st);
+	void receiveInquiryResult(Simulation* sim, InquiryState& st);
+	t_int messageFrom(Society *soc, const Link& link, t_int index, InquiryState& st) const;
+	void hearFrom(Simulation* sim, Society *soc, Link& link, t_int whatToSay, InquiryState& st);
+	void finishInquiry(Simulation* sim, InquiryState& st);
 
 	TiXmlElement* toXML(t_int id) const;
 
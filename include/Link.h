@@ -21,6 +21,7 @@ public:
 	// constructor & destructor
 	Link(t_int from = 0, t_int to = 0, SocietySetup *setup = 0);
 	Link(t_int from, t_int to, const Link& l);
+	Link(const Link& l);
 	Link(TiXmlElement* xml);
 	~Link();
 	Link& operator=(const Link& l);
@@ -3,7 +3,11 @@
 
 #include "Prefix.h"
 #include "BatchSimulation.h"
+#include "BatchScheduler.h"
+#include "Checkpoint.h"
 #include <FL/filename.H>
+#include <vector>
+#include <map>
 
 // batch names in a multibatch
 #define BATCH_A 0
@@ -11,8 +15,30 @@
 #define BATCH_C 2
 #define BATCH_D 3
 #define BATCH_FREESTANDING -1
-#define N_MULTIBATCH_VALUES 4
+#define N_MULTIBATCH_VALUES 5
 
+// how often to collect finished batches, in seconds
+#define MULTIBATCH_POLL_INTERVAL 0.1
+
+// how many times a grid cell can be split in half when refining
+#define MULTIBATCH_MAX_REFINEMENT 8
+
+// a point of a multibatch, at (i, j) on a lattice 2^MULTIBATCH_MAX_REFINEMENT times finer than the grid, and its results
+class MultiBatchPoint {
+public:
+	t_int i, j;
+	bool done = false;
+	t_float values[N_MULTIBATCH_VALUES];
+	string title;
+};
+
+// a cell of a refined multibatch - the square from (i, j) to (i + size, j + size) on the lattice, or if the multibatch
+// is one dimensional the line of that length from (i, j) along whichever axis has more than one step
+class MultiBatchCell {
+public:
+	MultiBatchCell(t_int i0, t_int j0, t_int s) { i = i0; j = j0; size = s; }
+	t_int i, j, size;
+};
 
 class MultiBatch {
 public:
@@ -20,32 +46,74 @@ public:
 	MultiBatch(TiXmlElement* xml);
 	void process(void);
 	void saveStatisticsToFile(void);
+	void saveRefinedStatisticsToFile(string* names);
+	void saveManifest(void);
 	void setDefault();
+
+	// Checkpoints - the points done so far are saved next to the results file every CHECKPOINT_INTERVAL seconds, at
+	// the end of each pass & when the multibatch is cancelled, and removed when it is done. A resumed multibatch runs
+	// the points it had not finished.
+	bool saveCheckpoint(void);
+	bool resume(CheckpointFile& f);
+	bool checkpoint;
+	time_t lastCheckpoint;
+
 	TiXmlElement*toXML(const char* name = 0);
 
 	// generate a batch simulation with the requested parameters, stored in curBatch
 	void generateBatch(t_float x, t_float y = 0);
+	void interpolateBatch(BatchSimulation& bs, t_float x, t_float y);
+
+	// make the batch at a point of the grid, numbered along A to B first, for running on a worker thread
+	BatchSimulation* makeBatch(t_int point);
 
 	// find which variables are changing
 	void recordVariables(t_int whichBatch);
-	void recordBatchStatistics(void);
+	void recordBatchStatistics(BatchSimulation& bs, t_int point);
+
+	// Add points where the grid is steep, returning false if there are none to add. Cells of the last pass whose
+	// corners differ most are split first, while the budget lasts.
+	bool refineGrid(void);
+	t_int addPoint(t_int i, t_int j);
+	t_float cellDifference(const MultiBatchCell& c);
+
+	// run the points of the last pass that are not done yet
+	void runPoints(void);
+	vector<t_int> running;
 
 	// batch simulation variables
 	t_int stepsAtoB, stepsAtoC;
+
+	// master seed, from which each batch gets its own - 0 picks a new one for each run, kept in runSeed
+	t_int seed, runSeed;
 	BatchSimulation batches[4];
 
+	// Common random numbers - every point runs trial i with the same streams, so that differences between points
+	// come from their parameters rather than chance. Antithetic pairs run every odd trial turned around.
+	bool commonRandomNumbers, antithetic;
+
+	// Adaptive refinement - once the grid has been run, cells whose corners differ by more than refineThreshold in
+	// e-value or polarisation are split, and the new points run, until no cell needs to be split or refineBudget
+	// points have been added. Results are then written with one line for each point.
+	bool refine;
+	t_float refineThreshold;
+	t_int refineBudget;
+
     // current variables
 	BatchSimulation curBatch;
-	t_int xStep, yStep;
-	t_float *values;
-	string *titles;
+	t_int xStep, yStep, pointsDone, passStart;
 	Society *templateSociety;
 
+	// points in the order they were added, the grid first, where they are, and the cells of the last pass
+	vector<MultiBatchPoint> points;
+	map<pair<t_int, t_int>, t_int> pointAt;
+	vector<MultiBatchCell> cells;
+
 	// which file to save result in?
 	char filename[FL_PATH_MAX];
 };
 
 void MultiBatchProcess(void* data);
-void StartMultiBatchSimulation(MultiBatch* mb);
+void StartMultiBatchSimulation(MultiBatch* mb, bool resumed = false);
 
 #endif
@@ -0,0 +1,104 @@
+#ifndef __PARALLELEVOLVE_H__
+#define __PARALLELEVOLVE_H__
+
+#include "Prefix.h"
+#include "Simulation.h"
+#include "Random.h"
+#include <gsl/gsl_rng.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+// smallest society to split between threads - below this, starting the threads costs more than it saves
+#define PARALLEL_EVOLVE_MIN_INQUIRERS 20000
+
+// inquirers in each block of work
+#define PARALLEL_EVOLVE_BLOCK_SIZE 2048
+
+// ParallelEvolve - takes synchronous steps in blocks, for simulations set to STEP_ENGINE_BLOCKS, using several threads
+// for large societies. Inquirers are divided into
+// blocks of a fixed size by index, and each thread takes a range of blocks. Since the link map is ordered by target,
+// the thread handling a block also owns the links into its inquirers and is the only one to touch their trust. Each
+// block rolls its own dice, from a stream given by a number drawn from the main generator at the start of the step
+// and the block's index, and keeps its own counters, which are added to the simulation's in order afterwards. So the
+// result depends on the seed, but not on the number of threads.
+//
+// Whether a source has anything new to say is judged by the state at the start of the step, so news reaches a listener
+// a step later than in the serial engine whenever the listener comes after its source. That is a different model, not
+// the serial one done faster, so blocks are only used when a simulation is set to them, and then for societies of every
+// size, logged or not, so that the rules never change with the size of the society or with logging.
+//
+// There is one set of threads for the whole program. Small societies, logged simulations - whose messages have to come
+// in order - and simulations that find the threads busy with another do the same blocks one after the other on their
+// own thread, so the result never depends on how simulations happen to be timed, and no more threads are started than
+// there are processors.
+
+// ParallelStep - the work of one step: the society, and the dice, counters & starting state of each of its blocks.
+// Each thread taking steps has its own.
+
+class ParallelStep {
+public:
+	enum { PHASE_ACTIVITY, PHASE_INQUIRY, PHASE_MESSAGES };
+
+	ParallelStep() { sim = 0; soc = 0; nBlocks = 0; }
+	~ParallelStep();
+
+	// divide the society into blocks, and seed their dice from the current generator
+	void prepare(Simulation* s, Society* society);
+
+	void doBlock(t_int b, t_int phase);
+
+	Simulation* sim;
+	Society* soc;
+	t_int nBlocks;
+	vector<gsl_rng*> rngs;
+	vector<RandomBuffer> uniforms;
+	vector<SimulationCounters> counters;
+
+	// state of each inquirer at the start of the step
+	vector<InquirerActivity> activity;
+};
+
+class ParallelEvolve {
+public:
+	ParallelEvolve() { nThreads = 0; generation = nBusy = 0; quit = false; work = 0; }
+	~ParallelEvolve() { stop(); }
+
+	// is it worth using threads for this society?
+	static bool worthwhile(const Society* s);
+
+	// work out every inquirer's new belief, and the messages for every link. Returns false if the simulation isn't
+	// set to take steps in blocks, and should be done the usual way instead.
+	bool step(Simulation* s, Society* society);
+
+private:
+	void start(t_int n);
+	void stop(void);
+	void run(t_int phase);
+	void worker(t_int k);
+	void doPhase(t_int k, t_int phase);
+
+	// held while a simulation is using the threads
+	mutex inUse;
+
+	// threads, and the work they are currently doing
+	t_int nThreads;
+	vector<thread> threads;
+	mutex lock;
+	condition_variable wake, done;
+	t_int generation, nBusy, curPhase;
+	bool quit;
+	ParallelStep* work;
+
+	// first block of each thread
+	vector<t_int> firstBlock;
+};
+
+// threads shared by all simulations
+extern ParallelEvolve parallelEvolve;
+
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include "Prefix.h"
+#include <string>
+
+using namespace std;
+
+// phases of a batch simulation that are timed
+#define PROFILE_SOCIETY_CREATION 0
+#define PROFILE_SIMULATION_RESET 1
+#define PROFILE_INQUIRIES 2
+#define PROFILE_MESSAGE_RECORDING 3
+#define PROFILE_BELIEF_UPDATES 4
+#define PROFILE_TRIAL_STATISTICS 5
+#define PROFILE_TOPOLOGY_RECORDING 6
+#define PROFILE_LAYOUT 7
+#define N_PROFILE_PHASES 8
+
+// events that are counted
+#define PROFILE_MESSAGES 0
+#define PROFILE_TRUST_UPDATES 1
+#define PROFILE_RANDOM_DRAWS 2
+#define N_PROFILE_COUNTERS 3
+
+// Profiling - time spent in each phase of batch simulations, measured with the processor's time stamp counter, and
+// counts of what happens in them. It costs a few cycles at every timed block and counted event, so it is only
+// compiled in when LAPUTA_PROFILE is defined (cmake -DLAPUTA_PROFILE=ON); otherwise PROFILE_SCOPE & PROFILE_COUNT are
+// empty. Every thread counts for itself, and the counts of all threads are added up when the profile is shown.
+
+#ifdef LAPUTA_PROFILE
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _WINDOWS
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+inline unsigned long long ProfileTicks(void) { return __rdtsc(); }
+#else
+#include <chrono>
+inline unsigned long long ProfileTicks(void) { return std::chrono::steady_clock::now().time_since_epoch().count(); }
+#endif
+
+class ProfileCounts {
+public:
+	unsigned long long ticks[N_PROFILE_PHASES];
+	unsigned long long calls[N_PROFILE_PHASES];
+	unsigned long long counts[N_PROFILE_COUNTERS];
+};
+
+// counts of this thread, made the first time it counts anything, and added to the rest when it ends
+extern thread_local ProfileCounts* threadProfile;
+ProfileCounts* NewThreadProfile(void);
+inline ProfileCounts* ThreadProfile(void) { return threadProfile ? threadProfile : threadProfile = NewThreadProfile(); }
+
+// ProfileTimer - adds the time until it goes out of scope to a phase
+
+class ProfileTimer {
+public:
+	ProfileTimer(t_int p) { phase = p; start = ProfileTicks(); }
+	~ProfileTimer() {
+		ProfileCounts* c = ThreadProfile();
+		c->ticks[phase] += ProfileTicks() - start;
+		++c->calls[phase];
+	}
+
+private:
+	t_int phase;
+	unsigned long long start;
+};
+
+#define PROFILE_NAME2(a, b) a##b
+#define PROFILE_NAME(a, b) PROFILE_NAME2(a, b)
+#define PROFILE_SCOPE(phase) ProfileTimer PROFILE_NAME(profileTimer, __LINE__)(phase)
+#define PROFILE_COUNT(counter, n) (ThreadProfile()->counts[counter] += (n))
+
+#else
+
+#define PROFILE_SCOPE(phase)
+#define PROFILE_COUNT(counter, n)
+
+#endif
+
+// start counting from nothing, e.g. when a batch is started
+void ResetProfile(void);
+
+// was profiling compiled in?
+bool ProfileEnabled(void);
+
+// what has been counted since the profile was reset, as lines of text or as JSON
+string ProfileSummary(void);
+bool SaveProfile(const char* filename);
+
+// file of the profile kept next to a results file
+string ProfileFileName(const char* resultsFile);
+
+
+#endif
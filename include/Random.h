@@ -0,0 +1,88 @@
+#ifndef __RANDOM_H__
+#define __RANDOM_H__
+
+#include "Prefix.h"
+#include "Profiler.h"
+#include <gsl/gsl_rng.h>
+
+// random number generators to choose between
+#define RANDOM_GENERATOR_TAUS 0
+#define RANDOM_GENERATOR_MT19937 1
+#define RANDOM_GENERATOR_XOSHIRO 2
+#define RANDOM_GENERATOR_PCG 3
+#define RANDOM_GENERATOR_PHILOX 4
+#define N_RANDOM_GENERATORS 5
+
+// number of uniform numbers drawn at a time for hot loops
+#define RANDOM_BUFFER_SIZE 256
+
+// Fast generators - xoshiro256++ (four interleaved streams, so that bulk fills can be done four at a time with AVX2),
+// PCG64 and Philox4x32-10. They are made as GSL generator types, so everything that takes a gsl_rng, including GSL's
+// own distributions, can use them as they are. The GSL generators can still be chosen to reproduce old results.
+
+extern const gsl_rng_type* rng_xoshiro256pp;
+extern const gsl_rng_type* rng_pcg64;
+extern const gsl_rng_type* rng_philox4x32;
+
+// generator types & their names in files
+const gsl_rng_type* RandomGeneratorType(t_int generator);
+const char* RandomGeneratorName(t_int generator);
+t_int RandomGeneratorValue(const char* name);
+
+// change the kind of the main generator, seeding the new one from the old
+void UseRandomGenerator(t_int generator);
+
+// Seeds for reproducible runs. A run has one master seed, and each trial, or other piece of work that must come out
+// the same however it is scheduled, has a stream of its own given by the seed and its number. Streams of the fast
+// generators never overlap - Philox streams are blocks of its counter, and xoshiro256++ and PCG64 streams are
+// jumped 2^192 and 2^96 steps ahead of the generator seeded with the seed. GSL generators are seeded with a hash of
+// seed & stream.
+t_int NewRandomSeed(void);
+t_int DeriveRandomSeed(t_int seed, t_int stream);
+void SeedRandomStream(gsl_rng* r, t_int seed, t_int stream);
+
+// Switch a generator to or from its antithetic twin, which carries on from the same state but gives 1 - u for every
+// uniform number u, so that a stream seeded the same way and run turned around makes the mirror image of a trial.
+void SetAntithetic(gsl_rng* r, bool on);
+bool IsAntithetic(const gsl_rng* r);
+
+// fill a block with uniform numbers in [0, 1)
+void RandomUniforms(gsl_rng* r, double* out, t_int n);
+
+// RandomBuffer - uniform numbers drawn in bulk. GSL generators are used one number at a time as before, so that
+// results with them are the same as they always were.
+
+class RandomBuffer {
+public:
+	RandomBuffer() { rand = 0; type = 0; pos = RANDOM_BUFFER_SIZE; bulk = false; }
+
+	// copies start empty, so that two simulations never use the same numbers
+	RandomBuffer(const RandomBuffer&) : RandomBuffer() {}
+	RandomBuffer& operator=(const RandomBuffer&) { clear(); return *this; }
+
+	inline double uniform(gsl_rng* r) {
+		PROFILE_COUNT(PROFILE_RANDOM_DRAWS, 1);
+		if(r != rand || r->type != type) use(r);
+		if(!bulk) return gsl_rng_uniform(r);
+		if(pos == RANDOM_BUFFER_SIZE) {
+			RandomUniforms(r, buf, RANDOM_BUFFER_SIZE);
+			pos = 0;
+		}
+		return buf[pos++];
+	}
+
+	// throw away numbers drawn so far, e.g. after the generator is reseeded
+	void clear(void) { pos = RANDOM_BUFFER_SIZE; }
+
+private:
+	void use(gsl_rng* r);
+
+	gsl_rng* rand;
+	const gsl_rng_type* type;
+	bool bulk;
+	t_int pos;
+	double buf[RANDOM_BUFFER_SIZE];
+};
+
+
+#endif
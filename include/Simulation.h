@@ -6,6 +6,8 @@
 #include "SocietySetup.h"
 #include "Society.h"
 #include "StatisticsBlock.h"
+#include "EventSchedule.h"
+#include "Random.h"
 
 #include <vector>
 #include <set>
@@ -25,10 +27,31 @@
 #define LOG_STANDARD 2
 #define LOG_DETAILED 3
 
+// how beliefs are updated during inquiry
+#define BELIEF_ENGINE_AMOUNT 0
+#define BELIEF_ENGINE_LOG_ODDS 1
+
+// how to decide when inquiry gives a result and when links are listened to
+#define EVENT_SAMPLING_EVERY_STEP 0
+#define EVENT_SAMPLING_SKIP 1
+
+// whether everyone updates together at each step, or inquiry results and messages arrive one at a time in continuous
+// time and take effect at once
+#define TIMING_SYNCHRONOUS 0
+#define TIMING_CONTINUOUS 1
+
+// how a synchronous step is taken - one inquirer after another, so that news can reach those after its source at once,
+// or in blocks that can run on several threads, where news always arrives a step later
+#define STEP_ENGINE_SERIAL 0
+#define STEP_ENGINE_BLOCKS 1
+
 
 
 #define LOG_BUFFER_SIZE 0x7FFF
 
+// how often to recalculate e-value sums from scratch, to keep rounding errors from building up
+#define EVALUE_RECALCULATION_INTERVAL 1024
+
 //-----------------------------------------------------------------------------------------------------------------------
 
 class ValuationMethod {
@@ -42,11 +65,66 @@ public:
 
 //-----------------------------------------------------------------------------------------------------------------------
 
+class Simulation;
+
+// EValueAggregate - running sums of individual e-values and beliefs, so that statistics for each step only need to
+// be updated for inquirers whose belief has changed
+
+class EValueAggregate {
+public:
+	void recalculate(Simulation* sim);
+	void update(Simulation* sim, t_int i, t_float oldBelief, t_float newBelief, bool included);
+	t_float eValue(const ValuationMethod& val) const;
+	t_float polarisation(t_float ev) const;
+	inline t_int vote(const ValuationMethod& val, t_float blf) const;
+
+	// e-value of each inquirer
+	vector<t_float> eValues;
+
+	// mean of all inquirers' e-values & sum of their squared deviations from it, kept as in Welford's method, for
+	// polarisation
+	t_float eValueMean, eValueM2;
+
+	// sums & counts over inquirers included in statistics
+	t_float includedEValueSum, includedBeliefSum;
+	t_int nIncluded, nVotingP, nVotingNotP;
+
+	t_int stepsSinceRecalculation;
+};
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+// SimulationCounters - counts of what happened during a simulation. Kept separately for each thread when inquirers
+// are handled in parallel, and added together afterwards.
 
+class SimulationCounters {
+public:
+	void clearCounters(void) {
+		msgSent = inqResults = 0;
+		bwTowardsP = bwTowardsNotP = 0;
+		inqOverriddenTowardsP = inqOverriddenTowardsNotP = 0;
+	}
+	void addCounters(const SimulationCounters& c) {
+		msgSent += c.msgSent;
+		inqResults += c.inqResults;
+		bwTowardsP += c.bwTowardsP;
+		bwTowardsNotP += c.bwTowardsNotP;
+		inqOverriddenTowardsP += c.inqOverriddenTowardsP;
+		inqOverriddenTowardsNotP += c.inqOverriddenTowardsNotP;
+	}
+
+	t_int msgSent, inqResults;
+
+	// bandwagon measurement
+	t_float bwTowardsP, bwTowardsNotP;
+	t_int inqOverriddenTowardsP, inqOverriddenTowardsNotP;
+};
+
+//-----------------------------------------------------------------------------------------------------------------------
 
 // Simulation class - keeps track of statistics during a single simulation
 
-class Simulation {
+class Simulation : public SimulationCounters {
 public:
 	// constructor & destructor
 	Simulation();
@@ -61,6 +139,16 @@ public:
 
 	// simulation functions
 	void step(t_int nStepsToTake = 1, t_int timePerEValue = 1);
+	void advance(t_int nStepsToTake = 1, t_int timePerEValue = 1);
+	void updateStepStatistics(void);
+	void finishStep(t_int timePerEValue = 1);
+
+	// trials that can no longer change - once nothing but counts of messages & inquiry results can change, the
+	// steps up to the given one are filled in without being simulated. 0 simulates every step.
+	void stopWhenAbsorbed(t_int until);
+	bool checkAbsorbed(void);
+	bool absorbed(void);
+	void fillAbsorbed(gsl_rng* r, t_int timePerEValue = 1);
 	void setTime(t_int t);
 	t_int getTime(void) {return curStep;}
 	void stepTime(void);
@@ -87,21 +175,40 @@ public:
 	t_int curStep;
 	t_float eValue, eValueDelta, eValueTotal, eValueDeltaTotal, startEValue;
 	t_float polarisation, polarisationDelta, startPolarisation;
-	t_int msgSent, inqResults;
-
-	// bandwagon measurement
-	t_float bwTowardsP, bwTowardsNotP;
-	t_int inqOverriddenTowardsP, inqOverriddenTowardsNotP;
 
 	// block to enter individual eValues into
 	StatisticsBlock eValuesOverTime;
 
+	// running e-value sums
+	EValueAggregate aggregate;
+
 	// how much to show in log
 	t_int logLevel;
 
 	// how to calculate evalue
 	ValuationMethod val;
 
+	// representation of beliefs while combining evidence
+	t_int beliefEngine;
+
+	// roll for every inquirer & link at every step, or skip ahead to the next event of each
+	t_int eventSampling;
+	EventSchedule schedule;
+
+	// synchronous or continuous time simulation
+	t_int timing;
+
+	// serial or block steps, for synchronous simulations
+	t_int stepEngine;
+
+	// kind of random number generator to use, and uniform numbers drawn from it in bulk
+	t_int randomGenerator;
+	RandomBuffer uniforms;
+
+	// inquirers whose belief changed at the last step, and when to next look for an absorbing state
+	t_int nChanged = 0;
+	t_int absorbedUntil = 0, nextAbsorptionCheck = 0, absorptionCheckGap = 1;
+
 	// logging message being built
 	char *logMsg;
 	t_int logMsgSize;
@@ -109,6 +216,13 @@ public:
 
 // simulation idle functions
 void RunSimulation(void *data);
+void ShowSimulationSnapshot(void *data);
+
+// run & pause the interactive simulation
+void StartSimulation(Simulation* s);
+void PauseSimulation(Simulation* s);
+bool SimulationRunning(Simulation* s);
+void SetSimulationLogLevel(Simulation* s, t_int level);
 
 
 
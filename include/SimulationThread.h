@@ -0,0 +1,87 @@
+#ifndef __SIMULATIONTHREAD_H__
+#define __SIMULATIONTHREAD_H__
+
+#include "Prefix.h"
+#include <gsl/gsl_rng.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+using namespace std;
+
+class Simulation;
+
+// how often to show the state of a running simulation, in seconds
+#define SIMULATION_DISPLAY_INTERVAL (1.0 / 30.0)
+
+// SimulationSnapshot - what the display needs to know about a society while it is being simulated
+
+class SimulationSnapshot {
+public:
+	t_int curStep;
+	t_float eValue, eValueDelta, polarisation;
+
+	// belief of each inquirer, and expected trust of each link in link map order
+	vector<float> beliefs, trust;
+};
+
+// SnapshotBuffer - passes snapshots from one writer thread to one reader thread without locking. The writer fills
+// its own slot and swaps it with the spare one, the reader swaps its slot with the spare one when that holds a newer
+// snapshot, so neither side ever waits for the other.
+
+template <class T> class SnapshotBuffer {
+public:
+	SnapshotBuffer() : spare(1) { write = 0; read = 2; }
+
+	// writer side
+	T& writeSlot(void) { return slots[write]; }
+	void publish(void) { write = spare.exchange(write | SNAPSHOT_FRESH) & SNAPSHOT_INDEX; }
+
+	// reader side - returns true if a newer snapshot has been published since last time
+	bool update(void) {
+		if (!(spare.load() & SNAPSHOT_FRESH)) return false;
+		read = spare.exchange(read) & SNAPSHOT_INDEX;
+		return true;
+	}
+	const T& readSlot(void) const { return slots[read]; }
+
+private:
+	enum { SNAPSHOT_INDEX = 3, SNAPSHOT_FRESH = 4 };
+
+	T slots[3];
+	t_int write, read;
+	atomic<t_int> spare;
+};
+
+// SimulationThread - runs the interactive simulation in the background. The society must not be changed by anyone
+// else while it runs; the display reads the latest snapshot instead. It rolls the dice of the thread that started it.
+
+class SimulationThread {
+public:
+	SimulationThread() { sim = 0; dice = 0; stopRequested = false; }
+	~SimulationThread() { stop(); }
+
+	void start(Simulation* s);
+	void stop(void);
+	bool isRunning(Simulation* s = 0) const { return worker.joinable() && (s == 0 || s == sim); }
+
+	// get latest snapshot, if there is a new one
+	const SimulationSnapshot* newSnapshot(void) { return snapshots.update() ? &snapshots.readSlot() : 0; }
+	const SimulationSnapshot* lastSnapshot(void) const { return &snapshots.readSlot(); }
+
+private:
+	void run(void);
+	void publish(void);
+
+	Simulation* sim;
+	gsl_rng* dice;
+	thread worker;
+	atomic<bool> stopRequested;
+	SnapshotBuffer<SimulationSnapshot> snapshots;
+};
+
+// global thread used for the simulation window
+extern SimulationThread simulationThread;
+
+
+#endif
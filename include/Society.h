@@ -71,6 +71,7 @@ public:
 
 	// run simulation one step
 	void evolve(Simulation* sim);
+	void recordLinkMessage(Link& l);
 
 	// organise society for visibility
 	void organise(void);
@@ -84,6 +85,8 @@ public:
 	// load and save societies
 	void saveToFile(const char* name);
 	void loadFromFile(const char* name);
+	TiXmlElement* toXML(void);
+	void fromXML(TiXmlElement* soc);
 
 	// link network handling
 	Link* getLink(t_int source, t_int target);
@@ -104,6 +107,12 @@ public:
 	// map of links in society
 	LinkMap links;
 
+	// Changes whenever inquirers or links are added, removed or replaced, so that what keeps iterators into them, like
+	// an event schedule, can tell it is out of date - and when a simulation has changed them, so that the undo journal
+	// can. Numbers are never used twice, even by different societies.
+	unsigned long long generation;
+	void newGeneration(void);
+
 	// blocks used in generating new society
 	vector<t_float> weights;
 	t_float totalWeight;
@@ -128,8 +137,9 @@ public:
 	vector<Link> links;
 };
 
-// global variables
-extern Society *curSociety;
+// global variables - each thread has its own current society, so batches run on worker threads generate their
+// societies there, and the one on the main thread is the one shown
+extern thread_local Society *curSociety;
 
 
 #endif
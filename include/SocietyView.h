@@ -11,15 +11,23 @@
 
 #define WORKSPACE_SIZE 16384
 
+class SimulationSnapshot;
+class LinkLayer;
+
 // SocietyView - shows the social network, and also handles user t_interaction.
 
 class SocietyView : public Fl_Widget {
 public:
 	// constructor & destructor
 	SocietyView(t_int x, t_int y, t_int w, t_int h, const char *label = 0);
+	~SocietyView();
 
-	// draw method
+	// Draw method - links & inquirers are drawn to a layer that is kept until something changes, and the selection &
+	// whatever is being dragged are drawn on top of it. Blinking of the selection, pulling a link and dragging a
+	// selection rectangle only redraw what's on top.
 	void draw(void);
+	void drawLayer(const SimulationSnapshot* snap);
+	void drawOverlay(t_float xLeft, t_float yTop);
 
 	// event handling
 	t_int handle(t_int event);
@@ -59,9 +67,12 @@ public:
 	void setZoomToDefault(int direction);
 	void setZoomToFit(void);
 	void setMidpoint(t_float x, t_float y);
+	void setSnapshot(const SimulationSnapshot* s) {snapshot = s;}
 
 	void setInquirerColour(t_float belief);
 	void drawLink(t_float x0, t_float y0, t_float x1, t_float y1, t_float d, t_float strength, t_float trust, bool drawAsSelected);
+	void drawLinkBetween(const Link& l, t_float xLeft, t_float yTop, t_float trust, bool drawAsSelected);
+	void drawLinkDensity(const SimulationSnapshot* snap);
 	t_int getInquirerUnderPoint(t_float x, t_float y);
 	bool getLinkUnderPoint(t_float x, t_float y, t_int& src, t_int& target);
 	t_int pointInLine(t_float xPt, t_float yPt, t_float x0Line, t_float y0Line, t_float x1Line, t_float y1Line, t_float thickness);
@@ -91,6 +102,12 @@ public:
 	bool showInquirerNames;
 	bool showLinks;
 
+	// snapshot of a simulation running in the background, if any
+	const SimulationSnapshot* snapshot;
+
+	// links & inquirers as last drawn
+	LinkLayer* linkLayer;
+
 	// timer callback for updating selections
 	static void idleCallback(void* v);
 };
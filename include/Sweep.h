@@ -0,0 +1,114 @@
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include "Prefix.h"
+#include "BatchSimulation.h"
+#include "BatchScheduler.h"
+#include "FileWriter.h"
+#include <FL/filename.H>
+#include <stdio.h>
+#include <vector>
+
+using namespace std;
+
+// designs of a sweep
+#define SWEEP_FACTORIAL 0
+#define SWEEP_LATIN_HYPERCUBE 1
+#define SWEEP_SOBOL 2
+
+// kinds of parameters
+#define SWEEP_NUMBER 0
+#define SWEEP_WHOLE_NUMBER 1
+#define SWEEP_DISTRIBUTION 2
+
+// most parameters in a Sobol design - as many as gsl has direction numbers for
+#define SWEEP_MAX_SOBOL_PARAMETERS 40
+
+// how often to collect finished batches, in seconds
+#define SWEEP_POLL_INTERVAL 0.1
+
+// SweepParameter - one parameter varied in a sweep, named as it is in batch files, e.g. EXPONENT, TRIALS or
+// INQ_CHANCE. Numbers go from min to max; distributions are interpolated from low to high. Parameters of the society
+// setup are varied in every stage, unless a stage is given.
+
+class SweepParameter {
+public:
+	SweepParameter() { min = 0; max = 1; levels = 2; stage = -1; kind = -1; }
+	SweepParameter(TiXmlElement* xml);
+	TiXmlElement* toXML(void) const;
+
+	// find what kind of parameter this is in a batch, returning false if there is none of that name
+	bool locate(BatchSimulation& bs);
+
+	// set the parameter in a batch at u, from 0 at the low end to 1 at the high end
+	void apply(BatchSimulation& bs, t_float u) const;
+
+	// value set at u - the mean, for distributions
+	t_float value(t_float u) const;
+
+	string name;
+	t_int kind;
+	t_float min, max;
+	Distribution low, high;
+	t_int stage;
+
+	// points along this parameter in a full factorial design
+	t_int levels;
+};
+
+// Sweep - runs batches at points spread over any number of parameters. A full factorial design takes every
+// combination of levels of the parameters; a Latin hypercube or Sobol design spreads a given number of points over
+// the whole space, which covers it with far fewer batches than a grid. The batches are run by the batch scheduler, and
+// a line is written to the results table as each one finishes, so that results so far are kept if a sweep is cancelled.
+
+class Sweep {
+public:
+	Sweep(TiXmlElement* xml, const BatchSimulation& defaultBatch);
+	~Sweep() { finish(); }
+	TiXmlElement* toXML(void);
+
+	// what is wrong with the sweep, or an empty string if it can be run
+	string check(void);
+
+	// run the sweep on all cores, writing results to a table in filename
+	bool start(const char* filename);
+	void process(void);
+	void finish(void);
+	void saveManifest(void);
+
+	// place the points of the design, from runSeed
+	void makeDesign(void);
+
+	// make the batch at a point of the design, for running on a worker thread
+	BatchSimulation* makeBatch(t_int point);
+
+	// start the results table in a file, and add the results of a point to it
+	bool openResults(const char* resultsFile);
+	void writeResults(t_int point, const BatchStatistics& s, t_int nTrialsRun);
+
+	// batch that is varied, parameters & design
+	BatchSimulation batch;
+	vector<SweepParameter> parameters;
+	t_int design, nPoints;
+
+	// master seed, from which each batch gets its own - 0 picks a new one for each run, kept in runSeed
+	t_int seed, runSeed;
+
+	// points done so far
+	t_int pointsDone;
+
+	// which file to save results in?
+	char filename[FL_PATH_MAX];
+
+private:
+	// place of each point in the space of the parameters, from 0 to 1, at [point * parameters + parameter]
+	vector<t_float> points;
+
+	// results table
+	FILE* file;
+	FileWriter* out;
+};
+
+void SweepProcess(void* data);
+
+#endif
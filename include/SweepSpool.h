@@ -0,0 +1,91 @@
+#ifndef __SWEEPSPOOL_H__
+#define __SWEEPSPOOL_H__
+
+#include "Prefix.h"
+#include "Sweep.h"
+#include "Checkpoint.h"
+#include "Throughput.h"
+#include <string>
+
+using namespace std;
+
+// points of a sweep in each unit of work
+#define SWEEP_UNIT_POINTS 8
+
+// how often a worker renews its claim, and how long a claim that isn't renewed is kept before its unit is put back
+// to be run again, in seconds
+#define SWEEP_CLAIM_RENEWAL 60
+#define SWEEP_CLAIM_TIMEOUT 600
+
+// SweepSpool - a sweep split into units of work in a directory, so that it can be run by any number of Laputa
+// processes, on one computer or on several that share the directory. The directory holds the sweep and the society it
+// is run on, and the units, which move from todo/ to claimed/ to done/:
+//
+//   sweep          the sweep, with its seed fixed, and the society
+//   todo/unitN     units not yet taken by a worker
+//   claimed/unitN.id   units being run by the worker with that id
+//   done/unitN     statistics of every point in a finished unit
+//
+// A worker claims a unit by renaming it, which only one worker can do, and writes its results in place in the same
+// way, so no locks are needed. The worker that finishes the last unit merges the results into results.txt, with a line
+// for each point in order, as a sweep run in one go would have written them. Every point is seeded from the seed of
+// the sweep, so results don't depend on which worker ran it.
+//
+// A worker renews its claim every SWEEP_CLAIM_RENEWAL seconds while it runs the unit. A claim that hasn't been renewed
+// for SWEEP_CLAIM_TIMEOUT seconds belonged to a worker that died, and is moved back to todo/ by the next worker that
+// finds nothing left to claim. Workers with nothing left to claim wait while others still hold claims, so that the
+// spool is finished even if they die.
+//
+// While it runs, a worker writes a line to stderr every few seconds with its throughput, the time the whole spool has
+// left at the rate units are being done by all workers, and its memory use.
+
+class SweepSpool {
+public:
+	SweepSpool(const char* dir);
+	~SweepSpool() { if(sweep) delete sweep; }
+
+	// split a sweep into units of work, in a directory that must not exist yet
+	bool create(Sweep& sw, Society* soc);
+
+	// read the sweep back, making its society the current one
+	bool open(void);
+
+	// claim a unit of work, returning -1 if there are none left, and run it on all cores
+	t_int claim(void);
+	bool runUnit(t_int unit);
+
+	// put units whose claims have run out back to be claimed again, returning how many there were, and count the
+	// claims still held by other workers
+	t_int requeue(void);
+	t_int claimsHeld(void);
+
+	// how many units are done? The worker that finds them all done & claims the merge writes the results.
+	t_int unitsDone(void);
+	bool claimMerge(void);
+	bool merge(void);
+
+	string dir;
+	Sweep* sweep;
+	t_int nUnits, unitPoints;
+
+private:
+	string unitName(t_int unit) const;
+	string claimName(t_int unit) const;
+	t_int takeUnit(void);
+	void renewClaim(t_int unit);
+	time_t lastRenewal;
+
+	// write how fast the worker goes, and how long the spool has left, every now and then
+	void report(t_int pointsDone);
+	ThroughputMonitor throughput;
+	time_t lastReport;
+
+	// this worker, so that its claims can be told from those of others
+	string id;
+};
+
+// run as a worker of a spool, or merge its results, from the command line. These return the exit code.
+t_int RunSweepWorker(const char* dir);
+t_int MergeSweepSpool(const char* dir);
+
+#endif
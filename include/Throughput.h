@@ -0,0 +1,58 @@
+#ifndef __THROUGHPUT_H__
+#define __THROUGHPUT_H__
+
+#include "Prefix.h"
+#include <string>
+#include <deque>
+#include <chrono>
+
+using namespace std;
+
+// seconds between samples, and seconds of samples that rates are averaged over
+#define THROUGHPUT_SAMPLE_INTERVAL 0.5
+#define THROUGHPUT_WINDOW 10.0
+
+// seconds between lines written by workers run from the command line
+#define THROUGHPUT_REPORT_INTERVAL 10.0
+
+// ThroughputMonitor - how fast a batch, multibatch or sweep is going, from how much work it has done so far, sampled
+// every now and then. Work is counted in inquirer-steps (a step of one inquirer), link-visits (a step of one link) and
+// trials, and rates are averaged over the last few seconds, so that a setup that is slow shows at once. Progress is
+// counted in units of whatever the run is made of - trials of a batch, points of a multibatch - to tell how long is
+// left.
+
+class ThroughputMonitor {
+public:
+	ThroughputMonitor() { start(0); }
+
+	// start over, with the number of units of the run - it is counted from the first update
+	void start(long long totalUnits);
+
+	// units of the run, which may grow, e.g. as a multibatch refines its grid
+	long long total;
+
+	// record the work done so far, if it is time for a sample - returns true if a sample was taken
+	bool update(long long unitsDone, long long trials, long long inquirerSteps, long long linkVisits);
+
+	// rates per second, & seconds left, or -1 if that can't be told yet
+	double inquirerStepsPerSecond, linkVisitsPerSecond, trialsPerSecond, secondsLeft;
+
+	// the rates, time left & memory in use, on one line
+	string describe(void) const;
+
+private:
+	class Sample {
+	public:
+		double t;
+		long long units, trials, inquirerSteps, linkVisits;
+	};
+
+	chrono::steady_clock::time_point startTime;
+	deque<Sample> samples;
+};
+
+// bytes of memory the program has in use, and in the computer, or 0 if that can't be told
+long long CurrentMemoryUse(void);
+long long PhysicalMemory(void);
+
+#endif
@@ -2,6 +2,8 @@
 #define __TOPOLOGY_H__
 
 #include "Society.h"
+#include "FileWriter.h"
+#include "Checkpoint.h"
 
 #define WTS_NONE 0
 #define WTS_LISTEN_CHANCE 1
@@ -34,11 +36,57 @@ class NetworkTopology {
 public:
     NetworkTopology() {}
 	NetworkTopology(Society* s);
-	string description(float minListenChance, t_int weights);
+	void write(FileWriter& w, float minListenChance, t_int weights) const;
 
 	vector<NetworkNode> nodes;
 	vector<NetworkEdge> edges;
 };
 
+// structure (positions & arcs) shared by any number of recorded topologies
+class TopologyStructure {
+public:
+	bool operator==(const TopologyStructure& ts) const { return nArcs == ts.nArcs && positions == ts.positions && arcs == ts.arcs; }
+
+	vector<float> positions;		// x, y for each node
+	vector<unsigned char> arcs;		// (target, source) pairs, delta & varint encoded in link map order
+	t_int nArcs;
+	unsigned long long hash;
+};
+
+// edge weights, only stored once for any number of trials having identical weights
+class TopologyWeights {
+public:
+	bool operator==(const TopologyWeights& tw) const { return listenChance == tw.listenChance && expTrust == tw.expTrust; }
+
+	vector<float> listenChance, expTrust;
+	unsigned long long hash;
+};
+
+// compact store of topologies recorded during a batch simulation
+class TopologyStore {
+public:
+	void clear(void);
+	void reserve(t_int n) { records.reserve(n); }
+	void add(Society* s);
+	t_int size(void) const { return records.size(); }
+	t_int nStructures(void) const { return structures.size(); }
+	t_int nWeights(void) const { return weights.size(); }
+	NetworkTopology topology(t_int i) const;
+	void write(t_int i, FileWriter& w, float minListenChance, t_int wts) const { topology(i).write(w, minListenChance, wts); }
+
+	// write everything to a checkpoint, and read it back
+	void saveCheckpoint(CheckpointFile& f) const;
+	void loadCheckpoint(CheckpointFile& f);
+
+private:
+	t_int findOrAddStructure(TopologyStructure& ts);
+	t_int findOrAddWeights(TopologyWeights& tw);
+
+	vector<TopologyStructure> structures;
+	vector<TopologyWeights> weights;
+	vector<pair<t_int, t_int> > records;	// structure & weights index for each recorded topology
+	multimap<unsigned long long, t_int> structureIndex, weightsIndex;
+};
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,93 @@
+#ifndef __UNDOJOURNAL_H__
+#define __UNDOJOURNAL_H__
+
+#include "Prefix.h"
+#include "Society.h"
+#include <deque>
+#include <set>
+
+using namespace std;
+
+// max number of edits to keep
+#define MAX_UNDOS 32
+
+// if an edit touches more than this fraction of inquirers & links, store a checkpoint of the whole society instead
+#define UNDO_CHECKPOINT_FRACTION 0.5
+
+// UndoStep - the inquirers and links that differ between two neighbouring states of the society. The step always
+// holds the values of the state that is not current, so applying it twice returns to where we started.
+
+class UndoStep {
+public:
+	UndoStep() { checkpoint = 0; }
+	~UndoStep() { if (checkpoint) delete checkpoint; }
+
+	// number of inquirers in the other state
+	t_int nPeople;
+
+	// inquirers & links as they are in the other state
+	vector<pair<t_int, Inquirer> > people;
+	vector<pair<unsigned t_int, Link> > links;
+
+	// links that exist in the current state but not in the other
+	vector<unsigned t_int> absentLinks;
+
+	// the whole other state, for edits that touch most of the society
+	Society* checkpoint;
+};
+
+// UndoJournal - keeps a list of edits to the society. Only inquirers and links that actually changed are stored,
+// so memory use and time to undo depend on the size of the edit rather than the size of the society.
+//
+// Edits note the inquirers & links they are about to change, and only those are compared when the edit is recorded.
+// The whole society is compared when nothing was noted, or when its generation has moved on since it was last in
+// step with the journal other than by noted edits - as when it is replaced or simulated.
+
+class UndoJournal {
+public:
+	UndoJournal() { cur = 0; generation = 0; untracked = false; }
+	~UndoJournal() { clear(); }
+
+	// start a new journal from the given society
+	void reset(const Society& s);
+
+	// note inquirers & links of the society that are about to be changed. Adding or removing a link changes its
+	// source & target as well, and a new inquirer is noted by the index it will have.
+	void touchInquirer(const Society& s, t_int i);
+	void touchInquirers(const Society& s, const set<t_int>& inqs);
+	void touchLink(const Society& s, t_int source, t_int target);
+	void touchLinks(const Society& s, const set<pair<t_int, t_int> >& lnks);
+
+	// record the difference between the last recorded state and the society. Returns false if nothing changed.
+	bool record(const Society& s);
+
+	// move through the journal, updating the society
+	bool canUndo(void) const { return cur > 0; }
+	bool canRedo(void) const { return cur < steps.size(); }
+	void undo(Society& s);
+	void redo(Society& s);
+
+private:
+	void clear(void);
+	void apply(UndoStep* step, Society& s);
+	void compareAll(const Society& s, UndoStep* step);
+	void compareTouched(const Society& s, UndoStep* step);
+	void forget(const Society& s);
+
+	// state of the society at the current position in the journal, and the generation of the society when it was
+	// last the same
+	Society state;
+	unsigned long long generation;
+
+	// what has been noted since then, and whether any of it was noted after the society had changed otherwise
+	set<t_int> touchedPeople;
+	set<unsigned t_int> touchedLinks;
+	bool untracked;
+
+	// list of edits, and number of edits currently applied
+	deque<UndoStep*> steps;
+	t_int cur;
+};
+
+
+#endif
@@ -33,7 +33,9 @@
 #include "ToolButton.h"
 #include "Distribution.h"
 #include "MultiBatch.h"
+#include "Sweep.h"
 #include "ExpressionField.h"
+#include "Throughput.h"
 
 
 #include <deque>
@@ -63,7 +65,8 @@
 #define DIALOG_EXPRESSION 22
 #define DIALOG_EXPORT_STATISTICS 23
 #define DIALOG_EXPORT_TOPOLOGY 24
-#define N_DIALOG_TYPES 24
+#define DIALOG_SWEEP_PROGRESS 25
+#define N_DIALOG_TYPES 25
 
 class SocietyView;
 class DistributionView;
@@ -325,8 +328,10 @@ public:
 	ProgressWindow(t_int W, t_int H, const char* l = 0) : DialogInterface(W, H, l) {progressWindow = this;}
 
 	Fl_Progress *barProgress = nullptr;
+	Fl_Box *boxThroughput = nullptr;
 
 	BatchSimulation *bs = nullptr;
+	ThroughputMonitor throughput;
 };
 
 // Statistics dialog
@@ -338,6 +343,8 @@ public:
 	void computeConfidences(t_float level);
 	void exportStatistics(void);
 	void setDiagramView(t_int v);
+	void replayTrial(void);
+	void showProfile(void);
 
 	Fl_Box* boxDiagramXValue[5] = { nullptr, nullptr, nullptr, nullptr, nullptr };
 	Fl_Box* boxDiagramYValue[5] = { nullptr, nullptr, nullptr, nullptr, nullptr };
@@ -354,6 +361,7 @@ public:
 
 	Fl_Output *outputNumSocieties = nullptr;
 	Fl_Output *outputNumSteps = nullptr;
+	Fl_Output *outputSeed = nullptr;
 
 	Fl_Choice *choiceConfidenceLevel = nullptr;
 
@@ -369,6 +377,8 @@ public:
 
 	Fl_Button *buttonExportEValues = nullptr;
 	Fl_Button *buttonExportTopologies = nullptr;
+	Fl_Button *buttonReplayTrial = nullptr;
+	Fl_Button *buttonProfile = nullptr;
 	Fl_Choice *choiceDiagramView = nullptr;
 
 	BatchSimulation* bsShown = nullptr;
@@ -486,6 +496,9 @@ public:
 	void loadMultibatch(void);
 	void saveMultibatch(void);
 
+	// show how much memory & time the multibatch will take
+	void showEstimate(void);
+
 	Fl_Spinner* inputStepsAtoB = nullptr;
 	Fl_Spinner* inputStepsAtoC = nullptr;
 
@@ -500,6 +513,13 @@ public:
 	Fl_Button* btnCopyBatch[8] = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
 
 	Fl_Button* btnPreview = nullptr;
+	Fl_Button* btnEstimate = nullptr;
+
+	Fl_Check_Button* btnRefine = nullptr;
+	Fl_Value_Input* inputRefineThreshold = nullptr;
+	Fl_Spinner* inputRefineBudget = nullptr;
+	Fl_Check_Button* btnCommonRandomNumbers = nullptr;
+	Fl_Check_Button* btnAntithetic = nullptr;
 
 	MultiBatch* mbEdited = nullptr;
 	MultiBatch mb;
@@ -513,8 +533,11 @@ public:
 
 	Fl_Progress *barProgress = nullptr;
 	Fl_Output *outputSecondProgress = nullptr;
+	Fl_Box *boxThroughput = nullptr;
 
 	MultiBatch *mb = nullptr;
+	Sweep *sweep = nullptr;
+	ThroughputMonitor throughput;
 };
 
 // Window for showing data about degree distribution
@@ -11,10 +11,12 @@
 
 #include "UserInterfaceItems.h"
 #include "Utility.h"
+#include "Random.h"
+#include "SweepSpool.h"
 
 // global variables
 App *app;
-gsl_rng *rng;
+thread_local gsl_rng *rng;
 
 
 //-----------------------------------------------------------------------------------------------------------------------
@@ -28,8 +30,7 @@ App::App(t_int argc, char** argv, const string& inDataPath, const string& inDocs
   Fl::visual(FL_DOUBLE|FL_INDEX);
 
 	// create general random number generator
-	rng = gsl_rng_alloc(gsl_rng_taus);
-	gsl_rng_set(rng, clock());
+	UseRandomGenerator(RANDOM_GENERATOR_XOSHIRO);
 
   // set window icons
   Fl_Window::default_icon(new Fl_PNG_Image(app->dataFile("laputa.png").c_str()));
@@ -316,6 +317,124 @@ void App::saveSocietyAs(void) {
 
 //-----------------------------------------------------------------------------------------------------------------------
 
+bool App::openSweep(void) {
+	string sweepFile = OpenFileDialog("Open Sweep", "*.sweep");
+	if (sweepFile == "") return false;
+
+	// open the file
+	TiXmlDocument f(sweepFile.c_str());
+	if(!f.LoadFile()) {
+		fl_alert("Failed to load sweep file.");
+		return false;
+	}
+	TiXmlElement *root = f.RootElement();
+	if(strcmp("SWEEP_FILE", root->Value()) || !root->FirstChildElement("SWEEP")) {
+		fl_alert("This is not a valid sweep file.");
+		return false;
+	}
+	t_int vers = 0;
+	root->QueryIntAttribute("VERSION", &vers);
+	if(vers < MIN_LAPUTA_VERSION) {
+		fl_alert("This sweep was created with a different version of Laputa.");
+		return false;
+	}
+
+	// read sweep, varying the current batch if it has none of its own
+	if(curSweep) delete curSweep;
+	curSweep = new Sweep(root->FirstChildElement("SWEEP"), curBatchSimulation);
+	string problem = curSweep->check();
+	if(problem != "") {
+		fl_alert("%s", problem.c_str());
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void App::runSweep(void) {
+	if(!openSweep()) return;
+
+	// run it
+	string filename = SaveFileDialog("Save Results As", "*.txt", "Untitled.txt");
+	if (filename != "") {
+		char absName[FL_PATH_MAX];
+		fl_filename_absolute(absName, FL_PATH_MAX, filename.c_str());
+		if(!curSweep->start(absName)) fl_alert("Could not write to file %s.", absName);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void App::shardSweep(void) {
+	if(!openSweep()) return;
+
+	// split it into units of work in a spool directory, to be run by workers started from the command line
+	string filename = SaveFileDialog("Save Spool As", "*.spool", "Untitled.spool");
+	if (filename == "") return;
+	char absName[FL_PATH_MAX];
+	fl_filename_absolute(absName, FL_PATH_MAX, filename.c_str());
+	SweepSpool spool(absName);
+	if(!spool.create(*curSweep, curSociety)) fl_alert("Could not make the spool %s. It must be a directory that does not exist yet.", absName);
+	else fl_message("The sweep has been split into %d units of work. Run them with\n\nlaputa -worker \"%s\"\n\non as many computers as you like. The results are written to results.txt in the spool when all units are done.", spool.nUnits, absName);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void App::resumeRun(void) {
+	if(!fileSaved) {
+		// Ask if we should save file first
+		t_int r = fl_choice("Current society has not been saved.\n"
+                    "Would you like to save it now?",
+                    "Cancel", "Save", "Don't Save");
+
+		if (r == 1) saveSociety();
+		else if(r == 2) fileSaved = true;
+		else if(r == 0) return;
+	}
+	if(!fileSaved) return;
+
+	string filename = OpenFileDialog("Resume From Checkpoint", "*.checkpoint");
+	if (filename == "") return;
+	char absName[FL_PATH_MAX];
+	fl_filename_absolute(absName, FL_PATH_MAX, filename.c_str());
+	CheckpointFile f;
+	if(!f.open(absName) || f.kind > CHECKPOINT_MULTIBATCH || !f.society()) {
+		fl_alert("This is not a checkpoint saved by this version of Laputa.");
+		return;
+	}
+
+	// the society the run was started from
+	delete curSociety;
+	curSociety = new Society;
+	curSociety->fromXML(f.society());
+	currentFile[0] = 0;
+	resetUndo();
+	societyWindow->view->updateStatistics();
+	societyWindow->view->deselectAll();
+	curSimulation.reset();
+	societyWindow->view->setZoomToFit();
+	societyWindow->view->redraw();
+
+	// carry on from where it stopped
+	if(f.kind == CHECKPOINT_BATCH) {
+		curBatchSimulation = BatchSimulation(f.runSettings());
+		curBatchSimulation.checkpoint = true;
+		curBatchSimulation.checkpointFile = absName;
+		if(curBatchSimulation.resume(f)) StartBatchSimulation(&curBatchSimulation, true);
+		else fl_alert("Could not read the progress saved in %s.", absName);
+	}
+	else if(f.kind == CHECKPOINT_MULTIBATCH) {
+		curMultiBatch = MultiBatch(f.runSettings());
+		const char* results = f.runSettings()->Attribute("RESULTS");
+		strcpy(curMultiBatch.filename, results ? results : "");
+		if(results && curMultiBatch.resume(f)) StartMultiBatchSimulation(&curMultiBatch, true);
+		else fl_alert("Could not read the progress saved in %s.", absName);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
 void App::quit(void) {
 	if(!fileSaved) {
 		// Ask if we should save file first
@@ -381,26 +500,8 @@ string App::dataFile(const char* filename) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void App::touchFile(void) {
-	// has an actual change occurred?
-	if (*undos[curUndoIndex] == *curSociety) return;
-
-	++curUndoIndex;
-	if (curUndoIndex == MAX_UNDOS) {
-		// move stuff in undo list if necessary
-		delete undos[0];
-		for (size_t i = 1; i < MAX_UNDOS; ++i) undos[i - 1] = undos[i];
-		--curUndoIndex;
-	}
-	else {
-		// delete undos after this one
-		for (t_int i = curUndoIndex; i < undos.size(); ++i) delete undos[i];
-
-		// expand undo list
-		undos.resize((size_t)curUndoIndex + 1);
-	}
-
-	// store society
-	undos[curUndoIndex] = new Society(*curSociety);
+	// store changes, if an actual change has occurred
+	if (!undos.record(*curSociety)) return;
 	fileSaved = false;
 
 	// update menus
@@ -412,15 +513,13 @@ void App::touchFile(void) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void App::doUndo(void) {
-	if (curUndoIndex > 0) {
+	if (undos.canUndo()) {
 		// do the undo
-		--curUndoIndex;
-		delete curSociety;
-		curSociety = new Society(*undos[curUndoIndex]);
+		undos.undo(*curSociety);
 
 		// update menus
 		t_int uidx = societyWindow->menuBar->find_index("Edit/Undo"), ridx = societyWindow->menuBar->find_index("Edit/Redo");
-		if (curUndoIndex == 0) societyWindow->menuBar->mode(uidx, societyWindow->menuBar->mode(uidx) | FL_MENU_INACTIVE);
+		if (!undos.canUndo()) societyWindow->menuBar->mode(uidx, societyWindow->menuBar->mode(uidx) | FL_MENU_INACTIVE);
 		societyWindow->menuBar->mode(ridx, societyWindow->menuBar->mode(ridx) & ~FL_MENU_INACTIVE);
 
 		// update everything else
@@ -436,15 +535,14 @@ void App::doUndo(void) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void App::doRedo(void) {
-	if (curUndoIndex < undos.size() - 1) {
-		// do the undo
-		++curUndoIndex;
-		curSociety = new Society(*undos[curUndoIndex]);
+	if (undos.canRedo()) {
+		// do the redo
+		undos.redo(*curSociety);
 
 		// update menus
 		t_int uidx = societyWindow->menuBar->find_index("Edit/Undo"), ridx = societyWindow->menuBar->find_index("Edit/Redo");
 		societyWindow->menuBar->mode(uidx, societyWindow->menuBar->mode(uidx) &  ~FL_MENU_INACTIVE);
-		if (curUndoIndex == undos.size()) societyWindow->menuBar->mode(ridx, societyWindow->menuBar->mode(ridx) | FL_MENU_INACTIVE);
+		if (!undos.canRedo()) societyWindow->menuBar->mode(ridx, societyWindow->menuBar->mode(ridx) | FL_MENU_INACTIVE);
 
 		// update everything else
 		curSociety->recalculateListeners();
@@ -458,10 +556,7 @@ void App::doRedo(void) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void App::resetUndo(void) {
-	for (t_int i = 0; i < undos.size(); ++i) delete undos[i];
-	undos.resize(1);
-	undos[0] = new Society(*curSociety);
-	curUndoIndex = 0;
+	undos.reset(*curSociety);
 	t_int uidx = societyWindow->menuBar->find_index("Edit/Undo"), ridx = societyWindow->menuBar->find_index("Edit/Redo");
 	societyWindow->menuBar->mode(uidx, societyWindow->menuBar->mode(uidx) | FL_MENU_INACTIVE);
 	societyWindow->menuBar->mode(ridx, societyWindow->menuBar->mode(ridx) | FL_MENU_INACTIVE);
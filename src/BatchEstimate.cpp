@@ -0,0 +1,273 @@
+#include "BatchEstimate.h"
+#include "Ensemble.h"
+#include "Throughput.h"
+#include "Random.h"
+#include "App.h"
+#include <thread>
+#include <chrono>
+#include <limits.h>
+#include <stdio.h>
+
+using namespace std::chrono;
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+BatchEstimate::BatchEstimate() {
+	eValueBytes = topologyBytes = societyBytes = 0;
+	long long memory = PhysicalMemory();
+	budget = (long long)((memory > 0 ? memory : ESTIMATE_DEFAULT_MEMORY) * ESTIMATE_MEMORY_FRACTION);
+	minSeconds = seconds = -1;
+	calibrationTrials = 0;
+	suggestion = false;
+	suggestedTimePerEValue = suggestedSocietiesPerEValue = 0;
+	multibatch = false;
+	nThreads = 1;
+	nPoints = nTrials = 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+long long BatchEstimate::bytesPerSociety(t_int people, t_int links) {
+	// links are kept in a tree, with a few pointers besides each
+	return (long long)sizeof(Society) + (long long)people * sizeof(Inquirer) + (long long)links * (sizeof(LinkMap::value_type) + 4 * sizeof(void*));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+double BatchEstimate::calibrate(const BatchSimulation& bs, const Society& templateSociety, double calibrationTime, t_int& maxPeople, t_int& maxLinks) {
+	// the batch as it would be run by a worker, recording nothing
+	BatchSimulation cal;
+	cal = bs;
+	if(cal.templateSociety) delete cal.templateSociety;
+	cal.templateSociety = new Society(templateSociety);
+	cal.background = true;
+	cal.displayResults = false;
+	cal.adaptive = false;
+	cal.checkpoint = false;
+	cal.stats.recordEValueStats = cal.stats.recordTopologies = false;
+	cal.sim.logLevel = LOG_NONE;
+	t_int totalSteps = cal.totalSteps();
+
+	// run it on a thread of its own, so that it has its own dice & current society, and leaves ours as they were
+	double trials = 0, elapsed = 0;
+	thread t([&]() {
+		UseRandomGenerator(cal.sim.randomGenerator);
+		cal.setupTrials();
+		cal.curTrial = cal.curStage = cal.sim.curStep = 0;
+		steady_clock::time_point start = steady_clock::now();
+		while(!cal.nTrialsRun && elapsed < calibrationTime) {
+			cal.advance();
+			if(curSociety) {
+				if(curSociety->people.size() > maxPeople) maxPeople = curSociety->people.size();
+				if(curSociety->links.size() > maxLinks) maxLinks = curSociety->links.size();
+			}
+			elapsed = duration<double>(steady_clock::now() - start).count();
+		}
+		trials = cal.trialsDone();
+
+		// trials still running side by side belong to this thread
+		if(cal.ensemble) delete cal.ensemble;
+		cal.ensemble = 0;
+		delete curSociety;
+		curSociety = 0;
+		if(rng) gsl_rng_free(rng);
+		rng = 0;
+	});
+	t.join();
+
+	calibrationTrials += trials;
+	return trials > 0 ? elapsed / trials : -1;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchEstimate::estimate(const BatchSimulation& bs, bool showResults, double calibrationTime) {
+	// a batch is always run from the current society
+	BatchSimulation b;
+	b = bs;
+	if(b.templateSociety) delete b.templateSociety;
+	b.templateSociety = new Society(*curSociety);
+	multibatch = false;
+	nThreads = nPoints = 1;
+	nTrials = b.nTrials;
+
+	// size of the largest society, from the template or the setup, until trials show it
+	t_int n = b.maxInquirers();
+	t_int maxPeople = n, maxLinks = 0;
+	if(curSociety->people.size() > 0) maxLinks = (t_int)((long long)curSociety->links.size() * n / curSociety->people.size());
+	calibrationTrials = 0;
+	double perTrial = calibrationTime > 0 ? calibrate(b, *curSociety, calibrationTime, maxPeople, maxLinks) : -1;
+	seconds = perTrial >= 0 ? perTrial * b.nTrials : -1;
+	minSeconds = perTrial >= 0 && b.adaptive ? perTrial * (b.minTrials < b.nTrials ? b.minTrials : b.nTrials) : seconds;
+
+	// societies alive at once - the template, the current one, and a row of an ensemble
+	societyBytes = (ENSEMBLE_WIDTH + 2) * bytesPerSociety(maxPeople, maxLinks);
+
+	// topologies, at most, if no two share their structure or weights
+	topologyBytes = 0;
+	if(showResults && b.stats.recordTopologies) {
+		topologyBytes = (long long)(b.nTrials / b.stats.societiesPerTopology) * (8LL * maxPeople + 7LL * maxLinks + 64);
+	}
+
+	// e-values over time, as they are set up for the trials
+	t_int T = b.totalSteps(), N = b.nTrials;
+	eValueBytes = 0;
+	if(showResults && b.stats.recordEValueStats) {
+		eValueBytes = (long long)n * ((T + 1) / b.stats.timePerEValueStat) * (N / b.stats.societiesPerEValueStat) * sizeof(float);
+	}
+
+	// Record e-values less often until they fit what's left of the budget - and the size of a statistics block -
+	// stretching the shorter of the two intervals first
+	suggestion = false;
+	suggestedTimePerEValue = b.stats.timePerEValueStat;
+	suggestedSocietiesPerEValue = b.stats.societiesPerEValueStat;
+	long long eValueBudget = budget - topologyBytes - societyBytes;
+	if(eValueBudget > (long long)INT_MAX * sizeof(float)) eValueBudget = (long long)INT_MAX * sizeof(float);
+	if(eValueBytes > eValueBudget) {
+		suggestion = true;
+		t_int maxT = T < ESTIMATE_MAX_RECORD_INTERVAL ? T : ESTIMATE_MAX_RECORD_INTERVAL;
+		t_int maxS = N < ESTIMATE_MAX_RECORD_INTERVAL ? N : ESTIMATE_MAX_RECORD_INTERVAL;
+		t_int& t = suggestedTimePerEValue, &s = suggestedSocietiesPerEValue;
+		while((long long)n * ((T + 1) / t) * (N / s) * sizeof(float) > eValueBudget) {
+			bool moreT = t < maxT, moreS = s < maxS;
+			if(moreT && (t <= s || !moreS)) t = t * 2 < maxT ? t * 2 : maxT;
+			else if(moreS) s = s * 2 < maxS ? s * 2 : maxS;
+			else {
+				t = s = 0;
+				break;
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchEstimate::estimate(MultiBatch& mb, double calibrationTime) {
+	multibatch = true;
+	nThreads = thread::hardware_concurrency() > 1 ? thread::hardware_concurrency() : 1;
+	nPoints = mb.stepsAtoB * (mb.stepsAtoC > 1 ? mb.stepsAtoC : 1);
+	if(mb.refine) nPoints += mb.refineBudget;
+
+	// batches at the corners & centre of the grid, or the ends & middle of a line
+	vector<pair<t_float, t_float> > probes;
+	probes.push_back(make_pair(0.0, 0.0));
+	probes.push_back(make_pair(1.0, 0.0));
+	if(mb.stepsAtoC > 1) {
+		probes.push_back(make_pair(0.0, 1.0));
+		probes.push_back(make_pair(1.0, 1.0));
+		probes.push_back(make_pair(0.5, 0.5));
+	}
+	else probes.push_back(make_pair(0.5, 0.0));
+
+	// time each of them, from the current society as the multibatch is started, and take the largest society any of
+	// them makes
+	const Society& tmpl = *curSociety;
+	double total = 0, minTotal = 0;
+	t_int nTimed = 0, maxPeople = 0, maxLinks = 0;
+	nTrials = 0;
+	calibrationTrials = 0;
+	for(t_int i = 0; i < probes.size(); ++i) {
+		BatchSimulation b;
+		mb.interpolateBatch(b, probes[i].first, probes[i].second);
+		if(b.templateSociety) delete b.templateSociety;
+		b.templateSociety = new Society(tmpl);
+		if(b.nTrials > nTrials) nTrials = b.nTrials;
+		t_int n = b.maxInquirers();
+		if(n > maxPeople) maxPeople = n;
+		if(tmpl.people.size() > 0) {
+			t_int l = (t_int)((long long)tmpl.links.size() * n / tmpl.people.size());
+			if(l > maxLinks) maxLinks = l;
+		}
+		if(calibrationTime <= 0) continue;
+		double perTrial = calibrate(b, tmpl, calibrationTime / probes.size(), maxPeople, maxLinks);
+		if(perTrial < 0) continue;
+		total += perTrial * b.nTrials;
+		minTotal += perTrial * (b.adaptive && b.minTrials < b.nTrials ? b.minTrials : b.nTrials);
+		++nTimed;
+	}
+
+	// points are shared out among the cores
+	seconds = minSeconds = -1;
+	if(nTimed > 0) {
+		seconds = total / nTimed * nPoints / nThreads;
+		minSeconds = minTotal / nTimed * nPoints / nThreads;
+	}
+
+	// Multibatches keep nothing but a line of results for each point, so what they need is the societies of each
+	// worker, and the batches at the corners
+	eValueBytes = topologyBytes = 0;
+	societyBytes = ((long long)nThreads * (ENSEMBLE_WIDTH + 2) + 6) * bytesPerSociety(maxPeople, maxLinks);
+	suggestion = false;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchEstimate::applySuggestion(BatchSimulation& bs) const {
+	if(!suggestion) return;
+	if(suggestedTimePerEValue == 0) bs.stats.recordEValueStats = false;
+	else {
+		bs.stats.timePerEValueStat = suggestedTimePerEValue;
+		bs.stats.societiesPerEValueStat = suggestedSocietiesPerEValue;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+// bytes in kB, MB or GB
+static string ShortBytes(long long b) {
+	char s[32];
+	if(b >= (1LL << 30)) sprintf(s, "%.1f GB", (double)b / (1LL << 30));
+	else if(b >= (1LL << 20)) sprintf(s, "%.1f MB", (double)b / (1LL << 20));
+	else sprintf(s, "%lld kB", (b + 1023) >> 10);
+	return string(s);
+}
+
+// seconds as h:mm:ss or m:ss
+static string ShortTime(double seconds) {
+	char s[32];
+	long long t = (long long)(seconds + 0.5);
+	if(t >= 3600) sprintf(s, "%lld:%02lld:%02lld", t / 3600, (t / 60) % 60, t % 60);
+	else sprintf(s, "%lld:%02lld", t / 60, t % 60);
+	return string(s);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+string BatchEstimate::describe(void) const {
+	string d;
+	char line[256];
+
+	// memory
+	sprintf(line, "Memory:  %s, of %s that may be used\n", ShortBytes(totalBytes()).c_str(), ShortBytes(budget).c_str());
+	d += line;
+	if(!multibatch) {
+		sprintf(line, "  e-values over time   %s\n  topologies           %s\n", ShortBytes(eValueBytes).c_str(), ShortBytes(topologyBytes).c_str());
+		d += line;
+	}
+	sprintf(line, "  societies            %s\n", ShortBytes(societyBytes).c_str());
+	d += line;
+
+	// time
+	if(seconds < 0) d += "Time:    not known\n";
+	else {
+		if(minSeconds < seconds) sprintf(line, "Time:    %s to %s", ShortTime(minSeconds).c_str(), ShortTime(seconds).c_str());
+		else sprintf(line, "Time:    %s", ShortTime(seconds).c_str());
+		d += line;
+		if(multibatch) sprintf(line, " for %d points on %d cores\n", (int)nPoints, (int)nThreads);
+		else sprintf(line, " for %d trials\n", (int)nTrials);
+		d += line;
+		sprintf(line, "         from %.1f trials timed\n", calibrationTrials);
+		d += line;
+	}
+
+	// what to change
+	if(suggestion) {
+		if(suggestedTimePerEValue == 0) d += "\nE-values over time won't fit - turn recording them off.";
+		else {
+			sprintf(line, "\nSuggested: record e-values for every %d societies, every %d time steps.", (int)suggestedSocietiesPerEValue, (int)suggestedTimePerEValue);
+			d += line;
+		}
+	}
+	else if(!fits()) d += "\nThis will need more memory than should be used.";
+	return d;
+}
@@ -0,0 +1,160 @@
+#include "BatchScheduler.h"
+#include "Society.h"
+#include "Random.h"
+#include "App.h"
+
+BatchScheduler batchScheduler;
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchScheduler::start(t_int n, function<BatchSimulation*(t_int)> make) {
+	stop();
+	makeBatch = make;
+	nBatches = n;
+	nextBatch = nFinished = 0;
+	quit = false;
+
+	t_int nThreads = thread::hardware_concurrency() > 1 ? thread::hardware_concurrency() : 1;
+	for(t_int k = 0; k < nThreads; ++k) threads.push_back(thread(&BatchScheduler::worker, this));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchScheduler::stop(void) {
+	{
+		lock_guard<mutex> g(lock);
+		quit = true;
+	}
+	for(t_int k = 0; k < threads.size(); ++k) threads[k].join();
+	threads.clear();
+
+	// throw away whatever was not taken
+	for(t_int i = 0; i < open.size(); ++i) {
+		delete open[i]->bs;
+		delete open[i];
+	}
+	open.clear();
+	for(t_int i = 0; i < done.size(); ++i) {
+		delete done[i]->bs;
+		delete done[i];
+	}
+	done.clear();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int BatchScheduler::takeFinished(BatchSimulation*& bs) {
+	lock_guard<mutex> g(lock);
+	if(done.empty()) return -1;
+	ScheduledBatch* b = done.front();
+	done.erase(done.begin());
+	t_int index = b->index;
+	bs = b->bs;
+	delete b;
+	return index;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool BatchScheduler::nextPiece(ScheduledBatch*& b, t_int& first, t_int& last) {
+	// earliest batch with trials left to hand out, or else a new one
+	b = 0;
+	for(t_int i = 0; i < open.size() && !b; ++i) if(!open[i]->finished && open[i]->handedOut < open[i]->bs->nTrials) b = open[i];
+	if(!b) {
+		if(nextBatch == nBatches) return false;
+		b = new ScheduledBatch;
+		b->index = nextBatch++;
+		b->bs = makeBatch(b->index);
+		if(!b->bs->seed) b->bs->seed = NewRandomSeed();
+		b->bs->runSeed = b->bs->seed;
+		b->bs->nTrialsRun = 0;
+		b->bs->stats.clearTotals();
+		open.push_back(b);
+	}
+
+	// pieces of an adaptive batch end where it may stop
+	const BatchSimulation& bs = *b->bs;
+	first = b->handedOut;
+	last = first + BATCH_SCHEDULER_PIECE;
+	if(bs.adaptive && first < bs.minTrials && last > bs.minTrials) last = bs.minTrials;
+	if(last > bs.nTrials) last = bs.nTrials;
+	b->handedOut = last;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchScheduler::merge(ScheduledBatch* b, t_int first, t_int last, const BatchStatistics& s) {
+	if(b->finished) return;
+	if(first != b->merged) {
+		b->waiting[first] = pair<t_int, BatchStatistics>(last, s);
+		return;
+	}
+
+	// add this piece, and any after it that are waiting, until the batch is done
+	BatchSimulation& bs = *b->bs;
+	bs.stats.add(s);
+	b->merged = last;
+	for(;;) {
+		bs.curTrial = b->merged;
+		if(b->merged == bs.nTrials || bs.preciseEnough()) {
+			bs.nTrialsRun = b->merged;
+			bs.recordFinalStatistics();
+			b->finished = true;
+			b->waiting.clear();
+			++nFinished;
+			return;
+		}
+		map<t_int, pair<t_int, BatchStatistics>>::iterator w = b->waiting.find(b->merged);
+		if(w == b->waiting.end()) return;
+		bs.stats.add(w->second.second);
+		b->merged = w->second.first;
+		b->waiting.erase(w);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchScheduler::worker(void) {
+	BatchSimulation piece;
+	for(;;) {
+		ScheduledBatch* b;
+		t_int first, last;
+		{
+			lock_guard<mutex> g(lock);
+			if(quit || !nextPiece(b, first, last)) break;
+			piece = *b->bs;
+			++b->running;
+		}
+
+		// run the trials of the piece with dice of the batch's kind
+		UseRandomGenerator(piece.sim.randomGenerator);
+		piece.background = true;
+		piece.displayResults = false;
+		piece.adaptive = false;
+		piece.sim.logLevel = LOG_NONE;
+		piece.setupTrials();
+		piece.curTrial = first;
+		piece.nTrials = last;
+		piece.curStage = piece.sim.curStep = 0;
+		piece.runTrials();
+
+		// add it up, and hand the batch over once it is done and nobody is still running a piece of it
+		lock_guard<mutex> g(lock);
+		--b->running;
+		trialsRun += last - first;
+		inquirerSteps += piece.inquirerSteps;
+		linkVisits += piece.linkVisits;
+		merge(b, first, last, piece.stats);
+		if(b->finished && b->running == 0) {
+			for(t_int i = 0; i < open.size(); ++i) if(open[i] == b) open.erase(open.begin() + i);
+			done.push_back(b);
+		}
+	}
+
+	// this thread's own dice & society
+	delete curSociety;
+	curSociety = 0;
+	if(rng) gsl_rng_free(rng);
+	rng = 0;
+}
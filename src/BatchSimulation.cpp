@@ -1,7 +1,13 @@
 #include "BatchSimulation.h"
+#include "Ensemble.h"
+#include "SimulationThread.h"
 #include "Utility.h"
 #include "FL/fl_ask.H"
 #include "UserInterfaceItems.h"
+#include "App.h"
+#include "Profiler.h"
+#include <gsl/gsl_cdf.h>
+#include <time.h>
 
 //-----------------------------------------------------------------------------------------------------------------------
 
@@ -21,6 +27,7 @@ BatchSimulation::BatchSimulation() {
 //-----------------------------------------------------------------------------------------------------------------------
 
 BatchSimulation::~BatchSimulation() {
+	if(ensemble) delete ensemble;
 	if (templateSociety) delete templateSociety;
 	templateSociety = 0;
 }
@@ -36,7 +43,21 @@ BatchSimulation& BatchSimulation::operator=(const BatchSimulation& bs) {
 	for (t_int i = 0; i < MAX_BATCH_STAGES; ++i) nSteps[i] = bs.nSteps[i];
 	nStages = bs.nStages;
 	curTrial = bs.curTrial;
-	curStage = bs.curStage;
+	curStage = bs.ensemble ? 0 : bs.curStage;
+	if(ensemble) delete ensemble;
+	ensemble = 0;
+	seed = bs.seed;
+	runSeed = bs.runSeed;
+	checkpoint = bs.checkpoint;
+	checkpointFile = bs.checkpointFile;
+	commonRandomNumbers = bs.commonRandomNumbers;
+	antithetic = bs.antithetic;
+	adaptive = bs.adaptive;
+	adaptivePolarisation = bs.adaptivePolarisation;
+	minTrials = bs.minTrials;
+	nTrialsRun = bs.nTrialsRun;
+	targetMargin = bs.targetMargin;
+	confidenceLevel = bs.confidenceLevel;
 	for (t_int i = 0; i < MAX_BATCH_STAGES; ++i) setup[i] = bs.setup[i];
 	if (templateSociety) delete templateSociety;
 	if(bs.templateSociety) templateSociety = new Society(*bs.templateSociety);
@@ -45,6 +66,7 @@ BatchSimulation& BatchSimulation::operator=(const BatchSimulation& bs) {
 	stats = bs.stats;
 	displayResults = bs.displayResults;
 	timeOut = bs.timeOut;
+	background = bs.background;
 	return *this;
 }
 
@@ -84,6 +106,9 @@ BatchSimulation::BatchSimulation(const BatchSimulation& bs1, const BatchSimulati
 	nStages = Round(bs1.nStages * (1.0 - v) + (t_float)bs2.nStages * v);
 	for(t_int i = 0; i < nStages; ++i) nSteps[i] = Round(bs1.nSteps[i] * (1.0 - v) + (t_float)bs2.nSteps[i] * v);
 	nTrials = Round(bs1.nTrials * (1.0 - v) + (t_float)bs2.nTrials * v);
+	minTrials = Round(bs1.minTrials * (1.0 - v) + (t_float)bs2.minTrials * v);
+	targetMargin = bs1.targetMargin * (1.0 - v) + bs2.targetMargin * v;
+	confidenceLevel = bs1.confidenceLevel * (1.0 - v) + bs2.confidenceLevel * v;
 	sim = Simulation(bs1.sim, bs2.sim, v);
 	for(t_int i = 0; i < nStages; ++i) setup[i] = SocietySetup(bs1.setup[i], bs2.setup[i], v);
 	curStage = 0;
@@ -101,6 +126,17 @@ BatchSimulation::BatchSimulation(TiXmlElement* xml) {
 	// read fields
 	xml->QueryIntAttribute("TRIALS", &nTrials);
 	xml->QueryIntAttribute("STAGES", &nStages);
+	xml->QueryIntAttribute("SEED", &seed);
+	if(xml->Attribute("COMMON_RANDOM_NUMBERS") && strcmp(xml->Attribute("COMMON_RANDOM_NUMBERS"), "true") == 0) commonRandomNumbers = true;
+	if(xml->Attribute("ANTITHETIC") && strcmp(xml->Attribute("ANTITHETIC"), "true") == 0) antithetic = true;
+	if(xml->Attribute("ADAPTIVE") && strcmp(xml->Attribute("ADAPTIVE"), "true") == 0) {
+		double v;
+		adaptive = true;
+		xml->QueryIntAttribute("MIN_TRIALS", &minTrials);
+		if(xml->QueryDoubleAttribute("TARGET_MARGIN", &v) == TIXML_SUCCESS) targetMargin = v;
+		if(xml->QueryDoubleAttribute("CONFIDENCE", &v) == TIXML_SUCCESS) confidenceLevel = v;
+		if(xml->Attribute("MARGIN_OF_POLARISATION") && strcmp(xml->Attribute("MARGIN_OF_POLARISATION"), "true") == 0) adaptivePolarisation = true;
+	}
 	xml->QueryIntAttribute("STEPS_0", &nSteps[0]);
 	if(nStages > 1) xml->QueryIntAttribute("STEPS_1", &nSteps[1]);
 	if(nStages > 2) xml->QueryIntAttribute("STEPS_2", &nSteps[2]);
@@ -122,17 +158,18 @@ BatchSimulation::BatchSimulation(TiXmlElement* xml) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void BatchSimulation::setupTrials(void) {
+	// dice are shared, so only change generator when nothing else is rolling them - worker threads have their own
+	if(!background && !simulationThread.isRunning()) UseRandomGenerator(sim.randomGenerator);
+	runSeed = seed ? seed : NewRandomSeed();
+
+	// trials left side by side from an earlier run are dropped
+	if(ensemble) delete ensemble;
+	ensemble = 0;
+
 	// initialise statistics
-	stats.totalEValue = stats.totalEValueDelta = 0;
-	stats.totalEValueS = stats.totalEValueDeltaS = 0;
-	stats.totalPolarisation = stats.totalPolarisationDelta = 0;
-	stats.totalPolarisationS = stats.totalPolarisationDeltaS = 0;
-	stats.avgMessagesSentTotal = stats.avgMessagesSentPerInquirer = 0;
-	stats.avgInquiryResultsTotal = stats.avgInquiryResultsPerInquirer = 0;
-	stats.avgBWToPEffect = stats.avgBWToNotPEffect = stats.avgBWToPProb = stats.avgBWToNotPProb = 0;
-    
-	// clean degree lists
-	for (t_int i = 0; i < 3; ++i) stats.degrees[i].clear();
+	nTrialsRun = 0;
+	inquirerSteps = linkVisits = 0;
+	stats.clearTotals();
 	
 	// make block for eValue results
 	if (displayResults && stats.recordEValueStats) {
@@ -169,150 +206,495 @@ t_int BatchSimulation::maxInquirers(void) {
 
 //-----------------------------------------------------------------------------------------------------------------------
 
-void BatchSimulation::recordTrialEndStatistics(void) {
+void BatchSimulation::seedTrial(t_int trial) {
+	// each trial has its own stream, so it comes out the same whichever way it is run - an antithetic pair shares one
+	SeedRandomStream(rng, runSeed, antithetic ? trial & ~1 : trial);
+	SetAntithetic(rng, antithetic && (trial & 1));
+	sim.uniforms.clear();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchSimulation::seedSimulation(t_int trial) {
+	// With common random numbers, the simulation goes on with a stream of its own, so that what it draws doesn't
+	// depend on how many numbers making the society took. Otherwise it carries on with the trial's stream as before.
+	if(!commonRandomNumbers) return;
+	SeedRandomStream(rng, DeriveRandomSeed(runSeed, -1), antithetic ? trial & ~1 : trial);
+	sim.uniforms.clear();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchSimulation::recordTrialEndStatistics(Simulation& s) {
+	PROFILE_SCOPE(PROFILE_TRIAL_STATISTICS);
+
 	// means & their squared values
-	stats.totalEValue += sim.eValue;
-	stats.totalEValueDelta += sim.eValueDelta;
-	stats.totalEValueS += sim.eValue * sim.eValue;
-	stats.totalEValueDeltaS += sim.eValueDelta * sim.eValueDelta;
+	stats.totalEValue += s.eValue;
+	stats.totalEValueDelta += s.eValueDelta;
+	stats.totalEValueS += s.eValue * s.eValue;
+	stats.totalEValueDeltaS += s.eValueDelta * s.eValueDelta;
 	
 	// polarisation measures & their squared values
-	t_float p = sim.instantPolarisation(sim.eValue);
+	t_float p = s.polarisation;
 	stats.totalPolarisation += p;
-	stats.totalPolarisationDelta += p - sim.startPolarisation;
+	stats.totalPolarisationDelta += p - s.startPolarisation;
 	stats.totalPolarisationS += p * p;
-	stats.totalPolarisationDeltaS += (p - sim.startPolarisation) * (p - sim.startPolarisation);
+	stats.totalPolarisationDeltaS += (p - s.startPolarisation) * (p - s.startPolarisation);
 	
 	// message and inquiry statistics
-	stats.avgMessagesSentTotal += sim.msgSent;
-	stats.avgMessagesSentPerInquirer += (t_float)sim.msgSent / (t_float)sim.soc->people.size();
-	stats.avgInquiryResultsTotal += sim.inqResults;
-	stats.avgInquiryResultsPerInquirer += (t_float)sim.inqResults / (t_float)sim.soc->people.size();
+	stats.avgMessagesSentTotal += s.msgSent;
+	stats.avgMessagesSentPerInquirer += (t_float)s.msgSent / (t_float)s.soc->people.size();
+	stats.avgInquiryResultsTotal += s.inqResults;
+	stats.avgInquiryResultsPerInquirer += (t_float)s.inqResults / (t_float)s.soc->people.size();
 	
 	// bandwagon measurement
-	if(sim.inqResults > 0) {
-		stats.avgBWToPProb += (t_float)sim.inqOverriddenTowardsP / (t_float)(sim.soc->people.size() * totalSteps());
-		stats.avgBWToPEffect += sim.bwTowardsP / (t_float)(t_float)(sim.soc->people.size() * totalSteps());
-		stats.avgBWToNotPProb += (t_float)sim.inqOverriddenTowardsNotP / (t_float)(t_float)(sim.soc->people.size() * totalSteps());
-		stats.avgBWToNotPEffect += sim.bwTowardsNotP / (t_float)(t_float)(sim.soc->people.size() * totalSteps());
+	if(s.inqResults > 0) {
+		stats.avgBWToPProb += (t_float)s.inqOverriddenTowardsP / (t_float)(s.soc->people.size() * totalSteps());
+		stats.avgBWToPEffect += s.bwTowardsP / (t_float)(t_float)(s.soc->people.size() * totalSteps());
+		stats.avgBWToNotPProb += (t_float)s.inqOverriddenTowardsNotP / (t_float)(t_float)(s.soc->people.size() * totalSteps());
+		stats.avgBWToNotPEffect += s.bwTowardsNotP / (t_float)(t_float)(s.soc->people.size() * totalSteps());
 	}
 	
 	
 	// record degrees
 	if(displayResults) {
 		for(t_int i = 0; i < 3; ++i) {
-			sim.soc->getDegrees(i, sim.soc->degrees[i]);
-			if (sim.soc->degrees[i].size() > stats.degrees[i].size()) {
+			s.soc->getDegrees(i, s.soc->degrees[i]);
+			if (s.soc->degrees[i].size() > stats.degrees[i].size()) {
 				t_int oldsz = stats.degrees[i].size();
-				stats.degrees[i].resize(sim.soc->degrees[i].size());
+				stats.degrees[i].resize(s.soc->degrees[i].size());
 				for (t_int j = oldsz; j < stats.degrees[i].size(); ++j) stats.degrees[i][j] = 0;
 			}
-			for (t_int j = 0; j < sim.soc->degrees[i].size(); ++j) stats.degrees[i][j] += sim.soc->degrees[i][j];
+			for (t_int j = 0; j < s.soc->degrees[i].size(); ++j) stats.degrees[i][j] += s.soc->degrees[i][j];
 		}
 	}
 }
 
 
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchStatistics::clearTotals(void) {
+	totalEValue = totalEValueDelta = 0;
+	totalEValueS = totalEValueDeltaS = 0;
+	totalPolarisation = totalPolarisationDelta = 0;
+	totalPolarisationS = totalPolarisationDeltaS = 0;
+	avgMessagesSentTotal = avgMessagesSentPerInquirer = 0;
+	avgInquiryResultsTotal = avgInquiryResultsPerInquirer = 0;
+	avgBWToPEffect = avgBWToNotPEffect = avgBWToPProb = avgBWToNotPProb = 0;
+    
+	// clean degree lists
+	for (t_int i = 0; i < 3; ++i) degrees[i].clear();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchStatistics::add(const BatchStatistics& s) {
+	totalEValue += s.totalEValue;
+	totalEValueDelta += s.totalEValueDelta;
+	totalEValueS += s.totalEValueS;
+	totalEValueDeltaS += s.totalEValueDeltaS;
+	totalPolarisation += s.totalPolarisation;
+	totalPolarisationDelta += s.totalPolarisationDelta;
+	totalPolarisationS += s.totalPolarisationS;
+	totalPolarisationDeltaS += s.totalPolarisationDeltaS;
+	avgMessagesSentTotal += s.avgMessagesSentTotal;
+	avgMessagesSentPerInquirer += s.avgMessagesSentPerInquirer;
+	avgInquiryResultsTotal += s.avgInquiryResultsTotal;
+	avgInquiryResultsPerInquirer += s.avgInquiryResultsPerInquirer;
+	avgBWToPEffect += s.avgBWToPEffect;
+	avgBWToNotPEffect += s.avgBWToNotPEffect;
+	avgBWToPProb += s.avgBWToPProb;
+	avgBWToNotPProb += s.avgBWToNotPProb;
+	for(t_int i = 0; i < 3; ++i) {
+		if(s.degrees[i].size() > degrees[i].size()) degrees[i].resize(s.degrees[i].size(), 0);
+		for(t_int j = 0; j < s.degrees[i].size(); ++j) degrees[i][j] += s.degrees[i][j];
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchStatistics::saveCheckpoint(CheckpointFile& f) const {
+	f.putDouble(totalEValue);
+	f.putDouble(totalEValueDelta);
+	f.putDouble(totalEValueS);
+	f.putDouble(totalEValueDeltaS);
+	f.putDouble(totalPolarisation);
+	f.putDouble(totalPolarisationDelta);
+	f.putDouble(totalPolarisationS);
+	f.putDouble(totalPolarisationDeltaS);
+	f.putDouble(avgMessagesSentTotal);
+	f.putDouble(avgMessagesSentPerInquirer);
+	f.putDouble(avgInquiryResultsTotal);
+	f.putDouble(avgInquiryResultsPerInquirer);
+	f.putDouble(avgBWToPEffect);
+	f.putDouble(avgBWToNotPEffect);
+	f.putDouble(avgBWToPProb);
+	f.putDouble(avgBWToNotPProb);
+	for(t_int i = 0; i < 3; ++i) f.putVector(degrees[i]);
+	topologies.saveCheckpoint(f);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchStatistics::loadCheckpoint(CheckpointFile& f) {
+	totalEValue = f.getDouble();
+	totalEValueDelta = f.getDouble();
+	totalEValueS = f.getDouble();
+	totalEValueDeltaS = f.getDouble();
+	totalPolarisation = f.getDouble();
+	totalPolarisationDelta = f.getDouble();
+	totalPolarisationS = f.getDouble();
+	totalPolarisationDeltaS = f.getDouble();
+	avgMessagesSentTotal = f.getDouble();
+	avgMessagesSentPerInquirer = f.getDouble();
+	avgInquiryResultsTotal = f.getDouble();
+	avgInquiryResultsPerInquirer = f.getDouble();
+	avgBWToPEffect = f.getDouble();
+	avgBWToNotPEffect = f.getDouble();
+	avgBWToPProb = f.getDouble();
+	avgBWToNotPProb = f.getDouble();
+	for(t_int i = 0; i < 3; ++i) f.getVector(degrees[i]);
+	topologies.loadCheckpoint(f);
+}
+
 //-----------------------------------------------------------------------------------------------------------------------
 
 void BatchSimulation::recordFinalStatistics(void) {
-	// calculate means & standard deviations
-	stats.totalEValue /= (t_float)nTrials;
-	stats.totalEValueDelta /= (t_float)nTrials;
-	stats.totalEValueS = sqrt(stats.totalEValueS / (t_float)nTrials - stats.totalEValue * stats.totalEValue);
-	stats.totalEValueDeltaS = sqrt(stats.totalEValueDeltaS / (t_float)nTrials - stats.totalEValueDelta * stats.totalEValueDelta);
-	stats.totalPolarisation /= nTrials;
-	stats.totalPolarisationDelta /= nTrials;
-	stats.totalPolarisationS = sqrt(stats.totalPolarisationS / nTrials - stats.totalPolarisation * stats.totalPolarisation);
-	stats.totalPolarisationDeltaS = sqrt(stats.totalPolarisationDeltaS / nTrials - stats.totalPolarisationDelta * stats.totalPolarisationDelta);
+	// calculate means & standard deviations over the trials run
+	t_float n = nTrialsRun;
+	stats.totalEValue /= n;
+	stats.totalEValueDelta /= n;
+	stats.totalEValueS = sqrt(stats.totalEValueS / n - stats.totalEValue * stats.totalEValue);
+	stats.totalEValueDeltaS = sqrt(stats.totalEValueDeltaS / n - stats.totalEValueDelta * stats.totalEValueDelta);
+	stats.totalPolarisation /= n;
+	stats.totalPolarisationDelta /= n;
+	stats.totalPolarisationS = sqrt(stats.totalPolarisationS / n - stats.totalPolarisation * stats.totalPolarisation);
+	stats.totalPolarisationDeltaS = sqrt(stats.totalPolarisationDeltaS / n - stats.totalPolarisationDelta * stats.totalPolarisationDelta);
 	
-	stats.avgMessagesSentTotal /= (t_float)nTrials;
-	stats.avgMessagesSentPerInquirer /= (t_float)nTrials;
-	stats.avgInquiryResultsTotal /= (t_float)nTrials;
-	stats.avgInquiryResultsPerInquirer /= (t_float)nTrials;
-	stats.avgBWToPProb /= (t_float)nTrials;
-	stats.avgBWToPEffect /= (t_float)nTrials;
-	stats.avgBWToNotPProb /= (t_float)nTrials;
-	stats.avgBWToNotPEffect /= (t_float)nTrials;
+	stats.avgMessagesSentTotal /= n;
+	stats.avgMessagesSentPerInquirer /= n;
+	stats.avgInquiryResultsTotal /= n;
+	stats.avgInquiryResultsPerInquirer /= n;
+	stats.avgBWToPProb /= n;
+	stats.avgBWToPEffect /= n;
+	stats.avgBWToNotPProb /= n;
+	stats.avgBWToNotPEffect /= n;
 	
 	// average degrees
-	for (t_int i = 0; i < 3; ++i) for (t_int j = 0; j < stats.degrees[i].size(); ++j) stats.degrees[i][j] /= (t_float)nTrials;
+	for (t_int i = 0; i < 3; ++i) for (t_int j = 0; j < stats.degrees[i].size(); ++j) stats.degrees[i][j] /= n;
 	
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
 
+t_int BatchSimulation::blockEnd(void) const {
+	// adaptive batches are checked when the least number of trials is run, and after every block after that
+	if(!adaptive) return nTrials;
+	t_int end = minTrials;
+	if(curTrial >= minTrials) end = minTrials + ((curTrial - minTrials) / ADAPTIVE_TRIAL_BLOCK + 1) * ADAPTIVE_TRIAL_BLOCK;
+	return end < nTrials ? end : nTrials;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_float BatchSimulation::marginOfError(t_float total, t_float totalS) const {
+	// as in the statistics window, from the sums so far over curTrial trials
+	t_float n = curTrial, mean = total / n, var = totalS / n - mean * mean;
+	if(var < 0) var = 0;
+	return gsl_cdf_tdist_Pinv((1.0 + confidenceLevel) / 2.0, n - 1) * sqrt(var / n);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool BatchSimulation::preciseEnough(void) const {
+	if(!adaptive || curTrial < 2 || curTrial < minTrials || (curTrial - minTrials) % ADAPTIVE_TRIAL_BLOCK != 0) return false;
+	if(marginOfError(stats.totalEValue, stats.totalEValueS) > targetMargin) return false;
+	if(adaptivePolarisation && marginOfError(stats.totalPolarisation, stats.totalPolarisationS) > targetMargin) return false;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
 void BatchSimulation::process(void) {
+	// is this the first trial?
+	if(curTrial == 0 && sim.curStep == 0) setupTrials();
+
 	// loop until enough time has passed
-	for(t_int stepsTaken = 0; (stepsTaken < STEPS_PER_SIMULATION_STEP) && (curTrial < nTrials) && !timeOut;) {
-		// is this the first step of the trial?
-		if(sim.curStep == 0) {
-			// is this the first trial?
-			if(curTrial == 0) setupTrials();
-			
-			// create a new society
-			delete curSociety;
+	for(t_int stepsTaken = 0; (stepsTaken < STEPS_PER_SIMULATION_STEP) && !timeOut;) {
+		stepsTaken += advance();
+		if(nTrialsRun) {
+			finishTrials();
+			return;
+		}
+
+		// save progress between trials every now and then
+		if(checkpoint && sim.curStep == 0 && !ensemble && curTrial > 0 && time(0) - lastCheckpoint >= CHECKPOINT_INTERVAL && !saveCheckpoint()) {
+			fl_alert("Could not save checkpoint to %s. The batch simulation goes on without checkpoints.", checkpointFile.c_str());
+			checkpoint = false;
+		}
+	}
+	
+	// update progress bar, & how fast it goes
+	if(displayResults) {
+		progressWindow->barProgress->value((t_float)curTrial * 100.0 / (t_float)nTrials);
+		if(progressWindow->throughput.update(curTrial, curTrial, inquirerSteps, linkVisits)) progressWindow->boxThroughput->copy_label(progressWindow->throughput.describe().c_str());
+	}
+	else doubleProgressWindow->barProgress->value((t_float)curTrial * 100.0 / (t_float)nTrials);
+	sim.soc->organise();
+    societyWindow->view->redraw();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchSimulation::runTrials(void) {
+	while(!nTrialsRun) advance();
+	SetAntithetic(rng, false);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int BatchSimulation::advance(void) {
+	// trials with the same links all the way through can be run several at a time
+	if(ensemble || (sim.curStep == 0 && Ensemble::suitable(*this))) {
+		t_int stepsTaken = advanceEnsemble();
+		if(!ensemble && (curTrial == nTrials || preciseEnough())) nTrialsRun = curTrial;
+		return stepsTaken;
+	}
+
+	// is this the first step of the trial?
+	if(sim.curStep == 0) {
+		// create a new society
+		seedTrial(curTrial);
+		delete curSociety;
+		{
+			PROFILE_SCOPE(PROFILE_SOCIETY_CREATION);
 			curSociety = new Society(&setup[0], templateSociety);
-            
-			// set up simulation
+		}
+		seedSimulation(curTrial);
+        
+		// set up simulation - once nothing can change in the last stage, the rest of it is filled in
+		{
+			PROFILE_SCOPE(PROFILE_SIMULATION_RESET);
 			sim.reset();
-			if (stats.eValuesOverTime.valid() && stats.recordEValueStats) {
-				sim.eValuesOverTime = stats.eValuesOverTime;
-				sim.eValuesOverTime.zOffset = curTrial / stats.societiesPerEValueStat;
-				for(t_int i = 0; i < sim.soc->people.size(); ++i) sim.eValuesOverTime.v(i, 0, 0) = sim.individualEValue(sim.soc->people[i].belief.v());
-			}
+		}
+		sim.stopWhenAbsorbed(nStages == 1 ? totalSteps() : 0);
+		if (stats.eValuesOverTime.valid() && stats.recordEValueStats) {
+			sim.eValuesOverTime = stats.eValuesOverTime;
+			sim.eValuesOverTime.zOffset = curTrial / stats.societiesPerEValueStat;
+			for(t_int i = 0; i < sim.soc->people.size(); ++i) sim.eValuesOverTime.v(i, 0, 0) = sim.aggregate.eValues[i];
+		}
 
-			// record topology
-			if (stats.recordTopologies && (curTrial % stats.societiesPerTopology == 0)) stats.topologies.push_back(NetworkTopology(curSociety));
+		// record topology
+		if (stats.recordTopologies && (curTrial % stats.societiesPerTopology == 0)) {
+			PROFILE_SCOPE(PROFILE_TOPOLOGY_RECORDING);
+			stats.topologies.add(curSociety);
 		}
-		
-		// run a number of steps
-		t_int nStepsToTake = STEPS_PER_SIMULATION_STEP, endStep = nSteps[0];
-		for(t_int i = 1; i <= curStage; ++i) endStep += nSteps[i];
-		if(nStepsToTake + sim.curStep > endStep) nStepsToTake = endStep - sim.curStep;
-		sim.step(nStepsToTake);
-		stepsTaken += nStepsToTake;
-		
-		if(sim.curStep == endStep) {
-			// increment stage
-			if(++curStage == nStages) {
-				recordTrialEndStatistics();
-				
-				// increment trial
-				if(++curTrial == nTrials) {
-					recordFinalStatistics();
-					*sim.soc = *templateSociety;
-                    
-					if(displayResults) {
-						// close progress dialog, restore society, and show statistics
-						if(Fl::has_idle(BatchProcess, this)) Fl::remove_idle(BatchProcess, this);
-						progressWindow->closeDialog(true);
-						societyWindow->showDialog(DIALOG_STATISTICS, this);
-					}
-					else sim.soc->organise();
-					return;
-				}
-				curStage = sim.curStep = 0;
+	}
+	
+	// run a number of steps - in the background, nothing is shown on the way
+	t_int nStepsToTake = STEPS_PER_SIMULATION_STEP, endStep = nSteps[0];
+	for(t_int i = 1; i <= curStage; ++i) endStep += nSteps[i];
+	if(nStepsToTake + sim.curStep > endStep) nStepsToTake = endStep - sim.curStep;
+	if(background) sim.advance(nStepsToTake);
+	else sim.step(nStepsToTake);
+	inquirerSteps += (long long)nStepsToTake * sim.soc->people.size();
+	linkVisits += (long long)nStepsToTake * sim.soc->links.size();
+	
+	if(sim.curStep == endStep) {
+		// increment stage
+		if(++curStage == nStages) {
+			recordTrialEndStatistics(sim);
+			
+			// increment trial
+			if(++curTrial == nTrials || preciseEnough()) {
+				nTrialsRun = curTrial;
+				return nStepsToTake;
 			}
-			else {
-				// use previous society as template to make a new one
-				*sim.soc = Society(&setup[curStage], sim.soc);
-
-				// record new evalues, in case they have changed
-				if (stats.eValuesOverTime.valid() && stats.recordEValueStats) {
-					if ((curTrial % stats.societiesPerEValueStat == 0) && (sim.curStep % stats.timePerEValueStat == 0)) {
-						for (t_int i = 0; i < sim.soc->people.size(); ++i) sim.eValuesOverTime.v(i, sim.curStep / stats.timePerEValueStat, 0) = sim.individualEValue(sim.soc->people[i].belief.v());
-					}
+			curStage = sim.curStep = 0;
+		}
+		else {
+			// use previous society as template to make a new one
+			*sim.soc = Society(&setup[curStage], sim.soc);
+			sim.schedule.invalidate();
+			sim.aggregate.recalculate(&sim);
+			sim.stopWhenAbsorbed(curStage == nStages - 1 ? totalSteps() : 0);
+
+			// record new evalues, in case they have changed
+			if (stats.eValuesOverTime.valid() && stats.recordEValueStats) {
+				if ((curTrial % stats.societiesPerEValueStat == 0) && (sim.curStep % stats.timePerEValueStat == 0)) {
+					for (t_int i = 0; i < sim.soc->people.size(); ++i) sim.eValuesOverTime.v(i, sim.curStep / stats.timePerEValueStat, 0) = sim.aggregate.eValues[i];
 				}
 			}
 		}
 	}
-	
-	// update progress bar
-	if(displayResults) progressWindow->barProgress->value((t_float)curTrial * 100.0 / (t_float)nTrials);
-	else doubleProgressWindow->barProgress->value((t_float)curTrial * 100.0 / (t_float)nTrials);
-	sim.soc->organise();
-    societyWindow->view->redraw();
+	return nStepsToTake;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int BatchSimulation::advanceEnsemble(void) {
+	if(!ensemble) startEnsemble();
+	Ensemble& en = *ensemble;
+	t_int K = en.societies.size();
+
+	// about as many steps in all as a single trial takes at a time, so that the display & cancel button keep up
+	t_int n = STEPS_PER_SIMULATION_STEP / K;
+	if(n < 1) n = 1;
+	if(n > en.stepsLeft) n = en.stepsLeft;
+	t_int taken = 0;
+	while(taken < n) {
+		++taken;
+		if(!en.step()) {
+			// every trial is absorbed, and filled in to the end
+			n = en.stepsLeft;
+			break;
+		}
+	}
+	en.stepsLeft -= n;
+	for(t_int k = 0; k < K; ++k) {
+		inquirerSteps += (long long)taken * en.societies[k]->people.size();
+		linkVisits += (long long)taken * en.societies[k]->links.size();
+	}
+
+	// once every trial is through a stage, go on to the next, or finish
+	if(en.stepsLeft == 0) {
+		if(++curStage < nStages) nextEnsembleStage();
+		else finishEnsemble();
+	}
+	return n * K;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchSimulation::startEnsemble(void) {
+	t_int K = blockEnd() - curTrial;
+	if(K > ENSEMBLE_WIDTH) K = ENSEMBLE_WIDTH;
+	ensemble = new Ensemble;
+	Ensemble& en = *ensemble;
+
+	// create a society, simulation & dice for each trial - simulations attach to the current society when reset, and
+	// the dice carry on from where making the society left them
+	en.societies.resize(K);
+	en.sims.assign(K, sim);
+	en.rngs.resize(K);
+	delete curSociety;
+	for(t_int k = 0; k < K; ++k) {
+		Simulation& s = en.sims[k];
+		s.logMsg = 0;
+		seedTrial(curTrial + k);
+		{
+			PROFILE_SCOPE(PROFILE_SOCIETY_CREATION);
+			en.societies[k] = curSociety = new Society(&setup[0], templateSociety);
+		}
+		seedSimulation(curTrial + k);
+		en.rngs[k] = gsl_rng_clone(rng);
+		{
+			PROFILE_SCOPE(PROFILE_SIMULATION_RESET);
+			s.reset();
+		}
+		s.stopWhenAbsorbed(nStages == 1 ? totalSteps() : 0);
+		if (stats.eValuesOverTime.valid() && stats.recordEValueStats) {
+			s.eValuesOverTime = stats.eValuesOverTime;
+			s.eValuesOverTime.zOffset = (curTrial + k) / stats.societiesPerEValueStat;
+			for(t_int i = 0; i < en.societies[k]->people.size(); ++i) s.eValuesOverTime.v(i, 0, 0) = s.aggregate.eValues[i];
+		}
+
+		// record topology
+		if (stats.recordTopologies && ((curTrial + k) % stats.societiesPerTopology == 0)) {
+			PROFILE_SCOPE(PROFILE_TOPOLOGY_RECORDING);
+			stats.topologies.add(en.societies[k]);
+		}
+	}
+
+	// the last trial's society is the one shown
+	sim.soc = curSociety;
+	curStage = 0;
+	en.stepsLeft = nSteps[0];
+	en.load();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchSimulation::nextEnsembleStage(void) {
+	Ensemble& en = *ensemble;
+
+	// use previous societies as templates to make new ones, each with the dice of its own trial
+	gsl_rng* mainRng = rng;
+	for(t_int k = 0; k < en.societies.size(); ++k) {
+		Simulation& s = en.sims[k];
+		rng = en.rngs[k];
+		*en.societies[k] = Society(&setup[curStage], en.societies[k]);
+		s.schedule.invalidate();
+		s.aggregate.recalculate(&s);
+		s.stopWhenAbsorbed(curStage == nStages - 1 ? totalSteps() : 0);
+
+		// record new evalues, in case they have changed
+		if (stats.eValuesOverTime.valid() && stats.recordEValueStats) {
+			if (((curTrial + k) % stats.societiesPerEValueStat == 0) && (s.curStep % stats.timePerEValueStat == 0)) {
+				for (t_int i = 0; i < en.societies[k]->people.size(); ++i) s.eValuesOverTime.v(i, s.curStep / stats.timePerEValueStat, 0) = s.aggregate.eValues[i];
+			}
+		}
+	}
+	rng = mainRng;
+	en.stepsLeft = nSteps[curStage];
+	en.load();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchSimulation::finishEnsemble(void) {
+	// record statistics, and keep the last society as the current one
+	t_int K = ensemble->societies.size();
+	for(t_int k = 0; k < K; ++k) recordTrialEndStatistics(ensemble->sims[k]);
+	delete ensemble;
+	ensemble = 0;
+	sim.soc = curSociety;
+	curStage = sim.curStep = 0;
+	curTrial += K;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_float BatchSimulation::trialsDone(void) {
+	t_int T = totalSteps();
+	if(nTrialsRun || T <= 0) return curTrial;
+
+	// steps taken in the current trial, or by each trial side by side
+	t_int done = sim.curStep, width = 1;
+	if(ensemble) {
+		done = nSteps[curStage] - ensemble->stepsLeft;
+		for(t_int i = 0; i < curStage; ++i) done += nSteps[i];
+		width = ensemble->societies.size();
+	}
+	return curTrial + (t_float)width * done / T;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void BatchSimulation::finishTrials(void) {
+	recordFinalStatistics();
+	SetAntithetic(rng, false);
+
+	// nothing left to resume
+	if(checkpoint) {
+		remove(checkpointFile.c_str());
+		remove((checkpointFile + string(".evalues")).c_str());
+	}
+
+	// a batch that stopped early only has e-values for the trials it ran
+	if(stats.eValuesOverTime.valid()) {
+		t_int d = (nTrialsRun + stats.societiesPerEValueStat - 1) / stats.societiesPerEValueStat;
+		if(d > 0 && d < stats.eValuesOverTime.depth) stats.eValuesOverTime = stats.eValuesOverTime.extract(DIM_Z, 0, d);
+	}
+	*sim.soc = *templateSociety;
+
+	if(displayResults) {
+		// close progress dialog, restore society, and show statistics
+		if(Fl::has_idle(BatchProcess, this)) Fl::remove_idle(BatchProcess, this);
+		progressWindow->closeDialog(true);
+		societyWindow->showDialog(DIALOG_STATISTICS, this);
+	}
+	else sim.soc->organise();
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
@@ -323,6 +705,16 @@ TiXmlElement* BatchSimulation::toXML(const char *name) {
 	else xml = new TiXmlElement("BATCH_SIMULATION");
 	xml->SetAttribute("TRIALS", nTrials);
 	xml->SetAttribute("STAGES", nStages);
+	xml->SetAttribute("SEED", seed);
+	if(commonRandomNumbers) xml->SetAttribute("COMMON_RANDOM_NUMBERS", "true");
+	if(antithetic) xml->SetAttribute("ANTITHETIC", "true");
+	if(adaptive) {
+		xml->SetAttribute("ADAPTIVE", "true");
+		xml->SetAttribute("MIN_TRIALS", minTrials);
+		xml->SetDoubleAttribute("TARGET_MARGIN", targetMargin);
+		xml->SetDoubleAttribute("CONFIDENCE", confidenceLevel);
+		xml->SetAttribute("MARGIN_OF_POLARISATION", adaptivePolarisation ? "true" : "false");
+	}
 	xml->SetAttribute("STEPS_0", nSteps[0]);
 	if(nStages > 0) xml->SetAttribute("STEPS_1", nSteps[1]);
 	if(nStages > 1) xml->SetAttribute("STEPS_2", nSteps[2]);
@@ -338,8 +730,20 @@ TiXmlElement* BatchSimulation::toXML(const char *name) {
 
 string BatchSimulation::getDescription(void) {
 	string str("GENERAL PARAMETERS\r\n");
-	str += string("Trials: ") + string(IntToString(nTrials)) + string("\r\n");
+	if(adaptive) {
+		str += string("Trials: ") + string(IntToString(minTrials)) + string(" - ") + string(IntToString(nTrials));
+		if(nTrialsRun) str += string(" (") + string(IntToString(nTrialsRun)) + string(" run)");
+		str += string("\r\n");
+		str += string("Margin of error: ") + string(DoubleToString(targetMargin, 4)) + string(" at ");
+		str += string(DoubleToString(confidenceLevel * 100.0, 2)) + string("% confidence");
+		if(adaptivePolarisation) str += string(", also for polarisation");
+		str += string("\r\n");
+	}
+	else str += string("Trials: ") + string(IntToString(nTrials)) + string("\r\n");
 	str += string("Stages: ") + string(IntToString(nStages)) + string("\r\n");
+	if(runSeed || seed) str += string("Seed: ") + string(IntToString(runSeed ? runSeed : seed)) + string("\r\n");
+	if(commonRandomNumbers) str += string("Common random numbers") + string(antithetic ? ", antithetic pairs\r\n" : "\r\n");
+	else if(antithetic) str += string("Antithetic pairs\r\n");
 	str += string("SIMULATION VARIABLES\r\n");
 	str += sim.getDescription() + string("\r\n");
 	for(t_int i = 0; i < nStages; ++i) {
@@ -354,6 +758,116 @@ string BatchSimulation::getDescription(void) {
 
 //-----------------------------------------------------------------------------------------------------------------------
 
+void BatchSimulation::saveManifest(const char* resultsFile) {
+	// a batch file, which runs the same trials again when opened
+	TiXmlDocument f;
+	TiXmlDeclaration* decl = new TiXmlDeclaration( "1.0", "UTF-8", "true" );
+	f.LinkEndChild(decl);
+	TiXmlElement *root = new TiXmlElement("BATCH_SIMULATION_FILE");
+	root->SetAttribute("VERSION", LAPUTA_VERSION);
+	root->SetAttribute("RESULTS", fl_filename_name(resultsFile));
+	time_t now = time(0);
+	char date[64];
+	strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&now));
+	root->SetAttribute("DATE", date);
+	f.LinkEndChild(root);
+	TiXmlElement *xml = toXML();
+	xml->SetAttribute("SEED", runSeed);
+	root->LinkEndChild(xml);
+
+	// write out everything
+	char filename[FL_PATH_MAX];
+	strcpy(filename, resultsFile);
+	fl_filename_setext(filename, FL_PATH_MAX, ".manifest.batch");
+	f.SaveFile(filename);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool BatchSimulation::saveCheckpoint(void) {
+	lastCheckpoint = time(0);
+
+	// e-values of trials done since the last checkpoint are added to a file of their own, so that they are only
+	// written once
+	StatisticsBlock& ev = stats.eValuesOverTime;
+	t_int slices = 0;
+	if(ev.valid()) {
+		slices = (curTrial + stats.societiesPerEValueStat - 1) / stats.societiesPerEValueStat;
+		if(slices > ev.depth) slices = ev.depth;
+		if(slices > eValueSlicesSaved) {
+			string name = checkpointFile + string(".evalues");
+			FILE* ef = fopen(name.c_str(), eValueSlicesSaved ? "r+b" : "wb");
+			if(!ef) return false;
+			size_t sliceSize = (size_t)ev.width * ev.height, n = (slices - eValueSlicesSaved) * sliceSize;
+			bool written = fseek(ef, (long)(eValueSlicesSaved * sliceSize * sizeof(float)), SEEK_SET) == 0 &&
+				fwrite(&ev.v(0, 0, eValueSlicesSaved), sizeof(float), n, ef) == n;
+			if(fclose(ef) != 0 || !written) return false;
+			eValueSlicesSaved = slices;
+		}
+	}
+
+	// settings, the society trials are made from, and the totals of the trials done
+	CheckpointFile f;
+	f.create(checkpointFile.c_str(), CHECKPOINT_BATCH, toXML(), templateSociety);
+	f.putInt(runSeed);
+	f.putInt(curTrial);
+	f.putInt(stats.recordEValueStats);
+	f.putInt(stats.recordTopologies);
+	f.putInt(stats.timePerEValueStat);
+	f.putInt(stats.societiesPerEValueStat);
+	f.putInt(stats.societiesPerTopology);
+	stats.saveCheckpoint(f);
+	f.putInt(slices);
+	f.putInt(ev.width);
+	f.putInt(ev.height);
+	f.putInt(ev.depth);
+	return f.commit();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool BatchSimulation::resume(CheckpointFile& f) {
+	t_int savedSeed = f.getInt(), trials = f.getInt();
+	stats.recordEValueStats = f.getInt();
+	stats.recordTopologies = f.getInt();
+	stats.timePerEValueStat = f.getInt();
+	stats.societiesPerEValueStat = f.getInt();
+	stats.societiesPerTopology = f.getInt();
+	if(!f.good() || trials < 1 || trials > nTrials || stats.timePerEValueStat < 1 || stats.societiesPerEValueStat < 1 || stats.societiesPerTopology < 1) return false;
+
+	// set up as at the start, with the same seed, and fill in the trials done
+	displayResults = true;
+	if (templateSociety) delete templateSociety;
+	templateSociety = new Society(*curSociety);
+	sim.soc = curSociety;
+	curStage = sim.curStep = 0;
+	curTrial = 0;
+	setupTrials();
+	runSeed = savedSeed;
+	stats.loadCheckpoint(f);
+	t_int slices = f.getInt(), w = f.getInt(), h = f.getInt(), d = f.getInt();
+	if(!f.good()) return false;
+
+	// e-values so far, if they were recorded and can be kept again
+	StatisticsBlock& ev = stats.eValuesOverTime;
+	if(slices && ev.valid()) {
+		if(ev.width != w || ev.height != h || ev.depth != d || slices > d) return false;
+		string name = checkpointFile + string(".evalues");
+		FILE* ef = fopen(name.c_str(), "rb");
+		if(!ef) return false;
+		size_t n = (size_t)slices * w * h;
+		bool read = fread(&ev.v(0, 0, 0), sizeof(float), n, ef) == n;
+		fclose(ef);
+		if(!read) return false;
+	}
+	eValueSlicesSaved = ev.valid() ? slices : 0;
+	curTrial = trials;
+	lastCheckpoint = time(0);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
 void BatchSimulationTimeout(void* data) {
 	BatchSimulation* bs = (BatchSimulation*)data;
 	bs->timeOut = true;
@@ -370,12 +884,19 @@ void BatchProcess(void* data) {
 }
 //-----------------------------------------------------------------------------------------------------------------------
 
-void StartBatchSimulation(BatchSimulation* bs) {
+void StartBatchSimulation(BatchSimulation* bs, bool resumed) {
 	bs->displayResults = true;
 	societyWindow->showDialog(DIALOG_PROGRESS, bs);
-	if (bs->templateSociety) delete bs->templateSociety;
-	bs->templateSociety = new Society(*curSociety);
-	bs->curTrial = bs->curStage = bs->sim.curStep = 0;
+
+	// a resumed batch is already set up, and carries on from its last checkpoint
+	if(!resumed) {
+		if (bs->templateSociety) delete bs->templateSociety;
+		bs->templateSociety = new Society(*curSociety);
+		bs->curTrial = bs->curStage = bs->sim.curStep = 0;
+		bs->eValueSlicesSaved = 0;
+		bs->lastCheckpoint = time(0);
+	}
+	ResetProfile();
 	Fl::add_idle(BatchProcess, bs);
 }
 
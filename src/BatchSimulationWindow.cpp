@@ -2,6 +2,8 @@
 #include <FL/Fl_Widget.H>
 #include "App.h"
 #include "Utility.h"
+#include "BatchEstimate.h"
+#include <FL/fl_ask.H>
 
 //-----------------------------------------------------------------------------------------------------------------------
 
@@ -70,11 +72,13 @@ void BatchSimulationWindow::configure(t_int form) {
 	if (form == BS_FORM_GENERATE) {
 		groupTabs->remove(groupStage);
 		groupTabs->remove(groupEValues);
+		groupTabs->remove(groupTrials);
 		groupTabs->remove(groupRecord);
 	}
 	else {
 		groupTabs->insert(*groupStage, 0);
 		groupTabs->add(groupEValues);
+		groupTabs->add(groupTrials);
 		if (form == BS_FORM_SIMULATION) groupTabs->add(groupRecord);
 		else groupTabs->remove(groupRecord);
 	}
@@ -122,6 +126,7 @@ void BatchSimulationWindow::configure(t_int form) {
 	configureInquirers();
 	configureLinks();
 	if(form != BS_FORM_GENERATE) configureEValues();
+	if(form != BS_FORM_GENERATE) configureTrials();
 	if (form == BS_FORM_SIMULATION) configureRecord();
 }
 
@@ -340,6 +345,20 @@ void BatchSimulationWindow::configureEValues(void) {
 	inputBeliefNoneValue->value(bs.sim.val.eValues[1]);
 	inputBeliefNotPValue->value(bs.sim.val.eValues[0]);
     inputExponent->value(bs.sim.val.exponent);
+	buttonLogOdds->value(bs.sim.beliefEngine == BELIEF_ENGINE_LOG_ODDS);
+	buttonSkipSampling->value(bs.sim.eventSampling == EVENT_SAMPLING_SKIP);
+	buttonContinuousTime->value(bs.sim.timing == TIMING_CONTINUOUS);
+	buttonBlockSteps->value(bs.sim.stepEngine == STEP_ENGINE_BLOCKS);
+	choiceRandomGenerator->value(bs.sim.randomGenerator);
+
+	// continuous time is always event driven
+	if(bs.sim.timing == TIMING_CONTINUOUS) buttonSkipSampling->deactivate();
+	else buttonSkipSampling->activate();
+
+	// and only every-step synchronous simulations can be stepped in blocks
+	if(bs.sim.timing == TIMING_CONTINUOUS || bs.sim.eventSampling == EVENT_SAMPLING_SKIP) buttonBlockSteps->deactivate();
+	else buttonBlockSteps->activate();
+
 	if(bs.sim.val.applicationMethod == APPLY_TO_MAJORITY) {
 		btnInqMajority->value(1);
 		boxAmt->activate();
@@ -369,6 +388,35 @@ void BatchSimulationWindow::configureEValues(void) {
 
 //-----------------------------------------------------------------------------------------------------------------------
 
+void BatchSimulationWindow::configureTrials(void) {
+	buttonAdaptiveTrials->value(bs.adaptive);
+	inputMinTrials->value(bs.minTrials);
+	inputTargetMargin->value(bs.targetMargin);
+	inputConfidenceLevel->value(bs.confidenceLevel * 100.0);
+	buttonAdaptivePolarisation->value(bs.adaptivePolarisation);
+
+	// checkpoints are only kept of batches run on their own
+	buttonCheckpoint->value(bs.checkpoint);
+	if(dialogForm == BS_FORM_SIMULATION) buttonCheckpoint->show();
+	else buttonCheckpoint->hide();
+
+	// the rest only matter when stopping early
+	if(bs.adaptive) {
+		inputMinTrials->activate();
+		inputTargetMargin->activate();
+		inputConfidenceLevel->activate();
+		buttonAdaptivePolarisation->activate();
+	}
+	else {
+		inputMinTrials->deactivate();
+		inputTargetMargin->deactivate();
+		inputConfidenceLevel->deactivate();
+		buttonAdaptivePolarisation->deactivate();
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
 void BatchSimulationWindow::configureRecord(void) {
 	buttonRecordEValues->value(bs.stats.recordEValueStats);
 	buttonRecordTopologies->value(bs.stats.recordEValueStats);
@@ -378,24 +426,24 @@ void BatchSimulationWindow::configureRecord(void) {
 
 	// turn on or off stuff
 	if (bs.stats.recordEValueStats){
-		fieldSocietiesPerEValue->activate();
-		labelEValueSocieties->activate();
-		fieldTimePerEValue->activate();
+		fieldSocietiesPerEValue->activate();
+		labelEValueSocieties->activate();
+		fieldTimePerEValue->activate();
 		labelEValueTimeSteps->activate();
 	}
 	else {
-		fieldSocietiesPerEValue->deactivate();
-		labelEValueSocieties->deactivate();
-		fieldTimePerEValue->deactivate();
+		fieldSocietiesPerEValue->deactivate();
+		labelEValueSocieties->deactivate();
+		fieldTimePerEValue->deactivate();
 		labelEValueTimeSteps->deactivate();
 	}
 	if (bs.stats.recordTopologies){
-		fieldSocietiesPerTopology->activate();
-		labelTopologySocieties->activate();
+		fieldSocietiesPerTopology->activate();
+		labelTopologySocieties->activate();
 	}
 	else {
-		fieldSocietiesPerTopology->deactivate();
-		labelTopologySocieties->deactivate();
+		fieldSocietiesPerTopology->deactivate();
+		labelTopologySocieties->deactivate();
 	}
 
 	// make sure record tab is included
@@ -435,6 +483,23 @@ void BatchSimulationWindow::setNumStages(t_int s) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 
+void BatchSimulationWindow::showEstimate(void) {
+	// e-values & topologies are only kept when the batch is run on its own
+	BatchEstimate estimate;
+	estimate.estimate(bs, dialogForm == BS_FORM_SIMULATION, ESTIMATE_CALIBRATION_TIME);
+
+	// columns line up in a fixed-width font
+	fl_message_font(FL_COURIER, FL_NORMAL_SIZE);
+	t_int r = fl_choice("%s", "Close", estimate.suggestion ? "Use Suggested" : 0, 0, estimate.describe().c_str());
+	fl_message_font(FL_HELVETICA, FL_NORMAL_SIZE);
+	if(r == 1) {
+		estimate.applySuggestion(bs);
+		configureRecord();
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
 void BatchSimulationWindow::saveBatchSimulation(void) {
 	string filename = SaveFileDialog("Save Batch As", "*.batch", "Untitled.batch");
 	if (filename != "") {
@@ -0,0 +1,117 @@
+#include "Checkpoint.h"
+#include "Society.h"
+#include "App.h"
+#include <FL/filename.H>
+#include <cstring>
+
+// marks the start of a checkpoint file
+static const char checkpointMagic[8] = { 'L', 'A', 'P', 'U', 'T', 'A', 'C', 'P' };
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool CheckpointFile::create(const char* filename, t_int k, TiXmlElement* runSettings, Society* soc) {
+	close();
+	path = filename;
+	tempPath = path + string(".tmp");
+	file = fopen(tempPath.c_str(), "wb");
+	ok = file != 0;
+	kind = k;
+
+	// settings & society as XML
+	TiXmlElement root("CHECKPOINT");
+	root.SetAttribute("VERSION", LAPUTA_VERSION);
+	root.LinkEndChild(runSettings);
+	if(soc) root.LinkEndChild(soc->toXML());
+	TiXmlPrinter printer;
+	printer.SetStreamPrinting();
+	root.Accept(&printer);
+
+	putBytes(checkpointMagic, sizeof(checkpointMagic));
+	putInt(LAPUTA_VERSION);
+	putInt(kind);
+	putString(printer.CStr());
+	return ok;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool CheckpointFile::commit(void) {
+	if(!file) return false;
+	if(fclose(file) != 0) ok = false;
+	file = 0;
+	if(!ok) {
+		remove(tempPath.c_str());
+		return false;
+	}
+#ifdef _WINDOWS
+	// rename won't replace a file here
+	remove(path.c_str());
+#endif
+	if(rename(tempPath.c_str(), path.c_str()) != 0) {
+		remove(tempPath.c_str());
+		return ok = false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool CheckpointFile::open(const char* filename) {
+	close();
+	path = filename;
+	file = fopen(filename, "rb");
+	ok = file != 0;
+
+	// check that it is a checkpoint, of this version
+	char magic[sizeof(checkpointMagic)];
+	getBytes(magic, sizeof(magic));
+	if(!ok || memcmp(magic, checkpointMagic, sizeof(magic)) != 0 || getInt() != LAPUTA_VERSION) return ok = false;
+	kind = getInt();
+	string xml = getString();
+	if(!ok) return false;
+	settings.Clear();
+	settings.Parse(xml.c_str());
+	if(settings.Error() || !runSettings()) return ok = false;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void CheckpointFile::close(void) {
+	// a checkpoint that was never committed is thrown away
+	if(file) {
+		fclose(file);
+		if(tempPath != "") remove(tempPath.c_str());
+	}
+	file = 0;
+	tempPath = "";
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void CheckpointFile::putString(const string& s) {
+	putInt(s.size());
+	putBytes(s.data(), s.size());
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+string CheckpointFile::getString(void) {
+	long long n = getInt();
+	if(!ok || n < 0) {
+		ok = false;
+		return string();
+	}
+	string s(n, ' ');
+	if(n) getBytes(&s[0], n);
+	return s;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+string CheckpointFileName(const char* resultsFile) {
+	char filename[FL_PATH_MAX];
+	strcpy(filename, resultsFile);
+	fl_filename_setext(filename, FL_PATH_MAX, ".checkpoint");
+	return string(filename);
+}
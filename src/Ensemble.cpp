@@ -0,0 +1,121 @@
+#include "Ensemble.h"
+#include "BatchSimulation.h"
+#include "ParallelEvolve.h"
+#include "Society.h"
+#include "Distribution.h"
+#include "Profiler.h"
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool Ensemble::suitable(const BatchSimulation& bs) {
+	// anything to run side by side before the batch may stop?
+	if(bs.blockEnd() - bs.curTrial < 2 || !bs.templateSociety) return false;
+
+	// only the plain serial synchronous engine is done this way, and large societies don't fit in the cache side by side
+	const Simulation& sim = bs.sim;
+	if(sim.logLevel != LOG_NONE || sim.timing != TIMING_SYNCHRONOUS || sim.eventSampling != EVENT_SAMPLING_EVERY_STEP || sim.stepEngine != STEP_ENGINE_SERIAL) return false;
+	if(bs.templateSociety->people.size() >= PARALLEL_EVOLVE_MIN_INQUIRERS) return false;
+
+	// every trial must have the same inquirers & links all the way through
+	for(t_int i = 0; i < bs.nStages; ++i) if(bs.setup[i].varyPopulation || bs.setup[i].varyLinks) return false;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+Ensemble::~Ensemble() {
+	for(t_int k = 0; k + 1 < societies.size(); ++k) delete societies[k];
+	for(t_int k = 0; k < rngs.size(); ++k) gsl_rng_free(rngs[k]);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Ensemble::load(void) {
+	nTrials = societies.size();
+	nPeople = societies[0]->people.size();
+	nLinks = societies[0]->links.size();
+	t_int K = nTrials;
+
+	// each trial rolls its own dice, and draws them in bulk as its simulation would
+	states.clear();
+	for(t_int k = 0; k < K; ++k) states.push_back(InquiryState(rngs[k], &sims[k], 0, &sims[k].uniforms));
+	running.assign(K, 1);
+
+	// links, which come in order of target in every trial
+	inStart.assign(nPeople + 1, 0);
+	links.resize(nLinks * K);
+	vector<LinkIterator> l(K);
+	for(t_int k = 0; k < K; ++k) l[k] = societies[k]->links.begin();
+	for(t_int e = 0; e < nLinks; ++e) {
+		++inStart[l[0]->second.target + 1];
+		for(t_int k = 0; k < K; ++k) {
+			assert(l[k]->second.source == l[0]->second.source && l[k]->second.target == l[0]->second.target);
+			links[e * K + k] = &l[k]->second;
+			++l[k];
+		}
+	}
+	for(t_int i = 0; i < nPeople; ++i) inStart[i + 1] += inStart[i];
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int Ensemble::step(void) {
+	t_int K = nTrials;
+
+	// running statistics
+	for(t_int k = 0; k < K; ++k) {
+		if(!running[k]) continue;
+		Simulation& sim = sims[k];
+		EValueAggregate& agg = sim.aggregate;
+		if(agg.eValues.size() != nPeople || agg.stepsSinceRecalculation >= EVALUE_RECALCULATION_INTERVAL) agg.recalculate(&sim);
+		++agg.stepsSinceRecalculation;
+		sim.nChanged = 0;
+	}
+
+	// Calculate every inquirer's new degree of belief in every trial
+	{
+		PROFILE_SCOPE(PROFILE_INQUIRIES);
+		for(t_int i = 0; i < nPeople; ++i) {
+			for(t_int k = 0; k < K; ++k) if(running[k]) societies[k]->people[i].startInquiry(&sims[k], i, states[k]);
+			for(t_int e = inStart[i]; e < inStart[i + 1]; ++e) for(t_int k = 0; k < K; ++k) {
+				if(running[k]) societies[k]->people[i].listenTo(&sims[k], societies[k], *links[e * K + k], i, states[k]);
+			}
+			for(t_int k = 0; k < K; ++k) if(running[k]) societies[k]->people[i].finishInquiry(&sims[k], states[k]);
+		}
+	}
+
+	// record messages for links
+	{
+		PROFILE_SCOPE(PROFILE_MESSAGE_RECORDING);
+		for(t_int e = 0; e < nLinks; ++e) for(t_int k = 0; k < K; ++k) if(running[k]) societies[k]->recordLinkMessage(*links[e * K + k]);
+	}
+
+	// Update inquirers to new values, and statistics for those whose belief changed
+	{
+		PROFILE_SCOPE(PROFILE_BELIEF_UPDATES);
+		for(t_int i = 0; i < nPeople; ++i) for(t_int k = 0; k < K; ++k) {
+			if(!running[k]) continue;
+			Inquirer& p = societies[k]->people[i];
+			if(p.newBelief.v() != p.belief.v()) {
+				sims[k].aggregate.update(&sims[k], i, p.belief.v(), p.newBelief.v(), p.includeInStatistics);
+				++sims[k].nChanged;
+			}
+			p.belief = p.newBelief;
+		}
+	}
+
+	// record total statistics, and fill in the rest of trials that can't change any more
+	t_int nRunning = 0;
+	for(t_int k = 0; k < K; ++k) {
+		if(!running[k]) continue;
+		Simulation& sim = sims[k];
+		sim.updateStepStatistics();
+		sim.finishStep();
+		if(sim.checkAbsorbed()) {
+			sim.fillAbsorbed(rngs[k]);
+			running[k] = 0;
+		}
+		else ++nRunning;
+	}
+	return nRunning;
+}
@@ -0,0 +1,168 @@
+#include "EventSchedule.h"
+#include "Society.h"
+#include "Distribution.h"
+#include <algorithm>
+#include <functional>
+#include <climits>
+#include <math.h>
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void EventSchedule::reset(Society* s, t_int step, bool continuousTime) {
+	soc = s;
+	generation = s->generation;
+	now = step;
+	continuous = continuousTime;
+	stepStarted = false;
+	nPeople = soc->people.size();
+	nLinks = soc->links.size();
+
+	// number events in visiting order
+	eventInquirer.clear();
+	eventLink.clear();
+	eventIsLink.clear();
+	LinkIterator l = soc->links.begin();
+	for(t_int i = 0; i < nPeople; ++i) {
+		eventInquirer.push_back(i);
+		eventLink.push_back(soc->links.end());
+		eventIsLink.push_back(false);
+		for(; l != soc->links.end() && l->second.target == i; ++l) {
+			eventInquirer.push_back(i);
+			eventLink.push_back(l);
+			eventIsLink.push_back(true);
+		}
+	}
+
+	// group links by source
+	outStart.assign(nPeople + 1, 0);
+	for(LinkIterator l = soc->links.begin(); l != soc->links.end(); ++l) ++outStart[l->second.source + 1];
+	for(t_int i = 0; i < nPeople; ++i) outStart[i + 1] += outStart[i];
+	outLinks.resize(nLinks);
+	vector<t_int> pos(outStart.begin(), outStart.end() - 1);
+	for(LinkIterator l = soc->links.begin(); l != soc->links.end(); ++l) outLinks[pos[l->second.source]++] = l;
+
+	// empty calendar, and first event of everything
+	buckets.resize(EVENT_CALENDAR_SIZE);
+	for(t_int i = 0; i < EVENT_CALENDAR_SIZE; ++i) buckets[i].clear();
+	later.clear();
+	for(t_int id = 0; id < eventInquirer.size(); ++id) schedule(id, continuous ? now : now - 1);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool EventSchedule::valid(const Society* s, bool continuousTime) const {
+	return soc == s && generation == s->generation && continuous == continuousTime;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_float EventSchedule::waitingTime(t_float p) const {
+	// time until next event, or -1 if there will never be one
+	if(p <= 0) return -1;
+	if(continuous) return -log(gsl_rng_uniform_pos(rng)) / p;
+
+	// number of steps until next success
+	if(p >= 1.0) return 1;
+	t_float k = ceil(log(gsl_rng_uniform_pos(rng)) / log1p(-p));
+	return k < 1 ? 1 : k;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void EventSchedule::schedule(t_int id, t_float time) {
+	t_float wait = waitingTime(eventIsLink[id] ? eventLink[id]->second.listenChance : soc->people[eventInquirer[id]].inquiryChance);
+	if(wait < 0 || time + wait >= INT_MAX) return;
+
+	// events during the current step go straight into the heap of due events
+	t_float when = time + wait;
+	t_int whenStep = (t_int)floor(when);
+	if(stepStarted && whenStep == now) {
+		due.push_back(pair<t_float, t_int>(when, id));
+		push_heap(due.begin(), due.end(), greater<pair<t_float, t_int> >());
+	}
+
+	// close events go into the calendar, the rest wait until their turn comes near
+	else if(whenStep < now + EVENT_CALENDAR_SIZE) buckets[whenStep % EVENT_CALENDAR_SIZE].push_back(pair<t_float, t_int>(when, id));
+	else later.push_back(pair<t_float, t_int>(when, id));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void EventSchedule::takeBucket(void) {
+	// start of a new round of the calendar - bring in events that are now close enough
+	if(now % EVENT_CALENDAR_SIZE == 0) {
+		t_int j = 0;
+		for(t_int i = 0; i < later.size(); ++i) {
+			if(later[i].first < now + EVENT_CALENDAR_SIZE) buckets[(t_int)floor(later[i].first) % EVENT_CALENDAR_SIZE].push_back(later[i]);
+			else later[j++] = later[i];
+		}
+		later.resize(j);
+	}
+
+	// take the events for this step
+	due.swap(buckets[now % EVENT_CALENDAR_SIZE]);
+	buckets[now % EVENT_CALENDAR_SIZE].clear();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void EventSchedule::collect(t_int step) {
+	// has time been moved?
+	if(step != now) reset(soc, step, false);
+
+	// take the events for this step, in visiting order
+	takeBucket();
+	sort(due.begin(), due.end());
+
+	// group by inquirer
+	inquirers.clear();
+	inquires.clear();
+	heardStart.clear();
+	heard.clear();
+	for(t_int i = 0; i < due.size(); ++i) {
+		t_int id = due[i].second;
+		if(inquirers.empty() || inquirers.back() != eventInquirer[id]) {
+			inquirers.push_back(eventInquirer[id]);
+			inquires.push_back(false);
+			heardStart.push_back(heard.size());
+		}
+		if(eventIsLink[id]) heard.push_back(eventLink[id]);
+		else inquires.back() = true;
+	}
+	heardStart.push_back(heard.size());
+
+	// schedule next events
+	for(t_int i = 0; i < due.size(); ++i) schedule(due[i].second, now);
+	++now;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool EventSchedule::next(t_int step, t_int& inq, const LinkIterator*& link) {
+	if(!stepStarted) {
+		// has time been moved?
+		if(step != now) reset(soc, step, true);
+
+		// keep the events for this step as a heap, since handling one may add others
+		takeBucket();
+		make_heap(due.begin(), due.end(), greater<pair<t_float, t_int> >());
+		stepStarted = true;
+	}
+
+	// end of step?
+	if(due.empty()) {
+		stepStarted = false;
+		++now;
+		return false;
+	}
+
+	// take earliest event, and schedule the next one for the same inquirer or link
+	pop_heap(due.begin(), due.end(), greater<pair<t_float, t_int> >());
+	pair<t_float, t_int> e = due.back();
+	due.pop_back();
+	schedule(e.second, e.first);
+
+	inq = eventInquirer[e.second];
+	link = eventIsLink[e.second] ? &eventLink[e.second] : 0;
+	return true;
+}
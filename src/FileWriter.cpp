@@ -0,0 +1,69 @@
+#include "FileWriter.h"
+#include <cmath>
+#include <cstring>
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void FileWriter::put(const char* s) {
+	size_t len = strlen(s);
+	while (len) {
+		if (n == FILE_WRITER_BUFFER_SIZE) flush();
+		size_t chunk = FILE_WRITER_BUFFER_SIZE - n;
+		if (chunk > len) chunk = len;
+		memcpy(buf + n, s, chunk);
+		n += chunk;
+		s += chunk;
+		len -= chunk;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void FileWriter::putInt(long long v) {
+	char tmp[24];
+	t_int i = 0;
+	unsigned long long u = v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+	do {
+		tmp[i++] = '0' + (char)(u % 10);
+		u /= 10;
+	} while (u);
+	if (v < 0) put('-');
+	while (i) put(tmp[--i]);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void FileWriter::putFloat(double v, t_int digits) {
+	// same output as DoubleToString: round half up, then cut off after the given number of digits
+	if (std::isnan(v)) {
+		put(' ');
+		return;
+	}
+	if (std::isinf(v)) {
+		put(v > 0 ? "+inf" : "-inf");
+		return;
+	}
+	if (digits > 12) digits = 12;
+	v += .5 * pow(10.0, -digits);
+
+	// split into integer part and 12 decimals
+	bool negative = std::signbit(v);
+	double a = fabs(v), ip = floor(a);
+	unsigned long long whole = (unsigned long long)ip, frac = (unsigned long long)llround((a - ip) * 1e12);
+	if (frac >= 1000000000000ULL) {
+		frac -= 1000000000000ULL;
+		++whole;
+	}
+
+	if (negative) put('-');
+	putInt((long long)whole);
+	if (digits > 0) {
+		char tmp[12];
+		for (t_int i = 11; i >= 0; --i) {
+			tmp[i] = '0' + (char)(frac % 10);
+			frac /= 10;
+		}
+		put('.');
+		for (t_int i = 0; i < digits; ++i) put(tmp[i]);
+	}
+}
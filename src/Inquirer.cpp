@@ -1,5 +1,6 @@
 #include "Inquirer.h"
 #include "App.h"
+#include "Profiler.h"
 
 //-----------------------------------------------------------------------------------------------------------------------
 
@@ -138,168 +139,223 @@ TiXmlElement* Inquirer::toXML(t_int id) const {
 
 //-----------------------------------------------------------------------------------------------------------------------
 
-void Inquirer::doInquiry(Simulation *sim, Society *soc, t_int index) {
-	char s[256], msg[256], inqName[64];
-
-	// start log message
+void InquiryState::start(Simulation* sim, const Inquirer& inq, t_int index) {
+	// log name
 	if(sim->logLevel >= LOG_STANDARD) {
-		if(name[0]) sprintf(inqName, "'%s'", name);
+		if(inq.name[0]) sprintf(inqName, "'%s'", inq.name);
 		else sprintf(inqName, "%d", index + 1);
 	}
+	start(sim, inq.belief);
+}
 
+//-----------------------------------------------------------------------------------------------------------------------
+
+void InquiryState::start(Simulation* sim, const Amount& belief) {
 	// starting left-hand and right-hand sides in equation
-	bool informationReceived = false;
-	Amount lhs = belief, rhs = belief.inverted(), inqEffect = belief;
+	informationReceived = false;
+	lhs = belief;
+	rhs = belief.inverted();
+	inqEffect = belief;
+
+	// in log-odds form each message just adds the log-odds of trust in its source
+	logOdds = sim->beliefEngine == BELIEF_ENGINE_LOG_ODDS;
+	l = logOdds ? belief.logOdds() : 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void InquiryState::add(Amount expectation, bool saysP) {
+	informationReceived = true;
+	if(logOdds) {
+		if(saysP) l += expectation.logOdds();
+		else l -= expectation.logOdds();
+	}
+	else if(saysP) {
+		lhs *= expectation;
+		rhs *= expectation.inverted();
+	}
+	else {
+		lhs *= expectation.inverted();
+		rhs *= expectation;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Inquirer::doInquiry(Simulation *sim, Society *soc, t_int index) {
+	InquiryState st(rng, sim, 0, &sim->uniforms);
+	doInquiry(sim, soc, index, st);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Inquirer::doInquiry(Simulation *sim, Society *soc, t_int index, InquiryState& st) {
+	startInquiry(sim, index, st);
+
+	// does listening to others give anything?
+	for(LinkIterator link = soc->links.lower_bound(LBOUND(index)); link != soc->links.upper_bound(UBOUND(index)); ++link) listenTo(sim, soc, link->second, index, st);
+
+	finishInquiry(sim, st);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Inquirer::startInquiry(Simulation *sim, t_int index, InquiryState& st) {
+	st.start(sim, *this, index);
 
 	// does inquiry give anything?
-	if(gsl_rng_uniform(rng) < inquiryChance) {
-		informationReceived = true;
-		lastInquiryResult = sim->curStep;
-		++sim->inqResults;
-		Amount expectation = inquiryTrust.expectation();
-		if(gsl_rng_uniform(rng) < inquiryAccuracy) {
-			// inquiry says p
-			if(sim->logLevel >= LOG_STANDARD) sprintf(msg, "Inquirer %s received the result that p from inquiry", inqName);
-
-			// update P(p)
-			lhs *= expectation;
-			rhs *= expectation.inverted();
-			inqEffect = lhs.dividedByAdded(rhs);
-
-			// update trust function
-			if(updateInquiryTrust) {
-				inquiryTrust.update(belief.v(), true);
-				if(sim->logLevel == LOG_DETAILED) {
-					if(inquiryTrust.expectation() > expectation.v()) sprintf(s, ", raising his/her expected trust in it from %.3f to %.3f", expectation.v(), inquiryTrust.expectation());
-					else if (inquiryTrust.expectation() < expectation.v()) sprintf(s, ", lowering his/her expected trust in it from %.3f to %.3f", expectation.v(), inquiryTrust.expectation());
-					else sprintf(s, ", with no effect on his/her expected trust in it");
-					strcat(msg, s);
-				}
-			}
+	if(st.uniform() < inquiryChance) receiveInquiryResult(sim, st);
+}
 
-			// record
-			message = MSG_SAY_P;
-		}
-		else {
-			// inquiry says not-p
-			if(sim->logLevel >= LOG_STANDARD) sprintf(msg, "Inquirer %s received the result that not-p from inquiry", inqName);
-
-			// update P(p)
-			lhs *= expectation.inverted();
-			rhs *= expectation;
-			inqEffect = lhs.dividedByAdded(rhs);
-
-			// update trust function
-			if(updateInquiryTrust) {
-				inquiryTrust.update(belief.v(), false);
-				if(sim->logLevel == LOG_DETAILED) {
-					if(inquiryTrust.expectation() > expectation.v()) sprintf(s, ", raising his/her expected trust in it from %.3f to %.3f", expectation.v(), inquiryTrust.expectation());
-					else if (inquiryTrust.expectation() < expectation.v()) sprintf(s, ", lowering his/her expected trust in it from %.3f to %.3f", expectation.v(), inquiryTrust.expectation());
-					else sprintf(s, ", with no effect on his/her expected trust in it");
-					strcat(msg, s);
-				}
-			}
+//-----------------------------------------------------------------------------------------------------------------------
 
-			// record
-			message = MSG_SAY_NOT_P;
-		}
-		if(sim->logLevel >= LOG_STANDARD) {
-			strcat(msg, ".\n");
-			app->getCurSimulation()->addToLog(msg);
-		}
+void Inquirer::listenTo(Simulation *sim, Society *soc, Link& link, t_int index, InquiryState& st) {
+	t_int whatToSay = messageFrom(soc, link, index, st);
+
+	// is link being used at this time step?
+	if((st.uniform() < link.listenChance) && (whatToSay != MSG_SAY_NOTHING)) hearFrom(sim, soc, link, whatToSay, st);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Inquirer::doScheduledInquiry(Simulation *sim, Society *soc, t_int index, bool inquire, const LinkIterator* heard, t_int nHeard) {
+	InquiryState st(rng, sim, 0, &sim->uniforms);
+	st.start(sim, *this, index);
+
+	// the schedule has already decided which events happen, so only the outcomes are left to roll for
+	if(inquire) receiveInquiryResult(sim, st);
+	for(t_int i = 0; i < nHeard; ++i) {
+		t_int whatToSay = messageFrom(soc, heard[i]->second, index, st);
+		if(whatToSay != MSG_SAY_NOTHING) hearFrom(sim, soc, heard[i]->second, whatToSay, st);
 	}
 
-	// does listening to others give anything?
-	for(LinkIterator link = soc->links.lower_bound(LBOUND(index)); link != soc->links.upper_bound(UBOUND(index)); ++link) {
-		t_int source = link->second.source;
-		// what does source say?
-		t_int whatToSay = MSG_SAY_NOTHING;
-		if(link->second.evidencePolicy == NEW_EVIDENCE_NONE) {
-			if((soc->people[source].belief.v() > 0.5 && link->second.threshold > 0.5) || (soc->people[source].belief.v() < 0.5 && link->second.threshold < 0.5)) whatToSay = MSG_SAY_P;
-			else if((soc->people[source].belief.v() < 0.5 && link->second.threshold > 0.5) || (soc->people[source].belief.v() > 0.5 && link->second.threshold < 0.5)) whatToSay = MSG_SAY_NOT_P;
-			else whatToSay = (gsl_rng_get(rng) & 1) ? MSG_SAY_P : MSG_SAY_NOT_P;
+	finishInquiry(sim, st);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Inquirer::receiveInquiryResult(Simulation *sim, InquiryState& st) {
+	char s[256], msg[256];
+
+	lastInquiryResult = sim->curStep;
+	++st.counts->inqResults;
+	Amount expectation = inquiryTrust.expectation();
+	bool saysP = st.uniform() < inquiryAccuracy;
+
+	// log
+	if(sim->logLevel >= LOG_STANDARD) {
+		if(saysP) sprintf(msg, "Inquirer %s received the result that p from inquiry", st.inqName);
+		else sprintf(msg, "Inquirer %s received the result that not-p from inquiry", st.inqName);
+	}
+
+	// update P(p)
+	st.add(expectation, saysP);
+	if(!st.contradictory()) st.inqEffect = st.result();
+
+	// update trust function
+	if(updateInquiryTrust) {
+		inquiryTrust.update(belief.v(), saysP);
+		if(sim->logLevel == LOG_DETAILED) {
+			if(inquiryTrust.expectation() > expectation.v()) sprintf(s, ", raising his/her expected trust in it from %.3f to %.3f", expectation.v(), inquiryTrust.expectation());
+			else if (inquiryTrust.expectation() < expectation.v()) sprintf(s, ", lowering his/her expected trust in it from %.3f to %.3f", expectation.v(), inquiryTrust.expectation());
+			else sprintf(s, ", with no effect on his/her expected trust in it");
+			strcat(msg, s);
 		}
-		else {
-			// does consulation of link pass the "new evidence" test?
-			bool newEvidence = link->second.lastUsed < soc->people[source].lastInquiryResult;
-			if(link->second.countPriorAsEvidence && link->second.lastUsed == -1) newEvidence = true;
-			if(link->second.evidencePolicy == NEW_EVIDENCE_ANY && !newEvidence) {
-				for(LinkIterator link2 = soc->links.lower_bound(LBOUND(source)); link2 != soc->links.upper_bound(UBOUND(source)); ++link2) {
-					if(link2->second.source != index && link2->second.lastUsed > link->second.lastUsed) {
-						newEvidence = true;
-						break;
-					}
-				}
+	}
+
+	// record
+	message = saysP ? MSG_SAY_P : MSG_SAY_NOT_P;
+	if(sim->logLevel >= LOG_STANDARD) {
+		strcat(msg, ".\n");
+		app->getCurSimulation()->addToLog(msg);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int Inquirer::messageFrom(Society *soc, const Link& link, t_int index, InquiryState& st) const {
+	t_int source = link.source;
+
+	// what does source say?
+	if(link.evidencePolicy == NEW_EVIDENCE_NONE) {
+		if((soc->people[source].belief.v() > 0.5 && link.threshold > 0.5) || (soc->people[source].belief.v() < 0.5 && link.threshold < 0.5)) return MSG_SAY_P;
+		else if((soc->people[source].belief.v() < 0.5 && link.threshold > 0.5) || (soc->people[source].belief.v() > 0.5 && link.threshold < 0.5)) return MSG_SAY_NOT_P;
+		else return (gsl_rng_get(st.rand) & 1) ? MSG_SAY_P : MSG_SAY_NOT_P;
+	}
+
+	// does consulation of link pass the "new evidence" test?
+	if(st.activity) {
+		// going by the state at the start of the step
+		const InquirerActivity& a = st.activity[source];
+		bool newEvidence = link.lastUsed < a.lastInquiryResult;
+		if(link.countPriorAsEvidence && link.lastUsed == -1) newEvidence = true;
+		if(link.evidencePolicy == NEW_EVIDENCE_ANY && (a.lastHeardFrom != index ? a.lastHeard : a.lastHeardOtherwise) > link.lastUsed) newEvidence = true;
+		return newEvidence ? link.message : MSG_SAY_NOTHING;
+	}
+	bool newEvidence = link.lastUsed < soc->people[source].lastInquiryResult;
+	if(link.countPriorAsEvidence && link.lastUsed == -1) newEvidence = true;
+	if(link.evidencePolicy == NEW_EVIDENCE_ANY && !newEvidence) {
+		for(LinkIterator link2 = soc->links.lower_bound(LBOUND(source)); link2 != soc->links.upper_bound(UBOUND(source)); ++link2) {
+			if(link2->second.source != index && link2->second.lastUsed > link.lastUsed) {
+				newEvidence = true;
+				break;
 			}
-			if(newEvidence) whatToSay = link->second.message;
-			else whatToSay = MSG_SAY_NOTHING;
 		}
+	}
+	if(newEvidence) return link.message;
+	else return MSG_SAY_NOTHING;
+}
 
-		// is link being used at this time step?
-		if((gsl_rng_uniform(rng) < link->second.listenChance) && (whatToSay != MSG_SAY_NOTHING)) {
-			++sim->msgSent;
-			Amount expectation = const_cast<TrustFunction&>(link->second.trust).expectation();
-			informationReceived = true;
-			link->second.lastUsed = sim->curStep;
-			if(whatToSay == MSG_SAY_P) {
-				// source says p
-				if(sim->logLevel >= LOG_STANDARD) {
-					sprintf(msg, "Inquirer %s heard that p from inquirer ", inqName);
-					if(soc->people[source].name[0]) sprintf(s, "'%s'", soc->people[source].name);
-					else sprintf(s, "%d", source + 1);
-					strcat(msg, s);
-				}
-
-				// update P(p)
-				lhs *= expectation;
-				rhs *= expectation.inverted();
-
-				// update trust function
-				if(link->second.updateTrust) {
-					link->second.trust.update(belief.v(), true);
-					if(sim->logLevel == LOG_DETAILED) {
-						if(link->second.trust.expectation() > expectation.v()) sprintf(s, ", raising his/her expected trust in the source from %.3f to %.3f", expectation.v(), link->second.trust.expectation());
-						else if (link->second.trust.expectation() < expectation.v()) sprintf(s, ", lowering his/her expected trust in the source from %.3f to %.3f", expectation.v(), link->second.trust.expectation());
-						else sprintf(s, ", with no effect on his/her expected trust in the source");
-						strcat(msg, s);
-					}
-				}
-			}
-			else if(whatToSay == MSG_SAY_NOT_P){
-				// source says not-p;
-				if(sim->logLevel >= LOG_STANDARD) {
-					sprintf(msg, "Inquirer %s heard that not-p from inquirer ", inqName);
-					if(soc->people[source].name[0]) sprintf(s, "'%s'", soc->people[source].name);
-					else sprintf(s, "%d", source + 1);
-					strcat(msg, s);
-				}
-
-				// update P(p)
-				lhs *= expectation.inverted();
-				rhs *= expectation;
-
-				// update trust function
-				if(link->second.updateTrust) {
-					link->second.trust.update(belief.v(), false);
-					if(sim->logLevel == LOG_DETAILED) {
-						if(link->second.trust.expectation() > expectation.v()) sprintf(s, ", raising his/her expected trust in the source from %.3f to %.3f", expectation.v(), link->second.trust.expectation());
-						else if (link->second.trust.expectation() < expectation.v()) sprintf(s, ", lowering his/her expected trust in the source from %.3f to %.3f", expectation.v(), link->second.trust.expectation());
-						else sprintf(s, ", with no effect on his/her expected trust in the source");
-						strcat(msg, s);
-					}
-				}
-			}
-			if(sim->logLevel >= LOG_STANDARD) {
-				strcat(msg, ".\n");
-				app->getCurSimulation()->addToLog(msg);
-			}
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Inquirer::hearFrom(Simulation *sim, Society *soc, Link& link, t_int whatToSay, InquiryState& st) {
+	char s[256], msg[256];
+	t_int source = link.source;
+
+	++st.counts->msgSent;
+	PROFILE_COUNT(PROFILE_MESSAGES, 1);
+	Amount expectation = const_cast<TrustFunction&>(link.trust).expectation();
+	link.lastUsed = sim->curStep;
+	bool saysP = whatToSay == MSG_SAY_P;
+
+	// log
+	if(sim->logLevel >= LOG_STANDARD) {
+		if(saysP) sprintf(msg, "Inquirer %s heard that p from inquirer ", st.inqName);
+		else sprintf(msg, "Inquirer %s heard that not-p from inquirer ", st.inqName);
+		if(soc->people[source].name[0]) sprintf(s, "'%s'", soc->people[source].name);
+		else sprintf(s, "%d", source + 1);
+		strcat(msg, s);
+	}
+
+	// update P(p)
+	st.add(expectation, saysP);
+
+	// update trust function
+	if(link.updateTrust) {
+		link.trust.update(belief.v(), saysP);
+		if(sim->logLevel == LOG_DETAILED) {
+			if(link.trust.expectation() > expectation.v()) sprintf(s, ", raising his/her expected trust in the source from %.3f to %.3f", expectation.v(), link.trust.expectation());
+			else if (link.trust.expectation() < expectation.v()) sprintf(s, ", lowering his/her expected trust in the source from %.3f to %.3f", expectation.v(), link.trust.expectation());
+			else sprintf(s, ", with no effect on his/her expected trust in the source");
+			strcat(msg, s);
 		}
 	}
 
+	if(sim->logLevel >= LOG_STANDARD) {
+		strcat(msg, ".\n");
+		app->getCurSimulation()->addToLog(msg);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Inquirer::finishInquiry(Simulation *sim, InquiryState& st) {
+	char msg[256];
+
 	// Calculate new belief value (left hand side / (left hand side + right hand side)) if non-contradictory
-	if(informationReceived) {
-		if(lhs + rhs > 0) {
-			newBelief = lhs.dividedByAdded(rhs);
+	if(st.informationReceived) {
+		if(!st.contradictory()) {
+			newBelief = st.result();
 			if(sim->logLevel >= LOG_STANDARD) {
 				if(newBelief > belief) sprintf(msg, "This raised his/her degree of belief in p from %.5f to %.5f.\n", belief.v(), newBelief.v());
 				else if(newBelief < belief) sprintf(msg, "This lowered his/her degree of belief in p from %.5f to %.5f\n", belief.v(), newBelief.v());
@@ -308,31 +364,31 @@ void Inquirer::doInquiry(Simulation *sim, Society *soc, t_int index) {
 			}
 
 			// Note possible bandwagon effect
-			if(newBelief > inqEffect) {
-				sim->bwTowardsP += newBelief.v() - inqEffect.v();
-				++sim->inqOverriddenTowardsP;
+			if(newBelief > st.inqEffect) {
+				st.counts->bwTowardsP += newBelief.v() - st.inqEffect.v();
+				++st.counts->inqOverriddenTowardsP;
 			}
-			else if(newBelief < inqEffect) {
-				sim->bwTowardsNotP += inqEffect.v() - newBelief.v();
-				++sim->inqOverriddenTowardsNotP;
+			else if(newBelief < st.inqEffect) {
+				st.counts->bwTowardsNotP += st.inqEffect.v() - newBelief.v();
+				++st.counts->inqOverriddenTowardsNotP;
 			}
 
 		}
 		else if(sim->logLevel > LOG_NONE) {
-			sprintf(msg, "The information gathered by inquirer %s forced him/her t_into contradiction.\n", inqName);
+			sprintf(msg, "The information gathered by inquirer %s forced him/her t_into contradiction.\n", st.inqName);
 			app->getCurSimulation()->addToLog(msg);
 		}
 
 		// Notice if inquirer becomes certain
 		if(newBelief == 1.0 && belief != 1.0) {
 			if(sim->logLevel >= LOG_STANDARD) {
-				sprintf(msg, "Inquirer %s became certain that p.\n", inqName);
+				sprintf(msg, "Inquirer %s became certain that p.\n", st.inqName);
 				app->getCurSimulation()->addToLog(msg);
 			}
 		}
 		if(newBelief == 0.0 && belief != 1.0) {
 			if(sim->logLevel >= LOG_STANDARD) {
-				sprintf(msg, "Inquirer %s became certain that not-p.\n", inqName);
+				sprintf(msg, "Inquirer %s became certain that not-p.\n", st.inqName);
 				app->getCurSimulation()->addToLog(msg);
 			}
 		}
@@ -82,6 +82,7 @@ void InquirerWindow::configure(void) {
 
 
 void InquirerWindow::setSelectedInquirerNames(const char* name) {
+	app->undos.touchInquirers(*curSociety, societyWindow->view->selectedInquirers);
 	for(set<t_int>::iterator inq = societyWindow->view->selectedInquirers.begin(); inq != societyWindow->view->selectedInquirers.end(); ++inq) strcpy(curSociety->people[*inq].name, name);
 	societyWindow->view->redraw();
 	app->touchFile();
@@ -90,6 +91,7 @@ void InquirerWindow::setSelectedInquirerNames(const char* name) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void InquirerWindow::setSelectedInquirerBeliefs(t_float belief) {
+	app->undos.touchInquirers(*curSociety, societyWindow->view->selectedInquirers);
 	for(set<t_int>::iterator inq = societyWindow->view->selectedInquirers.begin(); inq != societyWindow->view->selectedInquirers.end(); ++inq) curSociety->people[*inq].belief = belief;
 	societyWindow->view->redraw();
 	app->touchFile();
@@ -98,6 +100,7 @@ void InquirerWindow::setSelectedInquirerBeliefs(t_float belief) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void InquirerWindow::setSelectedInquirerInquiryChances(t_float inqChance) {
+	app->undos.touchInquirers(*curSociety, societyWindow->view->selectedInquirers);
 	for(set<t_int>::iterator inq = societyWindow->view->selectedInquirers.begin(); inq != societyWindow->view->selectedInquirers.end(); ++inq) curSociety->people[*inq].inquiryChance = inqChance;
 	app->touchFile();
 }
@@ -106,6 +109,7 @@ void InquirerWindow::setSelectedInquirerInquiryChances(t_float inqChance) {
 
 
 void InquirerWindow::setSelectedInquirerInquiryAccuracies(t_float inqAccuracy) {
+	app->undos.touchInquirers(*curSociety, societyWindow->view->selectedInquirers);
 	for(set<t_int>::iterator inq = societyWindow->view->selectedInquirers.begin(); inq != societyWindow->view->selectedInquirers.end(); ++inq) curSociety->people[*inq].inquiryAccuracy = inqAccuracy;
 	app->touchFile();
 }
@@ -113,6 +117,7 @@ void InquirerWindow::setSelectedInquirerInquiryAccuracies(t_float inqAccuracy) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void InquirerWindow::setSelectedInquirerTrustFromDistribution(const Distribution& d) {
+	app->undos.touchInquirers(*curSociety, societyWindow->view->selectedInquirers);
 	for(set<t_int>::iterator inq = societyWindow->view->selectedInquirers.begin(); inq != societyWindow->view->selectedInquirers.end(); ++inq) d.toTrustFunction(&curSociety->people[*inq].inquiryTrust);
 	configure();
 	app->touchFile();
@@ -121,6 +126,7 @@ void InquirerWindow::setSelectedInquirerTrustFromDistribution(const Distribution
 //-----------------------------------------------------------------------------------------------------------------------
 
 void InquirerWindow::setSelectedInquirerUpdateInquiryTrust(bool update) {
+	app->undos.touchInquirers(*curSociety, societyWindow->view->selectedInquirers);
 	for(set<t_int>::iterator inq = societyWindow->view->selectedInquirers.begin(); inq != societyWindow->view->selectedInquirers.end(); ++inq) curSociety->people[*inq].updateInquiryTrust = update;
 	app->touchFile();
 }
@@ -128,12 +134,14 @@ void InquirerWindow::setSelectedInquirerUpdateInquiryTrust(bool update) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void InquirerWindow::setSelectedInquirerIncludeInStatistics(bool incl) {
+	app->undos.touchInquirers(*curSociety, societyWindow->view->selectedInquirers);
 	for(set<t_int>::iterator inq = societyWindow->view->selectedInquirers.begin(); inq != societyWindow->view->selectedInquirers.end(); ++inq) curSociety->people[*inq].includeInStatistics = incl;
 	app->touchFile();
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
 void InquirerWindow::setSelectedInquirerIsTemplate(bool isTempl) {
+	app->undos.touchInquirers(*curSociety, societyWindow->view->selectedInquirers);
 	if(isTempl) {
         for(set<t_int>::iterator inq = societyWindow->view->selectedInquirers.begin(); inq != societyWindow->view->selectedInquirers.end(); ++inq) {
             if(!curSociety->people[*inq].inqParams) curSociety->people[*inq].inqParams = new InquirerParameters;
@@ -154,6 +162,7 @@ void InquirerWindow::setSelectedInquirerIsTemplate(bool isTempl) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void InquirerWindow::setSelectedInquirerParameters(const InquirerParameters& params) {
+	app->undos.touchInquirers(*curSociety, societyWindow->view->selectedInquirers);
 	for(set<t_int>::iterator inq = societyWindow->view->selectedInquirers.begin(); inq != societyWindow->view->selectedInquirers.end(); ++inq) {
 		if(!curSociety->people[*inq].inqParams) curSociety->people[*inq].inqParams = new InquirerParameters(params);
 		else *(curSociety->people[*inq].inqParams) = params;
@@ -224,6 +233,7 @@ void LinkWindow::configure(void) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void LinkWindow::setSelectedLinkListenChances(t_float listenChance) {
+	app->undos.touchLinks(*curSociety, societyWindow->view->selectedLinks);
 	for(set<pair<t_int, t_int> >::iterator link = societyWindow->view->selectedLinks.begin(); link != societyWindow->view->selectedLinks.end(); ++link) curSociety->getLink(link->first, link->second)->listenChance = listenChance;
 	redraw();
 	app->touchFile();
@@ -232,6 +242,7 @@ void LinkWindow::setSelectedLinkListenChances(t_float listenChance) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void LinkWindow::setSelectedLinkThresholds(t_float threshold) {
+	app->undos.touchLinks(*curSociety, societyWindow->view->selectedLinks);
 	for(set<pair<t_int, t_int> >::iterator link = societyWindow->view->selectedLinks.begin(); link != societyWindow->view->selectedLinks.end(); ++link) curSociety->getLink(link->first, link->second)->threshold = threshold;
 	app->touchFile();
 }
@@ -239,6 +250,7 @@ void LinkWindow::setSelectedLinkThresholds(t_float threshold) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void LinkWindow::setSelectedLinkTrustFromPreset(t_int presetValue) {
+	app->undos.touchLinks(*curSociety, societyWindow->view->selectedLinks);
 	for(set<pair<t_int, t_int> >::iterator link = societyWindow->view->selectedLinks.begin(); link != societyWindow->view->selectedLinks.end(); ++link) curSociety->getLink(link->first, link->second)->trust.setFromPreset(presetValue);
 	configure();
 	app->touchFile();
@@ -247,6 +259,7 @@ void LinkWindow::setSelectedLinkTrustFromPreset(t_int presetValue) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void LinkWindow::setSelectedLinkTrustFromDistribution(const Distribution& d) {
+	app->undos.touchLinks(*curSociety, societyWindow->view->selectedLinks);
 	for(set<pair<t_int, t_int> >::iterator link = societyWindow->view->selectedLinks.begin(); link != societyWindow->view->selectedLinks.end(); ++link) d.toTrustFunction(&curSociety->getLink(link->first, link->second)->trust);
 	configure();
 	app->touchFile();
@@ -255,6 +268,7 @@ void LinkWindow::setSelectedLinkTrustFromDistribution(const Distribution& d) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void LinkWindow::setSelectedLinkUpdateTrust(bool update) {
+	app->undos.touchLinks(*curSociety, societyWindow->view->selectedLinks);
 	for(set<pair<t_int, t_int> >::iterator link = societyWindow->view->selectedLinks.begin(); link != societyWindow->view->selectedLinks.end(); ++link) curSociety->getLink(link->first, link->second)->updateTrust = update;
 	app->touchFile();
 }
@@ -262,6 +276,7 @@ void LinkWindow::setSelectedLinkUpdateTrust(bool update) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void LinkWindow::setSelectedLinkParameters(const LinkParameters& params) {
+	app->undos.touchLinks(*curSociety, societyWindow->view->selectedLinks);
 	for(set<pair<t_int, t_int> >::iterator link = societyWindow->view->selectedLinks.begin(); link != societyWindow->view->selectedLinks.end(); ++link) {
 		if(!curSociety->getLink(link->first, link->second)->linkParams) curSociety->getLink(link->first, link->second)->linkParams = new LinkParameters(params);
 		else *(curSociety->getLink(link->first, link->second)->linkParams) = params;
@@ -272,6 +287,7 @@ void LinkWindow::setSelectedLinkParameters(const LinkParameters& params) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void LinkWindow::setSelectedLinkNewEvidenceReq(t_int policy) {
+	app->undos.touchLinks(*curSociety, societyWindow->view->selectedLinks);
 	for(set<pair<t_int, t_int> >::iterator link = societyWindow->view->selectedLinks.begin(); link != societyWindow->view->selectedLinks.end(); ++link) curSociety->getLink(link->first, link->second)->evidencePolicy = policy;
 	app->touchFile();
 }
@@ -279,6 +295,7 @@ void LinkWindow::setSelectedLinkNewEvidenceReq(t_int policy) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void LinkWindow::setSelectedLinkExcludePrior(bool excl) {
+	app->undos.touchLinks(*curSociety, societyWindow->view->selectedLinks);
 	for(set<pair<t_int, t_int> >::iterator link = societyWindow->view->selectedLinks.begin(); link != societyWindow->view->selectedLinks.end(); ++link) curSociety->getLink(link->first, link->second)->countPriorAsEvidence = excl;
 	app->touchFile();
 }
@@ -286,6 +303,7 @@ void LinkWindow::setSelectedLinkExcludePrior(bool excl) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void LinkWindow::setSelectedLinkIsTemplate(bool isTempl) {
+	app->undos.touchLinks(*curSociety, societyWindow->view->selectedLinks);
 	if(isTempl) {
 		for(set<pair<t_int, t_int> >::iterator link = societyWindow->view->selectedLinks.begin(); link != societyWindow->view->selectedLinks.end(); ++link)
 			if(!curSociety->getLink(link->first, link->second)->linkParams) curSociety->getLink(link->first, link->second)->linkParams = new LinkParameters;
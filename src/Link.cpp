@@ -36,6 +36,13 @@ Link::Link(t_int from, t_int to, const Link& l) {
 
 //-----------------------------------------------------------------------------------------------------------------------
 
+Link::Link(const Link& l) {
+	linkParams = NULL;
+	*this = l;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
 Link& Link::operator=(const Link& l) {
 	source = l.source;
 	target = l.target;
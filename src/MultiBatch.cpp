@@ -2,15 +2,24 @@
 #include <FL/Fl.H>
 #include "Utility.h"
 #include "UserInterfaceItems.h"
+#include "App.h"
+#include "Profiler.h"
 #include <FL/filename.H>
+#include <time.h>
+#include <algorithm>
 
 //-----------------------------------------------------------------------------------------------------------------------
 
 MultiBatch::MultiBatch(void) {
 	for(t_int i = 0; i < 4; ++i) batches[i].displayResults = false;
+	seed = runSeed = 0;
+	commonRandomNumbers = antithetic = false;
+	refine = false;
+	refineThreshold = 0.05;
+	refineBudget = 100;
+	checkpoint = false;
+	lastCheckpoint = 0;
 	templateSociety = 0;
-    values = 0;
-    titles = 0;
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
@@ -19,33 +28,78 @@ MultiBatch::MultiBatch(TiXmlElement* xml) {
 	// read fields
 	xml->QueryIntAttribute("STEPS_A_TO_B", &stepsAtoB);
 	xml->QueryIntAttribute("STEPS_A_TO_C", &stepsAtoC);
+	seed = runSeed = 0;
+	xml->QueryIntAttribute("SEED", &seed);
+	commonRandomNumbers = xml->Attribute("COMMON_RANDOM_NUMBERS") && strcmp(xml->Attribute("COMMON_RANDOM_NUMBERS"), "true") == 0;
+	antithetic = xml->Attribute("ANTITHETIC") && strcmp(xml->Attribute("ANTITHETIC"), "true") == 0;
+	refine = false;
+	refineThreshold = 0.05;
+	refineBudget = 100;
+	if(xml->Attribute("REFINE") && strcmp(xml->Attribute("REFINE"), "true") == 0) {
+		double v;
+		refine = true;
+		if(xml->QueryDoubleAttribute("REFINE_THRESHOLD", &v) == TIXML_SUCCESS) refineThreshold = v;
+		xml->QueryIntAttribute("REFINE_BUDGET", &refineBudget);
+	}
 	batches[BATCH_A] = BatchSimulation(xml->FirstChildElement("BATCH_A"));
 	batches[BATCH_B] = BatchSimulation(xml->FirstChildElement("BATCH_B"));
 	batches[BATCH_C] = BatchSimulation(xml->FirstChildElement("BATCH_C"));
 	batches[BATCH_D] = BatchSimulation(xml->FirstChildElement("BATCH_D"));
+	checkpoint = false;
+	lastCheckpoint = 0;
     templateSociety = 0;
-	values = 0;
-	titles = 0;
  }
 
 //-----------------------------------------------------------------------------------------------------------------------
 
-void MultiBatch::generateBatch(t_float x, t_float y) {
+void MultiBatch::interpolateBatch(BatchSimulation& bs, t_float x, t_float y) {
 	BatchSimulation bs1(batches[BATCH_A], batches[BATCH_B], x);
 	if(stepsAtoC > 1) {
 		BatchSimulation bs2(batches[BATCH_C], batches[BATCH_D], x);
-		curBatch = BatchSimulation(bs1, bs2, y);
+		bs = BatchSimulation(bs1, bs2, y);
 	}
-	else curBatch = bs1;
+	else bs = bs1;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
 
+void MultiBatch::generateBatch(t_float x, t_float y) {
+	interpolateBatch(curBatch, x, y);
 	curBatch.templateSociety = new Society(*templateSociety);
-	curBatch.curTrial = curBatch.sim.curStep = curBatch.curStage = 0;
+	curBatch.curTrial = curBatch.sim.curStep = curBatch.curStage = curBatch.nTrialsRun = 0;
+	curBatch.seed = commonRandomNumbers ? runSeed : DeriveRandomSeed(runSeed, xStep + yStep * stepsAtoB);
+	curBatch.commonRandomNumbers = commonRandomNumbers;
+	curBatch.antithetic = antithetic;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+BatchSimulation* MultiBatch::makeBatch(t_int point) {
+	t_float u = (t_float)(1 << MULTIBATCH_MAX_REFINEMENT);
+	t_float x = stepsAtoB > 1 ? (t_float)points[point].i / (u * (stepsAtoB - 1)) : 0;
+	t_float y = stepsAtoC > 1 ? (t_float)points[point].j / (u * (stepsAtoC - 1)) : 0;
+	BatchSimulation* bs = new BatchSimulation;
+	interpolateBatch(*bs, x, y);
+	if(bs->templateSociety) delete bs->templateSociety;
+	bs->templateSociety = new Society(*templateSociety);
+	bs->curTrial = bs->sim.curStep = bs->curStage = bs->nTrialsRun = 0;
+
+	// with common random numbers, trial i of every point has the same streams
+	bs->seed = commonRandomNumbers ? runSeed : DeriveRandomSeed(runSeed, point);
+	bs->commonRandomNumbers = commonRandomNumbers;
+	bs->antithetic = antithetic;
+	return bs;
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
 
 void MultiBatch::setDefault(void) {
 	stepsAtoB = stepsAtoC = 10;
+	seed = 0;
+	commonRandomNumbers = antithetic = false;
+	refine = false;
+	refineThreshold = 0.05;
+	refineBudget = 100;
 	if (templateSociety) delete templateSociety;
 	templateSociety = new Society(*curSociety);
 	for(t_int i = 0; i < 4; ++i) batches[i].setDefault(this);
@@ -61,6 +115,14 @@ TiXmlElement* MultiBatch::toXML(const char *name) {
 
 	xml->SetAttribute("STEPS_A_TO_B", stepsAtoB);
 	xml->SetAttribute("STEPS_A_TO_C", stepsAtoC);
+	xml->SetAttribute("SEED", seed);
+	if(commonRandomNumbers) xml->SetAttribute("COMMON_RANDOM_NUMBERS", "true");
+	if(antithetic) xml->SetAttribute("ANTITHETIC", "true");
+	if(refine) {
+		xml->SetAttribute("REFINE", "true");
+		xml->SetDoubleAttribute("REFINE_THRESHOLD", refineThreshold);
+		xml->SetAttribute("REFINE_BUDGET", refineBudget);
+	}
 	xml->LinkEndChild(batches[BATCH_A].toXML("BATCH_A"));
 	xml->LinkEndChild(batches[BATCH_B].toXML("BATCH_B"));
 	xml->LinkEndChild(batches[BATCH_C].toXML("BATCH_C"));
@@ -71,65 +133,167 @@ TiXmlElement* MultiBatch::toXML(const char *name) {
 
 //-----------------------------------------------------------------------------------------------------------------------
 
-void MultiBatch::recordBatchStatistics(void) {
-	values[stepsAtoC * stepsAtoB * 0 + stepsAtoB * yStep + xStep] = curBatch.stats.totalEValue;
-	values[stepsAtoC * stepsAtoB * 1 + stepsAtoB * yStep + xStep] = curBatch.stats.totalEValueDelta;
-	values[stepsAtoC * stepsAtoB * 2 + stepsAtoB * yStep + xStep] = curBatch.stats.totalPolarisation;
-	values[stepsAtoC * stepsAtoB * 3 + stepsAtoB * yStep + xStep] = curBatch.stats.totalPolarisationDelta;
-	titles[xStep + yStep * stepsAtoB] = curBatch.getDescription();
+void MultiBatch::recordBatchStatistics(BatchSimulation& bs, t_int point) {
+	MultiBatchPoint& p = points[point];
+	p.values[0] = bs.stats.totalEValue;
+	p.values[1] = bs.stats.totalEValueDelta;
+	p.values[2] = bs.stats.totalPolarisation;
+	p.values[3] = bs.stats.totalPolarisationDelta;
+	p.values[4] = bs.nTrialsRun;
+	p.title = bs.getDescription();
+	p.done = true;
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
 
-void MultiBatch::process(void) {
-	// run current batch
-	Fl::add_timeout(BATCH_SIMULATION_TIMEOUT, BatchSimulationTimeout, &curBatch);
-	curBatch.timeOut = false;
- 	curBatch.process();
-
-	if(curBatch.curTrial == curBatch.nTrials && curBatch.sim.curStep == curBatch.totalSteps() ) {
-		// finished batch; record statistics
-		recordBatchStatistics();
-
-		// step to next batch
-		++xStep;
-		if(xStep == stepsAtoB) {
-			++yStep;
-			if(yStep == stepsAtoC) {
-				// finished; write out results file
-				Fl::remove_idle(MultiBatchProcess, this);
-				saveStatisticsToFile();
-				doubleProgressWindow->closeDialog(true);
-				return;
-			}
-			else xStep = 0;
+t_int MultiBatch::addPoint(t_int i, t_int j) {
+	map<pair<t_int, t_int>, t_int>::iterator p = pointAt.find(pair<t_int, t_int>(i, j));
+	if(p != pointAt.end()) return p->second;
+	MultiBatchPoint pt;
+	pt.i = i;
+	pt.j = j;
+	points.push_back(pt);
+	pointAt[pair<t_int, t_int>(i, j)] = points.size() - 1;
+	return points.size() - 1;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_float MultiBatch::cellDifference(const MultiBatchCell& c) {
+	// corners of the cell, or ends of the line
+	t_int corners[4], n = 0;
+	corners[n++] = pointAt[pair<t_int, t_int>(c.i, c.j)];
+	if(stepsAtoB > 1) corners[n++] = pointAt[pair<t_int, t_int>(c.i + c.size, c.j)];
+	if(stepsAtoC > 1) corners[n++] = pointAt[pair<t_int, t_int>(c.i, c.j + c.size)];
+	if(stepsAtoB > 1 && stepsAtoC > 1) corners[n++] = pointAt[pair<t_int, t_int>(c.i + c.size, c.j + c.size)];
+
+	// largest difference in e-value (value 0) or polarisation (value 2) between any two of them
+	t_float d = 0;
+	for(t_int v = 0; v <= 2; v += 2) for(t_int a = 1; a < n; ++a) for(t_int b = 0; b < a; ++b) {
+		t_float e = fabs(points[corners[a]].values[v] - points[corners[b]].values[v]);
+		if(e > d) d = e;
+	}
+	return d;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool MultiBatch::refineGrid(void) {
+	// cells steep enough to split, steepest first
+	vector<pair<t_float, t_int> > steep;
+	for(t_int k = 0; k < cells.size(); ++k) {
+		if(cells[k].size < 2) continue;
+		t_float d = cellDifference(cells[k]);
+		if(d > refineThreshold) steep.push_back(pair<t_float, t_int>(d, k));
+	}
+	sort(steep.begin(), steep.end(), [](const pair<t_float, t_int>& a, const pair<t_float, t_int>& b) {
+		return a.first > b.first || (a.first == b.first && a.second < b.second);
+	});
+
+	// split them in four, or in two along a line, while the budget lasts. Points on edges may already be there from a
+	// neighbouring cell.
+	bool alongB = stepsAtoB > 1, alongC = stepsAtoC > 1;
+	t_int nGrid = stepsAtoB * stepsAtoC;
+	passStart = points.size();
+	vector<MultiBatchCell> split;
+	for(t_int k = 0; k < steep.size(); ++k) {
+		MultiBatchCell c = cells[steep[k].second];
+		t_int h = c.size / 2;
+		vector<pair<t_int, t_int> > added;
+		if(alongB) added.push_back(pair<t_int, t_int>(c.i + h, c.j));
+		if(alongC) added.push_back(pair<t_int, t_int>(c.i, c.j + h));
+		if(alongB && alongC) {
+			added.push_back(pair<t_int, t_int>(c.i + h, c.j + h));
+			added.push_back(pair<t_int, t_int>(c.i + c.size, c.j + h));
+			added.push_back(pair<t_int, t_int>(c.i + h, c.j + c.size));
 		}
+		t_int nNew = 0;
+		for(t_int a = 0; a < added.size(); ++a) if(pointAt.find(added[a]) == pointAt.end()) ++nNew;
+		if((t_int)points.size() + nNew - nGrid > refineBudget) break;
+
+		for(t_int a = 0; a < added.size(); ++a) addPoint(added[a].first, added[a].second);
+		split.push_back(MultiBatchCell(c.i, c.j, h));
+		if(alongB) split.push_back(MultiBatchCell(c.i + h, c.j, h));
+		if(alongC) split.push_back(MultiBatchCell(c.i, c.j + h, h));
+		if(alongB && alongC) split.push_back(MultiBatchCell(c.i + h, c.j + h, h));
+	}
+	cells = split;
+	return points.size() > passStart;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void MultiBatch::runPoints(void) {
+	running.clear();
+	for(t_int k = passStart; k < points.size(); ++k) if(!points[k].done) running.push_back(k);
+	batchScheduler.start(running.size(), [this](t_int k) { return makeBatch(running[k]); });
+}
 
-		// create a new batch
-		generateBatch((t_float)xStep / (t_float)(stepsAtoB - 1), (t_float)yStep / (t_float)(stepsAtoC - 1));
+//-----------------------------------------------------------------------------------------------------------------------
 
-		// fill out progress
-		string str = string(IntToString(xStep + yStep * stepsAtoB + 1)) + string(" / ") + string(IntToString(stepsAtoB * stepsAtoC));
-		doubleProgressWindow->outputSecondProgress->value(str.c_str());
+void MultiBatch::process(void) {
+	// record batches as they finish, in whatever order that is
+	BatchSimulation* bs;
+	for(t_int k = batchScheduler.takeFinished(bs); k >= 0; k = batchScheduler.takeFinished(bs)) {
+		recordBatchStatistics(*bs, running[k]);
+		delete bs;
+		++pointsDone;
+	}
+	if(checkpoint && time(0) - lastCheckpoint >= CHECKPOINT_INTERVAL && !saveCheckpoint()) {
+		fl_alert("Could not save checkpoint to %s. The multibatch simulation goes on without checkpoints.", CheckpointFileName(filename).c_str());
+		checkpoint = false;
 	}
+
+	// fill out progress
+	t_int nPoints = points.size();
+	doubleProgressWindow->barProgress->value((t_float)pointsDone * 100.0 / (t_float)nPoints);
+	string str = string(IntToString(pointsDone)) + string(" / ") + string(IntToString(nPoints));
+	doubleProgressWindow->outputSecondProgress->value(str.c_str());
+	long long trials, inquirerSteps, linkVisits;
+	batchScheduler.workDone(trials, inquirerSteps, linkVisits);
+	doubleProgressWindow->throughput.total = nPoints;
+	if(doubleProgressWindow->throughput.update(pointsDone, trials, inquirerSteps, linkVisits)) doubleProgressWindow->boxThroughput->copy_label(doubleProgressWindow->throughput.describe().c_str());
+
+	if(pointsDone == nPoints) {
+		batchScheduler.stop();
+
+		// add points where the results change quickly, if asked to
+		if(refine && refineGrid()) {
+			if(checkpoint) saveCheckpoint();
+			runPoints();
+			Fl::repeat_timeout(MULTIBATCH_POLL_INTERVAL, MultiBatchProcess, this);
+			return;
+		}
+
+		// finished; write out results file
+		saveStatisticsToFile();
+		saveManifest();
+		if(ProfileEnabled()) SaveProfile(ProfileFileName(filename).c_str());
+		remove(CheckpointFileName(filename).c_str());
+		doubleProgressWindow->closeDialog(true);
+	}
+	else Fl::repeat_timeout(MULTIBATCH_POLL_INTERVAL, MultiBatchProcess, this);
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
 
 
 void MultiBatch::saveStatisticsToFile(void) {
+	string ssNames[N_MULTIBATCH_VALUES + 1] = {"E-value", "E-value delta", "Polarisation", "Polarisation delta", "Trials", "Parameters"};
+	if(refine) {
+		saveRefinedStatisticsToFile(ssNames);
+		return;
+	}
 	XMLData* data = new XMLData[(stepsAtoB) * (stepsAtoC) * (N_MULTIBATCH_VALUES + 1)];
-	string ssNames[N_MULTIBATCH_VALUES + 1] = {"E-value", "E-value delta", "Polarisation", "Polarisation delta", "Parameters"};
-
 
 	// fill out values
 	for(t_int k = 0; k < N_MULTIBATCH_VALUES; ++k) {
 		for(t_int j = 0; j < stepsAtoC; ++j) for(t_int i = 0; i < stepsAtoB; ++i)
-			data[k * stepsAtoC * stepsAtoB + j * stepsAtoB + i].setDouble(values[k * stepsAtoC * stepsAtoB + j * stepsAtoB + i]);
+			data[k * stepsAtoC * stepsAtoB + j * stepsAtoB + i].setDouble(points[j * stepsAtoB + i].values[k]);
 	}
 
 	// fill out titles
-	for(t_int j = 0; j < stepsAtoC; ++j) for(t_int i = 0; i < stepsAtoB; ++i) data[4 * stepsAtoC * stepsAtoB + j * stepsAtoB + i].setString(titles[j * stepsAtoB + i]);
+	for(t_int j = 0; j < stepsAtoC; ++j) for(t_int i = 0; i < stepsAtoB; ++i) data[N_MULTIBATCH_VALUES * stepsAtoC * stepsAtoB + j * stepsAtoB + i].setString(points[j * stepsAtoB + i].title);
 
 	// write to file
 	SaveDataAsSpreadsheet(data, stepsAtoB, stepsAtoC, N_MULTIBATCH_VALUES + 1, ssNames, filename);
@@ -138,6 +302,124 @@ void MultiBatch::saveStatisticsToFile(void) {
 
 //-----------------------------------------------------------------------------------------------------------------------
 
+void MultiBatch::saveRefinedStatisticsToFile(string* names) {
+	// points in order of place, by Y and then X
+	vector<t_int> order(points.size());
+	for(t_int k = 0; k < order.size(); ++k) order[k] = k;
+	sort(order.begin(), order.end(), [this](t_int a, t_int b) {
+		return points[a].j < points[b].j || (points[a].j == points[b].j && points[a].i < points[b].i);
+	});
+
+	// one line for each point - its place in grid steps, then the values & parameters
+	t_int w = N_MULTIBATCH_VALUES + 3, h = points.size() + 1;
+	t_float u = (t_float)(1 << MULTIBATCH_MAX_REFINEMENT);
+	XMLData* data = new XMLData[w * h];
+	data[0].setString("X");
+	data[1].setString("Y");
+	for(t_int k = 0; k <= N_MULTIBATCH_VALUES; ++k) data[2 + k].setString(names[k]);
+	for(t_int r = 0; r < points.size(); ++r) {
+		const MultiBatchPoint& p = points[order[r]];
+		XMLData* line = data + (r + 1) * w;
+		line[0].setDouble((t_float)p.i / u);
+		line[1].setDouble((t_float)p.j / u);
+		for(t_int k = 0; k < N_MULTIBATCH_VALUES; ++k) line[2 + k].setDouble(p.values[k]);
+		line[2 + N_MULTIBATCH_VALUES].setString(p.title);
+	}
+
+	// write to file
+	string sheet = "Points";
+	SaveDataAsSpreadsheet(data, w, h, 1, &sheet, filename);
+	delete [] data;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void MultiBatch::saveManifest(void) {
+	// a multibatch file, which runs the same batches again when opened
+	TiXmlDocument f;
+	TiXmlDeclaration* decl = new TiXmlDeclaration( "1.0", "UTF-8", "true" );
+	f.LinkEndChild(decl);
+	TiXmlElement *root = new TiXmlElement("MULTIBATCH_FILE");
+	root->SetAttribute("VERSION", LAPUTA_VERSION);
+	root->SetAttribute("RESULTS", fl_filename_name(filename));
+	time_t now = time(0);
+	char date[64];
+	strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&now));
+	root->SetAttribute("DATE", date);
+	f.LinkEndChild(root);
+	TiXmlElement *xml = toXML();
+	xml->SetAttribute("SEED", runSeed);
+	root->LinkEndChild(xml);
+
+	// write out everything
+	char manifest[FL_PATH_MAX];
+	strcpy(manifest, filename);
+	fl_filename_setext(manifest, FL_PATH_MAX, ".manifest.mbatch");
+	f.SaveFile(manifest);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool MultiBatch::saveCheckpoint(void) {
+	lastCheckpoint = time(0);
+	TiXmlElement* xml = toXML();
+	xml->SetAttribute("RESULTS", filename);
+	CheckpointFile f;
+	f.create(CheckpointFileName(filename).c_str(), CHECKPOINT_MULTIBATCH, xml, templateSociety);
+	f.putInt(runSeed);
+	f.putInt(passStart);
+
+	// points, with the results of those done, and the cells being refined
+	f.putInt(points.size());
+	for(t_int k = 0; k < points.size(); ++k) {
+		const MultiBatchPoint& p = points[k];
+		f.putInt(p.i);
+		f.putInt(p.j);
+		f.putInt(p.done);
+		if(p.done) {
+			f.putBytes(p.values, sizeof(p.values));
+			f.putString(p.title);
+		}
+	}
+	f.putInt(cells.size());
+	for(t_int k = 0; k < cells.size(); ++k) {
+		f.putInt(cells[k].i);
+		f.putInt(cells[k].j);
+		f.putInt(cells[k].size);
+	}
+	return f.commit();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool MultiBatch::resume(CheckpointFile& f) {
+	runSeed = f.getInt();
+	passStart = f.getInt();
+	points.clear();
+	pointAt.clear();
+	cells.clear();
+	pointsDone = 0;
+	t_int n = f.getInt();
+	for(t_int k = 0; k < n && f.good(); ++k) {
+		t_int i = f.getInt(), j = f.getInt();
+		MultiBatchPoint& p = points[addPoint(i, j)];
+		p.done = f.getInt();
+		if(p.done) {
+			f.getBytes(p.values, sizeof(p.values));
+			p.title = f.getString();
+			++pointsDone;
+		}
+	}
+	n = f.getInt();
+	for(t_int k = 0; k < n && f.good(); ++k) {
+		t_int i = f.getInt(), j = f.getInt();
+		cells.push_back(MultiBatchCell(i, j, f.getInt()));
+	}
+	return f.good() && passStart <= points.size() && points.size() >= stepsAtoB * stepsAtoC;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
 void MultiBatchProcess(void* data) {
 	// take a step
 	MultiBatch* mb = (MultiBatch*)data;
@@ -147,17 +429,33 @@ void MultiBatchProcess(void* data) {
 
 //-----------------------------------------------------------------------------------------------------------------------
 
-void StartMultiBatchSimulation(MultiBatch* mb) {
-	// create first batch
+void StartMultiBatchSimulation(MultiBatch* mb, bool resumed) {
 	mb->xStep = mb->yStep = 0;
 	for(t_int i = 0; i < 4; ++i) mb->batches[i].sim.soc = curSociety;
-	mb->curBatch = mb->batches[BATCH_A];
-	mb->values = new t_float[mb->stepsAtoB * mb->stepsAtoC * 4];
-	mb->titles = new string[mb->stepsAtoB * mb->stepsAtoC];
 	if (mb->templateSociety) delete mb->templateSociety;
 	mb->templateSociety = new Society(*curSociety);
+	mb->checkpoint = true;
+	mb->lastCheckpoint = time(0);
+
+	// the grid, numbered along A to B first, and its cells if it is to be refined - a resumed multibatch has its points
+	if(!resumed) {
+		t_int u = 1 << MULTIBATCH_MAX_REFINEMENT;
+		mb->pointsDone = mb->passStart = 0;
+		mb->runSeed = mb->seed ? mb->seed : NewRandomSeed();
+		mb->points.clear();
+		mb->pointAt.clear();
+		mb->cells.clear();
+		for(t_int y = 0; y < mb->stepsAtoC; ++y) for(t_int x = 0; x < mb->stepsAtoB; ++x) mb->addPoint(x * u, y * u);
+		if(mb->refine && (mb->stepsAtoB > 1 || mb->stepsAtoC > 1)) {
+			// squares, or lines along whichever axis has more than one step
+			t_int columns = mb->stepsAtoB > 1 ? mb->stepsAtoB - 1 : 1, rows = mb->stepsAtoC > 1 ? mb->stepsAtoC - 1 : 1;
+			for(t_int y = 0; y < rows; ++y) for(t_int x = 0; x < columns; ++x) mb->cells.push_back(MultiBatchCell(x * u, y * u, u));
+		}
+	}
 
-	// start simulating
+	// run the batches on all cores, and collect them here as they finish
+	ResetProfile();
 	societyWindow->showDialog(DIALOG_DOUBLE_PROGRESS, mb);
-	Fl::add_idle(MultiBatchProcess, mb);
+	mb->runPoints();
+	Fl::add_timeout(MULTIBATCH_POLL_INTERVAL, MultiBatchProcess, mb);
 }
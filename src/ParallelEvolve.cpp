@@ -0,0 +1,198 @@
+#include "ParallelEvolve.h"
+#include "Society.h"
+#include "Distribution.h"
+#include "Profiler.h"
+
+ParallelEvolve parallelEvolve;
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool ParallelEvolve::worthwhile(const Society* s) {
+	// with one processor, the blocks are simply done one after the other, so that results are the same everywhere
+	return s->people.size() >= PARALLEL_EVOLVE_MIN_INQUIRERS;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void ParallelEvolve::start(t_int n) {
+	nThreads = n;
+	quit = false;
+	firstBlock.resize(n + 1);
+
+	// the calling thread does the first share of the work itself
+	for(t_int k = 1; k < n; ++k) threads.push_back(thread(&ParallelEvolve::worker, this, k));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void ParallelEvolve::stop(void) {
+	{
+		lock_guard<mutex> g(lock);
+		quit = true;
+	}
+	wake.notify_all();
+	for(t_int k = 0; k < threads.size(); ++k) threads[k].join();
+	threads.clear();
+	nThreads = 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool ParallelEvolve::step(Simulation* s, Society* society) {
+	if(s->stepEngine != STEP_ENGINE_BLOCKS) return false;
+
+	// each thread steps its own societies, with dice that are freed when it ends
+	static thread_local ParallelStep w;
+	w.prepare(s, society);
+
+	// take the step on the shared threads, or all on this one if the society is small, log messages have to come in
+	// order, or another simulation has the threads
+	unique_lock<mutex> busy(inUse, defer_lock);
+	if(s->logLevel == LOG_NONE && worthwhile(society)) busy.try_lock();
+	if(busy.owns_lock()) {
+		if(nThreads == 0) start(thread::hardware_concurrency() > 1 ? thread::hardware_concurrency() : 1);
+		work = &w;
+		for(t_int k = 0; k <= nThreads; ++k) firstBlock[k] = (t_int)((long long)w.nBlocks * k / nThreads);
+		{
+			PROFILE_SCOPE(PROFILE_INQUIRIES);
+			run(ParallelStep::PHASE_ACTIVITY);
+			run(ParallelStep::PHASE_INQUIRY);
+		}
+		{
+			PROFILE_SCOPE(PROFILE_MESSAGE_RECORDING);
+			run(ParallelStep::PHASE_MESSAGES);
+		}
+		work = 0;
+	}
+	else {
+		{
+			PROFILE_SCOPE(PROFILE_INQUIRIES);
+			for(t_int b = 0; b < w.nBlocks; ++b) w.doBlock(b, ParallelStep::PHASE_ACTIVITY);
+			for(t_int b = 0; b < w.nBlocks; ++b) w.doBlock(b, ParallelStep::PHASE_INQUIRY);
+		}
+		{
+			PROFILE_SCOPE(PROFILE_MESSAGE_RECORDING);
+			for(t_int b = 0; b < w.nBlocks; ++b) w.doBlock(b, ParallelStep::PHASE_MESSAGES);
+		}
+	}
+
+	// add up counters
+	for(t_int b = 0; b < w.nBlocks; ++b) s->addCounters(w.counters[b]);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void ParallelEvolve::run(t_int phase) {
+	{
+		lock_guard<mutex> g(lock);
+		curPhase = phase;
+		nBusy = nThreads - 1;
+		++generation;
+	}
+	wake.notify_all();
+	doPhase(0, phase);
+
+	// wait for everyone else to finish
+	unique_lock<mutex> g(lock);
+	done.wait(g, [this] { return nBusy == 0; });
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void ParallelEvolve::worker(t_int k) {
+	t_int seen = 0;
+	for(;;) {
+		t_int phase;
+		{
+			unique_lock<mutex> g(lock);
+			wake.wait(g, [&] { return quit || generation != seen; });
+			if(quit) return;
+			seen = generation;
+			phase = curPhase;
+		}
+		doPhase(k, phase);
+		{
+			lock_guard<mutex> g(lock);
+			if(--nBusy == 0) done.notify_one();
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void ParallelEvolve::doPhase(t_int k, t_int phase) {
+	for(t_int b = firstBlock[k]; b < firstBlock[k + 1]; ++b) work->doBlock(b, phase);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+ParallelStep::~ParallelStep() {
+	for(t_int b = 0; b < rngs.size(); ++b) if(rngs[b]) gsl_rng_free(rngs[b]);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void ParallelStep::prepare(Simulation* s, Society* society) {
+	sim = s;
+	soc = society;
+	t_int n = soc->people.size();
+	nBlocks = (n + PARALLEL_EVOLVE_BLOCK_SIZE - 1) / PARALLEL_EVOLVE_BLOCK_SIZE;
+
+	// give each block its own dice
+	if(rngs.size() < nBlocks) {
+		rngs.resize(nBlocks, 0);
+		uniforms.resize(nBlocks);
+		counters.resize(nBlocks);
+	}
+	// the seed is read the same way round in both trials of an antithetic pair, so that their blocks mirror each other
+	unsigned long x = gsl_rng_get(rng);
+	if(IsAntithetic(rng)) x = rng->type->max + rng->type->min - x;
+	t_int seed = (t_int)(x & 0x7FFFFFFF);
+	for(t_int b = 0; b < nBlocks; ++b) {
+		if(rngs[b] && rngs[b]->type != rng->type) {
+			gsl_rng_free(rngs[b]);
+			rngs[b] = 0;
+		}
+		if(!rngs[b]) rngs[b] = gsl_rng_alloc(rng->type);
+		SeedRandomStream(rngs[b], seed, b);
+		uniforms[b].clear();
+		counters[b].clearCounters();
+	}
+	activity.resize(n);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void ParallelStep::doBlock(t_int b, t_int phase) {
+	t_int first = b * PARALLEL_EVOLVE_BLOCK_SIZE, last = first + PARALLEL_EVOLVE_BLOCK_SIZE;
+	if(last > soc->people.size()) last = soc->people.size();
+
+	if(phase == PHASE_ACTIVITY) {
+		// note what has happened to our inquirers so far, since other threads can't look at them while we work
+		for(t_int i = first; i < last; ++i) {
+			InquirerActivity& a = activity[i];
+			a.lastInquiryResult = soc->people[i].lastInquiryResult;
+			a.lastHeard = a.lastHeardOtherwise = -1;
+			a.lastHeardFrom = -1;
+			for(LinkIterator l = soc->links.lower_bound(LBOUND(i)); l != soc->links.upper_bound(UBOUND(i)); ++l) {
+				if(l->second.lastUsed > a.lastHeard) {
+					a.lastHeardOtherwise = a.lastHeard;
+					a.lastHeard = l->second.lastUsed;
+					a.lastHeardFrom = l->second.source;
+				}
+				else if(l->second.lastUsed > a.lastHeardOtherwise) a.lastHeardOtherwise = l->second.lastUsed;
+			}
+		}
+	}
+	else if(phase == PHASE_INQUIRY) {
+		// new beliefs for our inquirers
+		InquiryState st(rngs[b], &counters[b], activity.data(), &uniforms[b]);
+		for(t_int i = first; i < last; ++i) soc->people[i].doInquiry(sim, soc, i, st);
+	}
+	else {
+		// messages for links to our inquirers
+		LinkIterator end = soc->links.lower_bound(LBOUND(last));
+		for(LinkIterator l = soc->links.lower_bound(LBOUND(first)); l != end; ++l) soc->recordLinkMessage(l->second);
+	}
+}
@@ -0,0 +1,172 @@
+#include "Profiler.h"
+#include "App.h"
+#include <FL/filename.H>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+using namespace std::chrono;
+
+#ifdef LAPUTA_PROFILE
+
+static const char* phaseNames[N_PROFILE_PHASES] = {"society_creation", "simulation_reset", "inquiries", "message_recording", "belief_updates", "trial_statistics", "topology_recording", "layout"};
+static const char* phaseLabels[N_PROFILE_PHASES] = {"Society creation", "Simulation reset", "Inquiries", "Message recording", "Belief updates", "Trial statistics", "Topology recording", "Layout"};
+static const char* counterNames[N_PROFILE_COUNTERS] = {"messages", "trust_updates", "random_draws"};
+static const char* counterLabels[N_PROFILE_COUNTERS] = {"Messages", "Trust updates", "Random draws"};
+
+// counts of every running thread that has counted anything, and of those that have ended, so that the counts of batch
+// workers aren't lost
+thread_local ProfileCounts* threadProfile = 0;
+static vector<ProfileCounts*> allProfiles;
+static ProfileCounts retiredProfile;
+static mutex profileMutex;
+
+// when the profile was reset, to tell how fast the time stamp counter runs
+static steady_clock::time_point profileStart = steady_clock::now();
+static unsigned long long profileStartTicks = ProfileTicks();
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+// add the counts c to t
+static void AddProfile(ProfileCounts& t, const ProfileCounts& c) {
+	for(t_int j = 0; j < N_PROFILE_PHASES; ++j) {
+		t.ticks[j] += c.ticks[j];
+		t.calls[j] += c.calls[j];
+	}
+	for(t_int j = 0; j < N_PROFILE_COUNTERS; ++j) t.counts[j] += c.counts[j];
+}
+
+// adds up the counts of its thread, and frees them, when the thread ends
+class ProfileRetirer {
+public:
+	~ProfileRetirer() {
+		if(!threadProfile) return;
+		lock_guard<mutex> lock(profileMutex);
+		AddProfile(retiredProfile, *threadProfile);
+		for(t_int i = 0; i < allProfiles.size(); ++i) if(allProfiles[i] == threadProfile) {
+			allProfiles.erase(allProfiles.begin() + i);
+			break;
+		}
+		delete threadProfile;
+		threadProfile = 0;
+	}
+};
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+ProfileCounts* NewThreadProfile(void) {
+	static thread_local ProfileRetirer retirer;
+	(void)retirer;
+	ProfileCounts* c = new ProfileCounts;
+	memset(c, 0, sizeof(ProfileCounts));
+	lock_guard<mutex> lock(profileMutex);
+	allProfiles.push_back(c);
+	return c;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void ResetProfile(void) {
+	lock_guard<mutex> lock(profileMutex);
+	for(t_int i = 0; i < allProfiles.size(); ++i) memset(allProfiles[i], 0, sizeof(ProfileCounts));
+	memset(&retiredProfile, 0, sizeof(ProfileCounts));
+	profileStart = steady_clock::now();
+	profileStartTicks = ProfileTicks();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool ProfileEnabled(void) {
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+// counts of all threads added up, with the seconds since the profile was reset & the ticks in a second
+static ProfileCounts TotalProfile(double& seconds, double& ticksPerSecond) {
+	lock_guard<mutex> lock(profileMutex);
+	ProfileCounts t = retiredProfile;
+	for(t_int i = 0; i < allProfiles.size(); ++i) AddProfile(t, *allProfiles[i]);
+	seconds = duration<double>(steady_clock::now() - profileStart).count();
+	ticksPerSecond = seconds > 0 ? (double)(ProfileTicks() - profileStartTicks) / seconds : 1.0;
+	if(ticksPerSecond <= 0) ticksPerSecond = 1.0;
+	return t;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+string ProfileSummary(void) {
+	double seconds, ticksPerSecond;
+	ProfileCounts t = TotalProfile(seconds, ticksPerSecond);
+	string s;
+	char line[256];
+
+	// phases are timed on every thread, so they can add up to more than the time taken
+	sprintf(line, "%-20s %12.3f s\n\n", "Time taken", seconds);
+	s += line;
+	for(t_int i = 0; i < N_PROFILE_PHASES; ++i) {
+		sprintf(line, "%-20s %12.3f s %14llu calls\n", phaseLabels[i], (double)t.ticks[i] / ticksPerSecond, t.calls[i]);
+		s += line;
+	}
+	s += "\n";
+	for(t_int i = 0; i < N_PROFILE_COUNTERS; ++i) {
+		sprintf(line, "%-20s %14llu\n", counterLabels[i], t.counts[i]);
+		s += line;
+	}
+	return s;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool SaveProfile(const char* filename) {
+	double seconds, ticksPerSecond;
+	ProfileCounts t = TotalProfile(seconds, ticksPerSecond);
+	FILE* f = fopen(filename, "w");
+	if(!f) return false;
+	fprintf(f, "{\n");
+	fprintf(f, "  \"version\": %d,\n", LAPUTA_VERSION);
+	fprintf(f, "  \"seconds\": %.6f,\n", seconds);
+	fprintf(f, "  \"ticks_per_second\": %.0f,\n", ticksPerSecond);
+	fprintf(f, "  \"phases\": {\n");
+	for(t_int i = 0; i < N_PROFILE_PHASES; ++i) {
+		fprintf(f, "    \"%s\": {\"seconds\": %.6f, \"calls\": %llu}%s\n", phaseNames[i], (double)t.ticks[i] / ticksPerSecond, t.calls[i],
+			i + 1 < N_PROFILE_PHASES ? "," : "");
+	}
+	fprintf(f, "  },\n");
+	fprintf(f, "  \"counters\": {\n");
+	for(t_int i = 0; i < N_PROFILE_COUNTERS; ++i) fprintf(f, "    \"%s\": %llu%s\n", counterNames[i], t.counts[i], i + 1 < N_PROFILE_COUNTERS ? "," : "");
+	fprintf(f, "  }\n");
+	fprintf(f, "}\n");
+	return fclose(f) == 0;
+}
+
+#else
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void ResetProfile(void) {}
+
+bool ProfileEnabled(void) {
+	return false;
+}
+
+string ProfileSummary(void) {
+	return string("Profiling is not compiled into this build of Laputa.\n");
+}
+
+bool SaveProfile(const char* filename) {
+	return false;
+}
+
+#endif
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+string ProfileFileName(const char* resultsFile) {
+	char filename[FL_PATH_MAX];
+	strcpy(filename, resultsFile);
+	fl_filename_setext(filename, FL_PATH_MAX, ".profile.json");
+	return string(filename);
+}
@@ -0,0 +1,506 @@
+#include "Random.h"
+#include "Distribution.h"
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <immintrin.h>
+
+// AVX2 is picked at run time where the compiler allows it, since the rest of the program only asks for AVX
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RANDOM_AVX2
+#define RANDOM_AVX2_TARGET __attribute__((target("avx2")))
+#define RANDOM_HAVE_AVX2() __builtin_cpu_supports("avx2")
+#elif defined(__AVX2__)
+#define RANDOM_AVX2
+#define RANDOM_AVX2_TARGET
+#define RANDOM_HAVE_AVX2() true
+#endif
+
+#define XOSHIRO_LANES 4
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+// 64 random bits to a double in [0, 1), done the same way with and without AVX2
+static inline double ToUniform(uint64_t x) {
+	uint64_t bits = (x >> 12) | 0x3FF0000000000000ULL;
+	double d;
+	memcpy(&d, &bits, sizeof(d));
+	return d - 1.0;
+}
+
+// spread a seed over several words
+static inline uint64_t SplitMix(uint64_t& x) {
+	uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static inline uint64_t Rotl(uint64_t x, t_int k) { return (x << k) | (x >> (64 - k)); }
+
+//-----------------------------------------------------------------------------------------------------------------------
+// xoshiro256++
+//-----------------------------------------------------------------------------------------------------------------------
+
+struct XoshiroState {
+	// words of each stream, word-major so that the streams can be stepped together. Numbers are taken from the
+	// streams in turn.
+	uint64_t s[4][XOSHIRO_LANES];
+	t_int lane;
+};
+
+static inline uint64_t XoshiroStep(XoshiroState* st, t_int l) {
+	uint64_t result = Rotl(st->s[0][l] + st->s[3][l], 23) + st->s[0][l];
+	uint64_t t = st->s[1][l] << 17;
+	st->s[2][l] ^= st->s[0][l];
+	st->s[3][l] ^= st->s[1][l];
+	st->s[1][l] ^= st->s[2][l];
+	st->s[0][l] ^= st->s[3][l];
+	st->s[2][l] ^= t;
+	st->s[3][l] = Rotl(st->s[3][l], 45);
+	return result;
+}
+
+static inline uint64_t XoshiroNext(XoshiroState* st) {
+	t_int l = st->lane;
+	st->lane = (l + 1) % XOSHIRO_LANES;
+	return XoshiroStep(st, l);
+}
+
+static void XoshiroJump(XoshiroState* st, t_int l, const uint64_t* poly) {
+	uint64_t t[4] = { 0, 0, 0, 0 };
+	for(t_int i = 0; i < 4; ++i) for(t_int b = 0; b < 64; ++b) {
+		if(poly[i] & ((uint64_t)1 << b)) for(t_int w = 0; w < 4; ++w) t[w] ^= st->s[w][l];
+		XoshiroStep(st, l);
+	}
+	for(t_int w = 0; w < 4; ++w) st->s[w][l] = t[w];
+}
+
+// 2^128 and 2^192 steps ahead
+static const uint64_t xoshiroJump[4] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+static const uint64_t xoshiroLongJump[4] = { 0x76E15D3EFEFDCBBFULL, 0xC5004E441C522FB3ULL, 0x77710069854EE241ULL, 0x39109BB02ACBE635ULL };
+
+static void XoshiroSet(void* state, unsigned long seed) {
+	XoshiroState* st = (XoshiroState*)state;
+	uint64_t x = seed;
+	for(t_int w = 0; w < 4; ++w) st->s[w][0] = SplitMix(x);
+
+	// each stream starts 2^128 steps after the one before
+	for(t_int l = 1; l < XOSHIRO_LANES; ++l) {
+		for(t_int w = 0; w < 4; ++w) st->s[w][l] = st->s[w][l - 1];
+		XoshiroJump(st, l, xoshiroJump);
+	}
+	st->lane = 0;
+}
+
+// Streams are 2^192 steps apart, starting from the generator seeded with the seed, so that with lanes 2^128 apart
+// none of them overlap. Trials ask for their streams in order, so each thread keeps where the last few streams it
+// made start, and jumps on from the nearest one before.
+#define XOSHIRO_STREAM_STARTS 4
+
+struct XoshiroStreamStart {
+	t_int seed, stream;
+	XoshiroState state;
+};
+
+static void XoshiroSeedStream(XoshiroState* st, t_int seed, t_int stream) {
+	static thread_local XoshiroStreamStart starts[XOSHIRO_STREAM_STARTS];
+	static thread_local t_int nStarts = 0, oldest = 0;
+	XoshiroStreamStart* from = 0;
+	for(t_int i = 0; i < nStarts; ++i) {
+		if(starts[i].seed == seed && starts[i].stream <= stream && (!from || starts[i].stream > from->stream)) from = &starts[i];
+	}
+	t_int at = 0;
+	if(from) {
+		*st = from->state;
+		at = from->stream;
+	}
+	else XoshiroSet(st, (unsigned long)seed);
+	for(; at < stream; ++at) for(t_int l = 0; l < XOSHIRO_LANES; ++l) XoshiroJump(st, l, xoshiroLongJump);
+	st->lane = 0;
+
+	// remember it in place of the one it came from, or of the oldest
+	if(!from) {
+		if(nStarts < XOSHIRO_STREAM_STARTS) from = &starts[nStarts++];
+		else {
+			from = &starts[oldest];
+			oldest = (oldest + 1) % XOSHIRO_STREAM_STARTS;
+		}
+	}
+	from->seed = seed;
+	from->stream = stream;
+	from->state = *st;
+}
+
+static unsigned long XoshiroGet(void* state) {
+	return (unsigned long)(XoshiroNext((XoshiroState*)state) >> 32);
+}
+
+static double XoshiroGetDouble(void* state) {
+	return ToUniform(XoshiroNext((XoshiroState*)state));
+}
+
+#ifdef RANDOM_AVX2
+static inline RANDOM_AVX2_TARGET __m256i RotlAVX2(__m256i x, t_int k) {
+	return _mm256_or_si256(_mm256_slli_epi64(x, k), _mm256_srli_epi64(x, 64 - k));
+}
+
+// step all four streams at once, giving one number from each. Returns the number of uniforms done.
+static RANDOM_AVX2_TARGET t_int XoshiroFillAVX2(XoshiroState* st, double* out, t_int n) {
+	__m256i s0 = _mm256_loadu_si256((__m256i*)st->s[0]);
+	__m256i s1 = _mm256_loadu_si256((__m256i*)st->s[1]);
+	__m256i s2 = _mm256_loadu_si256((__m256i*)st->s[2]);
+	__m256i s3 = _mm256_loadu_si256((__m256i*)st->s[3]);
+	const __m256i exponent = _mm256_set1_epi64x(0x3FF0000000000000LL);
+	const __m256d one = _mm256_set1_pd(1.0);
+	t_int i = 0;
+	for(; i + XOSHIRO_LANES <= n; i += XOSHIRO_LANES) {
+		__m256i result = _mm256_add_epi64(RotlAVX2(_mm256_add_epi64(s0, s3), 23), s0);
+		__m256i t = _mm256_slli_epi64(s1, 17);
+		s2 = _mm256_xor_si256(s2, s0);
+		s3 = _mm256_xor_si256(s3, s1);
+		s1 = _mm256_xor_si256(s1, s2);
+		s0 = _mm256_xor_si256(s0, s3);
+		s2 = _mm256_xor_si256(s2, t);
+		s3 = RotlAVX2(s3, 45);
+		__m256i bits = _mm256_or_si256(_mm256_srli_epi64(result, 12), exponent);
+		_mm256_storeu_pd(out + i, _mm256_sub_pd(_mm256_castsi256_pd(bits), one));
+	}
+	_mm256_storeu_si256((__m256i*)st->s[0], s0);
+	_mm256_storeu_si256((__m256i*)st->s[1], s1);
+	_mm256_storeu_si256((__m256i*)st->s[2], s2);
+	_mm256_storeu_si256((__m256i*)st->s[3], s3);
+	return i;
+}
+#endif
+
+static void XoshiroFill(XoshiroState* st, double* out, t_int n) {
+	t_int i = 0;
+
+	// bring the streams into line, then do whole rounds with AVX2 if possible
+	while(i < n && st->lane != 0) out[i++] = ToUniform(XoshiroNext(st));
+#ifdef RANDOM_AVX2
+	static const bool haveAVX2 = RANDOM_HAVE_AVX2();
+	if(haveAVX2) i += XoshiroFillAVX2(st, out + i, n - i);
+#endif
+	for(; i < n; ++i) out[i] = ToUniform(XoshiroNext(st));
+}
+
+static const gsl_rng_type xoshiroType = { "xoshiro256++", 0xFFFFFFFFUL, 0, sizeof(XoshiroState), &XoshiroSet, &XoshiroGet, &XoshiroGetDouble };
+const gsl_rng_type* rng_xoshiro256pp = &xoshiroType;
+
+//-----------------------------------------------------------------------------------------------------------------------
+// PCG64 (XSL RR 128/64)
+//-----------------------------------------------------------------------------------------------------------------------
+
+struct U128 {
+	uint64_t hi, lo;
+};
+
+static inline U128 Add128(U128 a, U128 b) {
+	U128 r;
+	r.lo = a.lo + b.lo;
+	r.hi = a.hi + b.hi + (r.lo < a.lo);
+	return r;
+}
+
+static inline U128 Mul128(U128 a, U128 b) {
+	U128 r;
+#ifdef __SIZEOF_INT128__
+	unsigned __int128 p = (unsigned __int128)a.lo * b.lo;
+	r.lo = (uint64_t)p;
+	r.hi = (uint64_t)(p >> 64);
+#else
+	uint64_t a0 = a.lo & 0xFFFFFFFF, a1 = a.lo >> 32, b0 = b.lo & 0xFFFFFFFF, b1 = b.lo >> 32;
+	uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+	uint64_t mid = (p00 >> 32) + (p01 & 0xFFFFFFFF) + (p10 & 0xFFFFFFFF);
+	r.lo = (p00 & 0xFFFFFFFF) | (mid << 32);
+	r.hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+	r.hi += a.hi * b.lo + a.lo * b.hi;
+	return r;
+}
+
+struct PCGState {
+	U128 state, inc;
+};
+
+static const U128 pcgMultiplier = { 0x2360ED051FC65DA4ULL, 0x4385DF649FCCF645ULL };
+
+static inline uint64_t PCGNext(PCGState* st) {
+	st->state = Add128(Mul128(st->state, pcgMultiplier), st->inc);
+	uint64_t x = st->state.hi ^ st->state.lo;
+	t_int rot = (t_int)(st->state.hi >> 58);
+	return (x >> rot) | (x << ((64 - rot) & 63));
+}
+
+// move the generator given number of steps ahead, in log time
+static void PCGAdvance(PCGState* st, U128 delta) {
+	U128 accMult = { 0, 1 }, accPlus = { 0, 0 }, curMult = pcgMultiplier, curPlus = st->inc, one = { 0, 1 };
+	while(delta.hi || delta.lo) {
+		if(delta.lo & 1) {
+			accMult = Mul128(accMult, curMult);
+			accPlus = Add128(Mul128(accPlus, curMult), curPlus);
+		}
+		curPlus = Mul128(Add128(curMult, one), curPlus);
+		curMult = Mul128(curMult, curMult);
+		delta.lo = (delta.lo >> 1) | (delta.hi << 63);
+		delta.hi >>= 1;
+	}
+	st->state = Add128(Mul128(accMult, st->state), accPlus);
+}
+
+static void PCGSet(void* state, unsigned long seed) {
+	PCGState* st = (PCGState*)state;
+	uint64_t x = seed;
+	U128 initState, initSeq;
+	initState.hi = SplitMix(x);
+	initState.lo = SplitMix(x);
+	initSeq.hi = SplitMix(x);
+	initSeq.lo = SplitMix(x);
+
+	// as in the reference implementation
+	st->state.hi = st->state.lo = 0;
+	st->inc.hi = (initSeq.hi << 1) | (initSeq.lo >> 63);
+	st->inc.lo = (initSeq.lo << 1) | 1;
+	PCGNext(st);
+	st->state = Add128(st->state, initState);
+	PCGNext(st);
+}
+
+static unsigned long PCGGet(void* state) {
+	return (unsigned long)(PCGNext((PCGState*)state) >> 32);
+}
+
+static double PCGGetDouble(void* state) {
+	return ToUniform(PCGNext((PCGState*)state));
+}
+
+static const gsl_rng_type pcgType = { "pcg64", 0xFFFFFFFFUL, 0, sizeof(PCGState), &PCGSet, &PCGGet, &PCGGetDouble };
+const gsl_rng_type* rng_pcg64 = &pcgType;
+
+//-----------------------------------------------------------------------------------------------------------------------
+// Philox4x32-10
+//-----------------------------------------------------------------------------------------------------------------------
+
+struct PhiloxState {
+	uint32_t counter[4], key[2];
+	uint32_t out[4];
+	t_int pos;
+};
+
+static void PhiloxBlock(PhiloxState* st) {
+	uint32_t c0 = st->counter[0], c1 = st->counter[1], c2 = st->counter[2], c3 = st->counter[3];
+	uint32_t k0 = st->key[0], k1 = st->key[1];
+	for(t_int r = 0; r < 10; ++r) {
+		uint64_t p0 = (uint64_t)0xD2511F53 * c0, p1 = (uint64_t)0xCD9E8D57 * c2;
+		uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0, n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+		c0 = n0;
+		c1 = (uint32_t)p1;
+		c2 = n2;
+		c3 = (uint32_t)p0;
+		k0 += 0x9E3779B9;
+		k1 += 0xBB67AE85;
+	}
+	st->out[0] = c0;
+	st->out[1] = c1;
+	st->out[2] = c2;
+	st->out[3] = c3;
+	st->pos = 0;
+
+	// next block
+	if(++st->counter[0] == 0) if(++st->counter[1] == 0) if(++st->counter[2] == 0) ++st->counter[3];
+}
+
+static inline uint32_t PhiloxNext(PhiloxState* st) {
+	if(st->pos == 4) PhiloxBlock(st);
+	return st->out[st->pos++];
+}
+
+static void PhiloxSet(void* state, unsigned long seed) {
+	PhiloxState* st = (PhiloxState*)state;
+	uint64_t x = seed, k = SplitMix(x);
+	st->key[0] = (uint32_t)k;
+	st->key[1] = (uint32_t)(k >> 32);
+	st->counter[0] = st->counter[1] = st->counter[2] = st->counter[3] = 0;
+	st->pos = 4;
+}
+
+static unsigned long PhiloxGet(void* state) {
+	return PhiloxNext((PhiloxState*)state);
+}
+
+static double PhiloxGetDouble(void* state) {
+	PhiloxState* st = (PhiloxState*)state;
+	uint64_t hi = PhiloxNext(st);
+	return ToUniform((hi << 32) | PhiloxNext(st));
+}
+
+static const gsl_rng_type philoxType = { "philox4x32", 0xFFFFFFFFUL, 0, sizeof(PhiloxState), &PhiloxSet, &PhiloxGet, &PhiloxGetDouble };
+const gsl_rng_type* rng_philox4x32 = &philoxType;
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+static const char* randomGeneratorNames[N_RANDOM_GENERATORS] = { "taus", "mt19937", "xoshiro256++", "pcg64", "philox4x32" };
+
+const gsl_rng_type* RandomGeneratorType(t_int generator) {
+	switch(generator) {
+		case RANDOM_GENERATOR_MT19937: return gsl_rng_mt19937;
+		case RANDOM_GENERATOR_XOSHIRO: return rng_xoshiro256pp;
+		case RANDOM_GENERATOR_PCG: return rng_pcg64;
+		case RANDOM_GENERATOR_PHILOX: return rng_philox4x32;
+		default: return gsl_rng_taus;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+const char* RandomGeneratorName(t_int generator) {
+	if(generator < 0 || generator >= N_RANDOM_GENERATORS) generator = RANDOM_GENERATOR_TAUS;
+	return randomGeneratorNames[generator];
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int RandomGeneratorValue(const char* name) {
+	if(name) for(t_int i = 0; i < N_RANDOM_GENERATORS; ++i) if(strcmp(name, randomGeneratorNames[i]) == 0) return i;
+	return RANDOM_GENERATOR_TAUS;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+// Antithetic twins - the same generator, state & all, turned around, giving max + min - x for x and 1 - u for u.
+// A generator is switched to its twin and back by changing its type, so it carries on from where it is.
+
+static inline double Antithetic(double u) { return u > 0.0 ? 1.0 - u : 0.0; }
+
+template<t_int G> static unsigned long AntitheticGet(void* state) {
+	const gsl_rng_type* t = RandomGeneratorType(G);
+	return t->max + t->min - t->get(state);
+}
+
+template<t_int G> static double AntitheticGetDouble(void* state) {
+	return Antithetic(RandomGeneratorType(G)->get_double(state));
+}
+
+static const gsl_rng_type* AntitheticType(t_int generator) {
+	static unsigned long (*const get[N_RANDOM_GENERATORS])(void*) = {
+		&AntitheticGet<RANDOM_GENERATOR_TAUS>, &AntitheticGet<RANDOM_GENERATOR_MT19937>, &AntitheticGet<RANDOM_GENERATOR_XOSHIRO>,
+		&AntitheticGet<RANDOM_GENERATOR_PCG>, &AntitheticGet<RANDOM_GENERATOR_PHILOX> };
+	static double (*const getDouble[N_RANDOM_GENERATORS])(void*) = {
+		&AntitheticGetDouble<RANDOM_GENERATOR_TAUS>, &AntitheticGetDouble<RANDOM_GENERATOR_MT19937>, &AntitheticGetDouble<RANDOM_GENERATOR_XOSHIRO>,
+		&AntitheticGetDouble<RANDOM_GENERATOR_PCG>, &AntitheticGetDouble<RANDOM_GENERATOR_PHILOX> };
+	static gsl_rng_type types[N_RANDOM_GENERATORS];
+	static const bool made = []() {
+		for(t_int g = 0; g < N_RANDOM_GENERATORS; ++g) {
+			types[g] = *RandomGeneratorType(g);
+			types[g].get = get[g];
+			types[g].get_double = getDouble[g];
+		}
+		return true;
+	}();
+	(void)made;
+	return &types[generator];
+}
+
+// the generator a type is, or is the twin of
+static const gsl_rng_type* PlainType(const gsl_rng_type* t) {
+	for(t_int g = 0; g < N_RANDOM_GENERATORS; ++g) if(t == AntitheticType(g)) return RandomGeneratorType(g);
+	return t;
+}
+
+void SetAntithetic(gsl_rng* r, bool on) {
+	for(t_int g = 0; g < N_RANDOM_GENERATORS; ++g) {
+		if(r->type == RandomGeneratorType(g) || r->type == AntitheticType(g)) {
+			r->type = on ? AntitheticType(g) : RandomGeneratorType(g);
+			return;
+		}
+	}
+}
+
+bool IsAntithetic(const gsl_rng* r) {
+	return PlainType(r->type) != r->type;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void UseRandomGenerator(t_int generator) {
+	// an antithetic generator is already of its kind, and stays antithetic
+	const gsl_rng_type* t = RandomGeneratorType(generator);
+	if(rng && PlainType(rng->type) == t) return;
+	gsl_rng* r = gsl_rng_alloc(t);
+	if(rng) {
+		gsl_rng_set(r, gsl_rng_get(rng));
+		gsl_rng_free(rng);
+	}
+	else gsl_rng_set(r, clock());
+	rng = r;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+// seeds are kept positive, so that they can be written as they are in XML files
+static inline uint64_t MixSeed(t_int seed, t_int stream) {
+	uint64_t x = ((uint64_t)(uint32_t)seed << 32) | (uint32_t)stream;
+	SplitMix(x);
+	return SplitMix(x);
+}
+
+t_int NewRandomSeed(void) {
+	uint64_t x = ((uint64_t)time(0) << 32) ^ (uint64_t)clock();
+	t_int seed = (t_int)(SplitMix(x) & 0x7FFFFFFF);
+	return seed ? seed : 1;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int DeriveRandomSeed(t_int seed, t_int stream) {
+	t_int s = (t_int)(MixSeed(seed, stream) & 0x7FFFFFFF);
+	return s ? s : 1;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void SeedRandomStream(gsl_rng* r, t_int seed, t_int stream) {
+	const gsl_rng_type* t = PlainType(r->type);
+	if(t == rng_philox4x32) {
+		// the key comes from the seed, and the top of the counter is the stream
+		PhiloxSet(r->state, (uint32_t)seed);
+		PhiloxState* st = (PhiloxState*)r->state;
+		st->counter[2] = (uint32_t)stream;
+	}
+	else if(t == rng_xoshiro256pp && stream >= 0) XoshiroSeedStream((XoshiroState*)r->state, seed, stream);
+	else if(t == rng_pcg64 && stream >= 0) {
+		// streams are 2^96 steps apart
+		U128 delta = { (uint64_t)stream << 32, 0 };
+		PCGSet(r->state, (unsigned long)seed);
+		PCGAdvance((PCGState*)r->state, delta);
+	}
+	else gsl_rng_set(r, (unsigned long)MixSeed(seed, stream));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void RandomUniforms(gsl_rng* r, double* out, t_int n) {
+	// twins of the fast generators are filled the same way and turned around, so the numbers are the same as their
+	// generator's whether drawn one at a time or in bulk
+	const gsl_rng_type* t = PlainType(r->type);
+	if(t == rng_xoshiro256pp) XoshiroFill((XoshiroState*)r->state, out, n);
+	else if(t == rng_pcg64) for(t_int i = 0; i < n; ++i) out[i] = ToUniform(PCGNext((PCGState*)r->state));
+	else if(t == rng_philox4x32) for(t_int i = 0; i < n; ++i) out[i] = PhiloxGetDouble(r->state);
+	else {
+		for(t_int i = 0; i < n; ++i) out[i] = gsl_rng_uniform(r);
+		return;
+	}
+	if(t != r->type) for(t_int i = 0; i < n; ++i) out[i] = Antithetic(out[i]);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void RandomBuffer::use(gsl_rng* r) {
+	rand = r;
+	type = r->type;
+	const gsl_rng_type* t = PlainType(r->type);
+	bulk = t == rng_xoshiro256pp || t == rng_pcg64 || t == rng_philox4x32;
+	pos = RANDOM_BUFFER_SIZE;
+}
@@ -5,6 +5,7 @@
 #include <gsl/gsl_cdf.h>
 #include <time.h>
 #include "Utility.h"
+#include "SimulationThread.h"
 
 #define EVALUE_BLF_P 2
 #define EVALUE_BLF_P_OR_NOT_P 1
@@ -27,6 +28,11 @@ Simulation::Simulation(void) : eValuesOverTime() {
 	val.eValues[2] = 1.0;
     val.exponent = 1.0;
 	val.amtStrictlyGreater = val.blfPStrictlyGreater = val.blfNotPStrictlyLess =true;
+	beliefEngine = BELIEF_ENGINE_AMOUNT;
+	eventSampling = EVENT_SAMPLING_EVERY_STEP;
+	timing = TIMING_SYNCHRONOUS;
+	stepEngine = STEP_ENGINE_SERIAL;
+	randomGenerator = RANDOM_GENERATOR_XOSHIRO;
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
@@ -38,6 +44,11 @@ Simulation::Simulation(const Simulation& s1, const Simulation& s2, t_float v) {
 		val.amtStrictlyGreater = s2.val.amtStrictlyGreater;
 		val.blfPStrictlyGreater = s2.val.blfPStrictlyGreater;
 		val.blfNotPStrictlyLess = s2.val.blfNotPStrictlyLess;
+		beliefEngine = s2.beliefEngine;
+		eventSampling = s2.eventSampling;
+		timing = s2.timing;
+		stepEngine = s2.stepEngine;
+		randomGenerator = s2.randomGenerator;
 	}
 	for(t_int i = 0; i < 3; ++i) val.eValues[i] = s1.val.eValues[i] * (1.0 - v) + s2.val.eValues[i] * v;
 	val.majorityAmt = s1.val.majorityAmt * (1.0 - v) + s2.val.majorityAmt * v;
@@ -70,7 +81,17 @@ Simulation::Simulation(TiXmlElement* xml) {
 	xml->QueryFloatAttribute("P_CERTAINTY_REQUIRED", &val.majorityPCert);
 	xml->QueryFloatAttribute("NOT_P_CERTAINTY_REQUIRED", &val.majorityNotPCert);
     if(xml->QueryFloatAttribute("EXPONENT", &val.exponent) != TIXML_SUCCESS) val.exponent = 1.0;
-
+	if(xml->Attribute("BELIEF_ENGINE") && strcmp(xml->Attribute("BELIEF_ENGINE"), "log-odds") == 0) beliefEngine = BELIEF_ENGINE_LOG_ODDS;
+	else beliefEngine = BELIEF_ENGINE_AMOUNT;
+	if(xml->Attribute("EVENT_SAMPLING") && strcmp(xml->Attribute("EVENT_SAMPLING"), "skip") == 0) eventSampling = EVENT_SAMPLING_SKIP;
+	else eventSampling = EVENT_SAMPLING_EVERY_STEP;
+	if(xml->Attribute("TIMING") && strcmp(xml->Attribute("TIMING"), "continuous") == 0) timing = TIMING_CONTINUOUS;
+	else timing = TIMING_SYNCHRONOUS;
+	if(xml->Attribute("STEP_ENGINE") && strcmp(xml->Attribute("STEP_ENGINE"), "blocks") == 0) stepEngine = STEP_ENGINE_BLOCKS;
+	else stepEngine = STEP_ENGINE_SERIAL;
+
+	// files from before the choice was there were made with GSL's taus generator
+	randomGenerator = RandomGeneratorValue(xml->Attribute("RANDOM_GENERATOR"));
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
@@ -92,6 +113,15 @@ TiXmlElement* Simulation::toXML(void) const {
 	s->SetDoubleAttribute("P_CERTAINTY_REQUIRED", val.majorityPCert);
 	s->SetDoubleAttribute("NOT_P_CERTAINTY_REQUIRED", val.majorityNotPCert);
 	s->SetDoubleAttribute("EXPONENT", val.exponent);
+	if(beliefEngine == BELIEF_ENGINE_LOG_ODDS) s->SetAttribute("BELIEF_ENGINE", "log-odds");
+	else s->SetAttribute("BELIEF_ENGINE", "amount");
+	if(eventSampling == EVENT_SAMPLING_SKIP) s->SetAttribute("EVENT_SAMPLING", "skip");
+	else s->SetAttribute("EVENT_SAMPLING", "every-step");
+	if(timing == TIMING_CONTINUOUS) s->SetAttribute("TIMING", "continuous");
+	else s->SetAttribute("TIMING", "synchronous");
+	if(stepEngine == STEP_ENGINE_BLOCKS) s->SetAttribute("STEP_ENGINE", "blocks");
+	else s->SetAttribute("STEP_ENGINE", "serial");
+	s->SetAttribute("RANDOM_GENERATOR", RandomGeneratorName(randomGenerator));
 	return s;
 }
 
@@ -111,6 +141,11 @@ string Simulation::getDescription(void) {
 	str += string("p V -p = ") + string(DoubleToString(val.eValues[EVALUE_BLF_P_OR_NOT_P])) + ", ";
 	str += string("-p = ") + string(DoubleToString(val.eValues[EVALUE_BLF_NOT_P])) + ", ";
     str += string("Exponent = ") + string(DoubleToString(val.exponent)) + "]\r\n";
+	if(beliefEngine == BELIEF_ENGINE_LOG_ODDS) str += string("Beliefs updated in log-odds form\r\n");
+	if(timing == TIMING_CONTINUOUS) str += string("Continuous time, events taking effect at once\r\n");
+	else if(eventSampling == EVENT_SAMPLING_SKIP) str += string("Rare events skip-sampled\r\n");
+	else if(stepEngine == STEP_ENGINE_BLOCKS) str += string("Steps taken in blocks, news arriving a step later\r\n");
+	str += string("Random number generator: ") + string(RandomGeneratorName(randomGenerator)) + string("\r\n");
 
 	return str;
 }
@@ -135,16 +170,16 @@ void Simulation::reset(void) {
 
 	// set variables
 	curStep = 0;
+	soc->newGeneration();	// messages have been reset outside the undo journal
 	eValue = startEValue = instantEValue();
 	polarisation = startPolarisation = instantPolarisation(eValue);
+	aggregate.recalculate(this);
+	schedule.invalidate();
 	eValueDelta = eValueTotal = eValueDeltaTotal = 0;
 	logMsgSize = 0;
 
-	msgSent = inqResults = 0;
-
-	// reset bandwagon variables
-	bwTowardsP = bwTowardsNotP = 0;
-	inqOverriddenTowardsP = inqOverriddenTowardsNotP = 0;
+	// reset message & bandwagon counters
+	clearCounters();
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
@@ -167,52 +202,148 @@ void Simulation::step(t_int nStepsToTake, t_int timePerEValue) {
 	// take the steps
 	char str[256];
 
+	// the society may have been edited since last time
+	schedule.invalidate();
 
-	for(t_int j = 0; j < nStepsToTake; ++j) {
+	if(logLevel == LOG_NONE) advance(nStepsToTake, timePerEValue);
+	else for(t_int j = 0; j < nStepsToTake; ++j) {
 		if(logLevel >= LOG_STANDARD) {
             addToLog("------------------------------------------------------------------------------------------------------------------------------------------------------------------------\n");
 			sprintf(str, "Time: %d\n", curStep + 1);
 			addToLog(str);
 		}
 
-		// update
-		soc->evolve(this);
-
-		// if this is the "official" simulation, use it to fill out the simulation window
-		if(this == app->getCurSimulation()) setSimulationWindowFrom();
-
 		// write out data in log
-		if(logLevel > LOG_NONE) {
-			if(logLevel == LOG_SUMMARY) {
-				sprintf(str, "(%d) ", curStep + 1);
-				addToLog(str);
-			}
-			sprintf(str, "e-value = %.3f, e-value delta = %.3f.\n",
-				eValue, eValueDelta);
+		advance(1, timePerEValue);
+		if(logLevel == LOG_SUMMARY) {
+			sprintf(str, "(%d) ", curStep);
 			addToLog(str);
-
-			// do the actual writing out
-			writeLog();
 		}
+		sprintf(str, "e-value = %.3f, e-value delta = %.3f.\n",
+			eValue, eValueDelta);
+		addToLog(str);
 
-		// step time
-		++curStep;
+		// do the actual writing out
+		writeLog();
+	}
+
+	// beliefs & trust have changed outside the undo journal
+	soc->newGeneration();
 
-		// update statistics
-		if(eValuesOverTime.valid()) for(t_int i = 0; i < soc->people.size(); ++i) eValuesOverTime.v(i, curStep / timePerEValue, 0) = individualEValue(soc->people[i].belief.v());
+	// if this is the "official" simulation, use it to fill out the simulation window
+	if (this == app->getCurSimulation()) {
+		setSimulationWindowFrom();
+		societyWindow->view->redraw();
 	}
 
 	// do we need to update selected inquirers or links?
-	if (this == app->getCurSimulation()) societyWindow->view->redraw();
 	if(societyWindow->view->getSelectedInquirers().size()) inquirerWindow->configure();
 	if(societyWindow->view->getSelectedLinks().size()) linkWindow->configure();
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
 
+void Simulation::advance(t_int nStepsToTake, t_int timePerEValue) {
+	// take the steps without touching the user interface
+	for(t_int j = 0; j < nStepsToTake; ++j) {
+		soc->evolve(this);
+		finishStep(timePerEValue);
+		if(checkAbsorbed()) {
+			fillAbsorbed(rng, timePerEValue);
+			return;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::updateStepStatistics(void) {
+	// totals from the running sums
+	if(val.applicationMethod == APPLY_TO_AVERAGE) eValue = individualEValue(aggregate.includedBeliefSum / (t_float)aggregate.nIncluded);
+	else eValue = aggregate.eValue(val);
+	eValueDelta = eValue - startEValue;
+	polarisation = aggregate.polarisation(eValue);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::finishStep(t_int timePerEValue) {
+	++curStep;
+
+	// update statistics
+	if(eValuesOverTime.valid()) for(t_int i = 0; i < soc->people.size(); ++i) eValuesOverTime.v(i, curStep / timePerEValue, 0) = aggregate.eValues[i];
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::stopWhenAbsorbed(t_int until) {
+	absorbedUntil = until;
+	nextAbsorptionCheck = curStep;
+	absorptionCheckGap = 1;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool Simulation::checkAbsorbed(void) {
+	// only worth looking when nothing changed at the last step, and less often the more often it is in vain
+	if(curStep >= absorbedUntil || nChanged > 0 || curStep < nextAbsorptionCheck) return false;
+	if(absorbed()) return true;
+	absorptionCheckGap *= 2;
+	nextAbsorptionCheck = curStep + absorptionCheckGap;
+	return false;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool Simulation::absorbed(void) {
+	// in continuous time, counts of events are not simply binomial
+	if(timing != TIMING_SYNCHRONOUS) return false;
+
+	// every belief must be certain, or out of reach of both inquiry and other inquirers
+	for(t_int i = 0; i < soc->people.size(); ++i) {
+		const Inquirer& p = soc->people[i];
+		if(p.belief.certain()) continue;
+		if(p.inquiryChance > 0) return false;
+		for(LinkIterator l = soc->links.lower_bound(LBOUND(i)); l != soc->links.upper_bound(UBOUND(i)); ++l) if(l->second.listenChance > 0) return false;
+	}
+
+	// links that wait for new evidence say something depending on what happened before, so messages through them
+	// can't be counted without simulating them
+	for(LinkIterator l = soc->links.begin(); l != soc->links.end(); ++l) {
+		if(l->second.listenChance > 0 && l->second.evidencePolicy != NEW_EVIDENCE_NONE) return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Simulation::fillAbsorbed(gsl_rng* r, t_int timePerEValue) {
+	// inquiry results & messages still come at every step, but change nothing, so only their numbers are needed
+	t_int n = absorbedUntil - curStep;
+	for(t_int i = 0; i < soc->people.size(); ++i) {
+		t_float c = soc->people[i].inquiryChance;
+		if(c > 0) inqResults += gsl_ran_binomial(r, c < 1.0 ? c : 1.0, n);
+	}
+	for(LinkIterator l = soc->links.begin(); l != soc->links.end(); ++l) {
+		t_float c = l->second.listenChance;
+		if(c > 0) msgSent += gsl_ran_binomial(r, c < 1.0 ? c : 1.0, n);
+	}
+
+	// e-values stay as they are, and no bandwagon effect is possible with certain beliefs
+	if(eValuesOverTime.valid()) while(curStep < absorbedUntil) finishStep(timePerEValue);
+	else curStep = absorbedUntil;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
 t_float Simulation::individualEValue(t_float blf) {
-	if(blf >= 0.5) return powf((val.eValues[EVALUE_BLF_P] - val.eValues[EVALUE_BLF_P_OR_NOT_P]) * (blf - 0.5) * 2.0 + val.eValues[EVALUE_BLF_P_OR_NOT_P], val.exponent);
-	else return powf((val.eValues[EVALUE_BLF_P_OR_NOT_P] - val.eValues[EVALUE_BLF_NOT_P]) * blf * 2.0 + val.eValues[EVALUE_BLF_NOT_P], val.exponent);
+	t_float v;
+	if(blf >= 0.5) v = (val.eValues[EVALUE_BLF_P] - val.eValues[EVALUE_BLF_P_OR_NOT_P]) * (blf - 0.5) * 2.0 + val.eValues[EVALUE_BLF_P_OR_NOT_P];
+	else v = (val.eValues[EVALUE_BLF_P_OR_NOT_P] - val.eValues[EVALUE_BLF_NOT_P]) * blf * 2.0 + val.eValues[EVALUE_BLF_NOT_P];
+
+	// powf with an exponent of one only rounds to float
+	if(val.exponent == 1.0) return (float)v;
+	return powf(v, val.exponent);
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
@@ -284,6 +415,98 @@ t_float Simulation::instantPolarisation(t_float ev) {
 
 //-----------------------------------------------------------------------------------------------------------------------
 
+inline t_int EValueAggregate::vote(const ValuationMethod& val, t_float blf) const {
+	// 1 for p, -1 for not-p, 0 for neither
+	if(blf > 0.5) {
+		if(val.blfPStrictlyGreater && blf > val.majorityPCert) return 1;
+		else if(blf >= val.majorityPCert) return 1;
+	}
+	else {
+		if(val.blfNotPStrictlyLess && blf < val.majorityNotPCert) return -1;
+		else if(blf <= val.majorityNotPCert) return -1;
+	}
+	return 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void EValueAggregate::recalculate(Simulation* sim) {
+	vector<Inquirer>& people = sim->soc->people;
+	eValues.resize(people.size());
+	eValueMean = eValueM2 = includedEValueSum = includedBeliefSum = 0;
+	nIncluded = nVotingP = nVotingNotP = 0;
+	for(t_int i = 0; i < people.size(); ++i) {
+		t_float blf = people[i].belief.v(), e = sim->individualEValue(blf);
+		eValues[i] = e;
+		t_float delta = e - eValueMean;
+		eValueMean += delta / (i + 1);
+		eValueM2 += delta * (e - eValueMean);
+		if(people[i].includeInStatistics) {
+			++nIncluded;
+			includedEValueSum += e;
+			includedBeliefSum += blf;
+			t_int v = vote(sim->val, blf);
+			if(v > 0) ++nVotingP;
+			else if(v < 0) ++nVotingNotP;
+		}
+	}
+	stepsSinceRecalculation = 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void EValueAggregate::update(Simulation* sim, t_int i, t_float oldBelief, t_float newBelief, bool included) {
+	// replace the old e-value by the new one in the mean & squared deviations
+	t_float e = sim->individualEValue(newBelief), d = e - eValues[i];
+	t_float oldMean = eValueMean;
+	eValueMean += d / eValues.size();
+	eValueM2 += d * (e - eValueMean + eValues[i] - oldMean);
+	if(eValueM2 < 0) eValueM2 = 0;
+	if(included) {
+		includedEValueSum += d;
+		includedBeliefSum += newBelief - oldBelief;
+		t_int vOld = vote(sim->val, oldBelief), vNew = vote(sim->val, newBelief);
+		if(vOld != vNew) {
+			if(vOld > 0) --nVotingP;
+			else if(vOld < 0) --nVotingNotP;
+			if(vNew > 0) ++nVotingP;
+			else if(vNew < 0) ++nVotingNotP;
+		}
+	}
+	eValues[i] = e;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_float EValueAggregate::eValue(const ValuationMethod& val) const {
+	if(val.applicationMethod == APPLY_INDIVIDUALLY) return includedEValueSum / (t_float)nIncluded;
+	else if(val.applicationMethod == APPLY_TO_MAJORITY) {
+		if(val.amtStrictlyGreater) {
+			if((t_float)nVotingP > (t_float)nIncluded * val.majorityAmt) return val.eValues[2];
+			else if((t_float)nVotingNotP > (t_float)nIncluded * val.majorityAmt) return val.eValues[0];
+			else return val.eValues[1];
+		}
+		else {
+			if((t_float)nVotingP >= (t_float)nIncluded * val.majorityAmt) return val.eValues[2];
+			else if((t_float)nVotingNotP >= (t_float)nIncluded * val.majorityAmt) return val.eValues[0];
+			else return val.eValues[1];
+		}
+	}
+	return QNAN;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_float EValueAggregate::polarisation(t_float ev) const {
+	// root mean square deviation from ev - the squared deviations from the mean, and the mean's from ev
+	t_int n = eValues.size();
+	if(n == 0) return 0;
+	t_float m = eValueMean - ev;
+	return sqrt(eValueM2 / n + m * m);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
 void Simulation::addToLog(const char* msg) {
 	if (logMsg == nullptr) logMsg = new char[LOG_BUFFER_SIZE];
 	t_int sz = strlen(msg);
@@ -308,8 +531,8 @@ void Simulation::setSimulationWindowFrom(void) {
 	simulationWindow->outputTime->value(IntToString(curStep));
 	simulationWindow->outputEValue->value(DoubleToString(eValue));
 	simulationWindow->outputEValueDelta->value(DoubleToString(eValueDelta));
-	simulationWindow->outputPolarisation->value(DoubleToString(instantPolarisation(eValue)));
-	simulationWindow->outputPolarisationDelta->value(DoubleToString(instantPolarisation(eValue) - startPolarisation));
+	simulationWindow->outputPolarisation->value(DoubleToString(polarisation));
+	simulationWindow->outputPolarisationDelta->value(DoubleToString(polarisation - startPolarisation));
 
 	// set choice menus & check box
 	simulationWindow->choiceLogLevel->value(logLevel);
@@ -341,6 +564,11 @@ string Simulation::compareTo(const Simulation& sim) {
 	if(sim.val.majorityAmt != val.majorityAmt) s += string("majority amt: ") + string(DoubleToString(val.majorityAmt)) + string(" \r");
 	if(sim.val.majorityPCert != val.majorityPCert) s += string("majority p cert: ") + string(DoubleToString(val.majorityPCert)) + string(" \r");
 	if(sim.val.majorityNotPCert != val.majorityNotPCert) s += string("majority not-p cert: ") + string(DoubleToString(val.majorityNotPCert)) + string(" \r");
+	if(sim.beliefEngine != beliefEngine) s += string("belief engine: ") + string(IntToString(beliefEngine)) + string(" \r");
+	if(sim.eventSampling != eventSampling) s += string("event sampling: ") + string(IntToString(eventSampling)) + string(" \r");
+	if(sim.timing != timing) s += string("timing: ") + string(IntToString(timing)) + string(" \r");
+	if(sim.stepEngine != stepEngine) s += string("step engine: ") + string(IntToString(stepEngine)) + string(" \r");
+	if(sim.randomGenerator != randomGenerator) s += string("random numbers: ") + string(RandomGeneratorName(randomGenerator)) + string(" \r");
 
 	return s;
 }
@@ -355,3 +583,74 @@ void RunSimulation(void* data) {
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
+
+void ShowSimulationSnapshot(void* data) {
+	Simulation* s = (Simulation*)data;
+	const SimulationSnapshot* snap = simulationThread.newSnapshot();
+	if(snap) {
+		simulationWindow->outputTime->value(IntToString(snap->curStep));
+		simulationWindow->outputEValue->value(DoubleToString(snap->eValue));
+		simulationWindow->outputEValueDelta->value(DoubleToString(snap->eValueDelta));
+		simulationWindow->outputPolarisation->value(DoubleToString(snap->polarisation));
+		simulationWindow->outputPolarisationDelta->value(DoubleToString(snap->polarisation - s->startPolarisation));
+		societyWindow->view->setSnapshot(snap);
+		societyWindow->view->redraw();
+	}
+	Fl::repeat_timeout(SIMULATION_DISPLAY_INTERVAL, ShowSimulationSnapshot, data);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void StartSimulation(Simulation* s) {
+	if(SimulationRunning(s)) return;
+
+	// dice are shared, so only change generator when nothing else is rolling them
+	if(!simulationThread.isRunning()) UseRandomGenerator(s->randomGenerator);
+	if(s->logLevel == LOG_NONE) {
+		// run in the background and show snapshots as they come
+		simulationThread.start(s);
+		Fl::add_timeout(SIMULATION_DISPLAY_INTERVAL, ShowSimulationSnapshot, s);
+	}
+	else {
+		// log is written step by step
+		Fl::add_idle(RunSimulation, s);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void PauseSimulation(Simulation* s) {
+	if(Fl::has_idle(RunSimulation, s)) Fl::remove_idle(RunSimulation, s);
+	if(simulationThread.isRunning(s)) {
+		simulationThread.stop();
+		Fl::remove_timeout(ShowSimulationSnapshot, s);
+
+		// society is ours again, so show it as it is
+		societyWindow->view->setSnapshot(0);
+		if(s == app->getCurSimulation()) {
+			s->setSimulationWindowFrom();
+			societyWindow->view->redraw();
+		}
+		if(societyWindow->view->getSelectedInquirers().size()) inquirerWindow->configure();
+		if(societyWindow->view->getSelectedLinks().size()) linkWindow->configure();
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool SimulationRunning(Simulation* s) {
+	return Fl::has_idle(RunSimulation, s) || simulationThread.isRunning(s);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void SetSimulationLogLevel(Simulation* s, t_int level) {
+	// a simulation writing a log runs in a different way, so restart it
+	bool running = SimulationRunning(s);
+	if(running) PauseSimulation(s);
+	s->logLevel = level;
+	s->setSimulationWindowFrom();
+	if(running) StartSimulation(s);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,68 @@
+#include "SimulationThread.h"
+#include "Simulation.h"
+#include <chrono>
+
+SimulationThread simulationThread;
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void SimulationThread::start(Simulation* s) {
+	stop();
+	sim = s;
+	dice = rng;
+	sim->schedule.invalidate();
+	stopRequested = false;
+
+	// make sure there is something to show straight away
+	publish();
+	worker = thread(&SimulationThread::run, this);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void SimulationThread::stop(void) {
+	if (!worker.joinable()) return;
+	stopRequested = true;
+	worker.join();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void SimulationThread::run(void) {
+	rng = dice;
+	chrono::steady_clock::time_point lastPublished = chrono::steady_clock::now();
+	while (!stopRequested) {
+		sim->advance();
+
+		// time to show the current state?
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		if (chrono::duration<double>(now - lastPublished).count() >= SIMULATION_DISPLAY_INTERVAL) {
+			publish();
+			lastPublished = now;
+		}
+	}
+
+	// beliefs & trust have changed outside the undo journal
+	sim->soc->newGeneration();
+	publish();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void SimulationThread::publish(void) {
+	SimulationSnapshot& s = snapshots.writeSlot();
+	Society* soc = sim->soc;
+
+	s.curStep = sim->curStep;
+	s.eValue = sim->eValue;
+	s.eValueDelta = sim->eValueDelta;
+	s.polarisation = sim->polarisation;
+
+	s.beliefs.resize(soc->people.size());
+	for (t_int i = 0; i < soc->people.size(); ++i) s.beliefs[i] = soc->people[i].belief.v();
+	s.trust.resize(soc->links.size());
+	t_int i = 0;
+	for (LinkIterator l = soc->links.begin(); l != soc->links.end(); ++l) s.trust[i++] = l->second.trust.expectation();
+
+	snapshots.publish();
+}
@@ -4,9 +4,12 @@
 #define _USE_MATH_DEFINES
 #endif
 #include <time.h>
+#include <atomic>
 #include <gsl/gsl_randist.h>
 #include "tinyxml.h"
 #include "Utility.h"
+#include "ParallelEvolve.h"
+#include "Profiler.h"
 
 #define INQUIRER_CLOSENESS_PENALTY 20.0
 #define ORGANISE_SOCIETY_TIME 2.0
@@ -14,7 +17,7 @@
 
 
 // global variables
-Society *curSociety;
+thread_local Society *curSociety;
 
 t_float addWeight(t_float& w, t_float v, t_float totalWeight);
 t_float removeWeight(t_float& w, t_float v, t_float totalWeight);
@@ -240,6 +243,7 @@ void Society::generateFromSetup(SocietySetup *setup) {
 void Society::generateLinksFromSetup(SocietySetup *setup) {
 	// remove all existing links
 	links.clear();
+	newGeneration();
 	for(t_int i = 0; i < people.size(); ++i) {
 		people[i].listeners.clear();
 		people[i].nListeners = people[i].nSources = 0;
@@ -259,6 +263,7 @@ void Society::generateLinksFromSetup(SocietySetup *setup) {
 
 //-----------------------------------------------------------------------------------------------------------------------
 Society::Society(SocietySetup *setup, Society *tmpl) {
+	newGeneration();
 	if(setup) {
 		// society is made from a setup structure
 		if(setup->varyPopulation) generateFromSetup(setup);
@@ -329,6 +334,7 @@ Society::Society(SocietySetup *setup, Society *tmpl) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 Society::Society(const Society& s) {
+	newGeneration();
     people.clear();
 	links.clear();
 	people = s.people;
@@ -342,11 +348,19 @@ Society& Society::operator=(const Society& s) {
 	links.clear();
 	people = s.people;
     for(ConstLinkIterator l = s.links.begin(); l != s.links.end(); ++l) links.insert(*l);
+	newGeneration();
 	return *this;
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
 
+void Society::newGeneration(void) {
+	static atomic<unsigned long long> generations(0);
+	generation = ++generations;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
 Society::~Society() {
 	people.clear();
 	links.clear();
@@ -373,11 +387,13 @@ void Society::recalculateListeners(void) {
 void Society::addInquirer(t_float x, t_float y, SocietySetup *setup) {
 	// add inquirer
 	people.push_back(Inquirer(x, y, setup));
+	newGeneration();
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
 
 bool Society::addLink(const t_int source, const t_int target, SocietySetup *setup) {
+	newGeneration();
 	// is there a link here already?
 	LinkIterator l = links.find(COUPLE(source, target));
 	if(l != links.end()) {
@@ -405,6 +421,7 @@ bool Society::addLink(const t_int source, const t_int target, SocietySetup *setu
 void Society::removeLink(t_int src, t_int target) {
 	LinkIterator l(links.find(COUPLE(src, target)));
 	links.erase(l);
+	newGeneration();
 
 	// remove from to source's listener list
 	people[src].listeners.erase(std::find(people[src].listeners.begin(), people[src].listeners.end(), target));
@@ -423,69 +440,117 @@ Link* Society::getLink(t_int source, t_int target) {
 //-----------------------------------------------------------------------------------------------------------------------
 
 void Society::evolve(Simulation *sim) {
-	// Init statistics variables
-	t_float v = 0;
-	t_int p = 0, notp = 0, total = 0;
-
-	// Calculate every inquirer's new degree of belief
-	for(t_int i = 0; i < people.size(); ++i) people[i].doInquiry(sim, this, i);
-
-
-	// record messages for links
-	for(LinkIterator l = links.begin(); l != links.end(); ++l) {
-		if(l->second.evidencePolicy == NEW_EVIDENCE_INQUIRY) {
-			if(people[l->second.source].message == MSG_SAY_P && people[l->second.source].newBelief >= l->second.threshold) l->second.message = MSG_SAY_P;
-			else if(people[l->second.source].message == MSG_SAY_NOT_P && people[l->second.source].newBelief <= 1.0 - l->second.threshold) l->second.message = MSG_SAY_NOT_P;
+	// running statistics must be for this society
+	EValueAggregate& agg = sim->aggregate;
+	if(agg.eValues.size() != people.size() || agg.stepsSinceRecalculation >= EVALUE_RECALCULATION_INTERVAL) agg.recalculate(sim);
+	++agg.stepsSinceRecalculation;
+	sim->nChanged = 0;
+
+	if(sim->timing == TIMING_CONTINUOUS) {
+		// handle events one at a time in order of time, each taking effect at once
+		EventSchedule& sch = sim->schedule;
+		if(!sch.valid(this, true)) {
+			sch.reset(this, sim->curStep, true);
+			for(t_int i = 0; i < people.size(); ++i) people[i].newBelief = people[i].belief;
+			for(LinkIterator l = links.begin(); l != links.end(); ++l) recordLinkMessage(l->second);
 		}
-		else if(l->second.evidencePolicy == NEW_EVIDENCE_ANY) {
-			if(people[l->second.source].newBelief > people[l->second.source].belief && people[l->second.source].newBelief >= l->second.threshold) l->second.message = MSG_SAY_P;
-			else if(people[l->second.source].newBelief < people[l->second.source].belief && people[l->second.source].newBelief <= 1.0 - l->second.threshold) l->second.message = MSG_SAY_NOT_P;
+		// events are inquiries, messages & updates at once, so they are all timed as inquiries
+		PROFILE_SCOPE(PROFILE_INQUIRIES);
+		t_int i;
+		const LinkIterator* heard;
+		while(sch.next(sim->curStep, i, heard)) {
+			people[i].doScheduledInquiry(sim, this, i, heard == 0, heard, heard ? 1 : 0);
+			const LinkIterator* out = sch.outgoing(i);
+			for(t_int k = 0; k < sch.nOutgoing(i); ++k) recordLinkMessage(out[k]->second);
+			if(people[i].newBelief.v() != people[i].belief.v()) {
+				agg.update(sim, i, people[i].belief.v(), people[i].newBelief.v(), people[i].includeInStatistics);
+				++sim->nChanged;
+			}
+			people[i].belief = people[i].newBelief;
 		}
 	}
+	else if(sim->eventSampling == EVENT_SAMPLING_SKIP) {
+		// only visit the inquirers and links that something happens to at this step
+		EventSchedule& sch = sim->schedule;
+		if(!sch.valid(this, false)) {
+			sch.reset(this, sim->curStep, false);
+			for(t_int i = 0; i < people.size(); ++i) people[i].newBelief = people[i].belief;
+			for(LinkIterator l = links.begin(); l != links.end(); ++l) recordLinkMessage(l->second);
+		}
+		sch.collect(sim->curStep);
+
+		// Calculate new degree of belief for inquirers that receive anything
+		{
+			PROFILE_SCOPE(PROFILE_INQUIRIES);
+			for(t_int j = 0; j < sch.inquirers.size(); ++j) {
+				t_int i = sch.inquirers[j];
+				people[i].doScheduledInquiry(sim, this, i, sch.inquires[j], sch.heard.data() + sch.heardStart[j], sch.heardStart[j + 1] - sch.heardStart[j]);
+			}
+		}
 
+		// record messages for links from those inquirers - the others have nothing new to say
+		{
+			PROFILE_SCOPE(PROFILE_MESSAGE_RECORDING);
+			for(t_int j = 0; j < sch.inquirers.size(); ++j) {
+				const LinkIterator* out = sch.outgoing(sch.inquirers[j]);
+				for(t_int k = 0; k < sch.nOutgoing(sch.inquirers[j]); ++k) recordLinkMessage(out[k]->second);
+			}
+		}
 
-	// Update inquirers to new values
-	for(t_int i = 0; i < people.size(); ++i) {
-		// update belief value
-		people[i].belief = people[i].newBelief;
-
-		// record statistics for this person
-		if(people[i].includeInStatistics) {
-			++total;
-			if(sim->val.applicationMethod == APPLY_INDIVIDUALLY) v += sim->individualEValue(people[i].newBelief.v());
-			else if(sim->val.applicationMethod == APPLY_TO_AVERAGE) v += people[i].newBelief.v();
-			else {
-				if(people[i].newBelief.v() > 0.5) {
-					if(sim->val.blfPStrictlyGreater && people[i].newBelief.v() > sim->val.majorityPCert)  ++p;
-					else if(people[i].newBelief.v() >= sim->val.majorityPCert) ++p;
-				}
-				else {
-					if(sim->val.blfNotPStrictlyLess && people[i].newBelief.v() < sim->val.majorityNotPCert)  ++notp;
-					else if(people[i].newBelief.v() <= sim->val.majorityNotPCert) ++notp;
-				}
+		// Update inquirers to new values
+		PROFILE_SCOPE(PROFILE_BELIEF_UPDATES);
+		for(t_int j = 0; j < sch.inquirers.size(); ++j) {
+			t_int i = sch.inquirers[j];
+			if(people[i].newBelief.v() != people[i].belief.v()) {
+				agg.update(sim, i, people[i].belief.v(), people[i].newBelief.v(), people[i].includeInStatistics);
+				++sim->nChanged;
 			}
+			people[i].belief = people[i].newBelief;
 		}
 	}
-
-	// record total statistics
-	if(sim->val.applicationMethod == APPLY_INDIVIDUALLY) sim->eValue = v / (t_float)total;
-	else if(sim->val.applicationMethod == APPLY_TO_AVERAGE) sim->eValue = sim->individualEValue(v / (t_float)total);
 	else {
-		if(sim->val.amtStrictlyGreater) {
-			if((t_float)p > (t_float)total * sim->val.majorityAmt) sim->eValue = sim->val.eValues[2];
-			else if((t_float)notp > (t_float)total * sim->val.majorityAmt) sim->eValue = sim->val.eValues[0];
-			else sim->eValue = sim->val.eValues[1];
+		// steps in blocks, which large societies take on several threads
+		if(!parallelEvolve.step(sim, this)) {
+			// Calculate every inquirer's new degree of belief
+			{
+				PROFILE_SCOPE(PROFILE_INQUIRIES);
+				for(t_int i = 0; i < people.size(); ++i) people[i].doInquiry(sim, this, i);
+			}
+
+			// record messages for links
+			PROFILE_SCOPE(PROFILE_MESSAGE_RECORDING);
+			for(LinkIterator l = links.begin(); l != links.end(); ++l) recordLinkMessage(l->second);
 		}
-		else {
-			if((t_float)p >= (t_float)total * sim->val.majorityAmt) sim->eValue = sim->val.eValues[2];
-			else if((t_float)notp >= (t_float)total * sim->val.majorityAmt) sim->eValue = sim->val.eValues[0];
-			else sim->eValue = sim->val.eValues[1];
+
+		// Update inquirers to new values, and statistics for those whose belief changed
+		PROFILE_SCOPE(PROFILE_BELIEF_UPDATES);
+		for(t_int i = 0; i < people.size(); ++i) {
+			if(people[i].newBelief.v() != people[i].belief.v()) {
+				agg.update(sim, i, people[i].belief.v(), people[i].newBelief.v(), people[i].includeInStatistics);
+				++sim->nChanged;
+			}
+			people[i].belief = people[i].newBelief;
 		}
 	}
-	sim->eValueDelta = sim->eValue - sim->startEValue;
+
+	// record total statistics
+	sim->updateStepStatistics();
 }
 
 
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Society::recordLinkMessage(Link& l) {
+	if(l.evidencePolicy == NEW_EVIDENCE_INQUIRY) {
+		if(people[l.source].message == MSG_SAY_P && people[l.source].newBelief >= l.threshold) l.message = MSG_SAY_P;
+		else if(people[l.source].message == MSG_SAY_NOT_P && people[l.source].newBelief <= 1.0 - l.threshold) l.message = MSG_SAY_NOT_P;
+	}
+	else if(l.evidencePolicy == NEW_EVIDENCE_ANY) {
+		if(people[l.source].newBelief > people[l.source].belief && people[l.source].newBelief >= l.threshold) l.message = MSG_SAY_P;
+		else if(people[l.source].newBelief < people[l.source].belief && people[l.source].newBelief <= 1.0 - l.threshold) l.message = MSG_SAY_NOT_P;
+	}
+}
+
 //-----------------------------------------------------------------------------------------------------------------------
 
 void Society::permuteInquirers(list<t_int> *inqsPerDegree, t_int maxDegree) {
@@ -531,6 +596,8 @@ void Society::placeInquirers(vector<t_int> *inqsPerDegree, t_int maxDegree, t_fl
 //-----------------------------------------------------------------------------------------------------------------------
 
 void Society::organise(void) {
+	PROFILE_SCOPE(PROFILE_LAYOUT);
+
 	// find midpt
 	t_float xMid = societyWindow->view->xMid, yMid = societyWindow->view->yMid;
 
@@ -621,6 +688,7 @@ SocietyFragment* Society::extract(const set<t_int>& inqs, const set<pair<t_int,
 void Society::merge(SocietyFragment* f, pair<t_int, t_int>* newLinks) {
 	t_int *indexRemap = new t_int[f->indices.size() + people.size()];
 	for(t_int i = 0; i < f->indices.size() + people.size(); ++i) indexRemap[i] = i;
+	newGeneration();
 
 	// add new inquirers
 	for(t_int i = 0; i < f->indices.size(); ++i) {
@@ -662,8 +730,16 @@ void Society::saveToFile(const char* filename) {
 	TiXmlElement *root = new TiXmlElement("SOCIETY_FILE");
 	root->SetAttribute("VERSION", LAPUTA_VERSION);
 	f.LinkEndChild(root);
+	root->LinkEndChild(toXML());
+
+	// write out everything
+	f.SaveFile(filename);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+TiXmlElement* Society::toXML(void) {
 	TiXmlElement *soc = new TiXmlElement("SOCIETY");
-	root->LinkEndChild(soc);
 
 	// add inquirers & links
 	for(t_int i = 0; i < people.size(); ++i) {
@@ -675,9 +751,7 @@ void Society::saveToFile(const char* filename) {
 		TiXmlElement *link = l->second.toXML();
 		soc->LinkEndChild(link);
 	}
-
-	// write out everything
-	f.SaveFile(filename);
+	return soc;
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
@@ -705,9 +779,15 @@ void Society::loadFromFile(const char* filename) {
 		return;
 	}
 
-	TiXmlElement *soc = root->FirstChildElement("SOCIETY");
+	fromXML(root->FirstChildElement("SOCIETY"));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Society::fromXML(TiXmlElement* soc) {
 	people.clear();
 	links.clear();
+	newGeneration();
 
 	// read inquirers
 	for(TiXmlElement *inq = soc->FirstChildElement("INQUIRER"); inq != NULL; inq = inq->NextSiblingElement("INQUIRER")) {
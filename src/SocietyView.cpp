@@ -1,6 +1,8 @@
 #include "App.h"
+#include "SimulationThread.h"
 
 #include "FL/fl_draw.H"
+#include "FL/x.H"
 
 #include <cmath>
 
@@ -10,6 +12,15 @@
 
 #define SELECTION_UPDATE_INTERVAL 0.1f
 
+// damage from blinking of the selection, which leaves the link layer as it is
+#define DAMAGE_SELECTION FL_DAMAGE_USER1
+
+// with more links than this, they are drawn as density when zoomed out below LOD_DETAIL_ZOOM, in cells of
+// LOD_CELL_SIZE pixels
+#define LOD_MAX_LINKS 5000
+#define LOD_DETAIL_ZOOM 1.0f
+#define LOD_CELL_SIZE 3
+
 #ifdef _WINDOWS
 #define COPY_KEY_PRESSED Fl::event_ctrl()
 #else
@@ -27,6 +38,27 @@ void IdleCallback(void* v);
 // selection timer global
 t_float selectionColour = 0;
 
+// LinkLayer - an offscreen image of the links & inquirers, drawn again only when something other than the selection
+// has changed
+
+class LinkLayer {
+public:
+	LinkLayer(t_int w, t_int h) {
+		width = w;
+		height = h;
+		offscreen = fl_create_offscreen(w, h);
+		density = false;
+		selectionOnTop = true;
+	}
+	~LinkLayer() { fl_delete_offscreen(offscreen); }
+
+	Fl_Offscreen offscreen;
+	t_int width, height;
+
+	// were links drawn as density, and are selected links left out, to be drawn on top?
+	bool density, selectionOnTop;
+};
+
 //-----------------------------------------------------------------------------------------------------------------------
 
 SocietyView::SocietyView(t_int x, t_int y, t_int w, t_int h, const char *label) : Fl_Widget(x, y, w, h, label)  {
@@ -37,6 +69,8 @@ SocietyView::SocietyView(t_int x, t_int y, t_int w, t_int h, const char *label)
 	showInquirerNames = true;
 	showLinks = true;
 	zoom = 1.0;
+	snapshot = 0;
+	linkLayer = 0;
 
 	// install timer
 	Fl::add_timeout(SELECTION_UPDATE_INTERVAL, IdleCallback, (void*)this);
@@ -44,6 +78,13 @@ SocietyView::SocietyView(t_int x, t_int y, t_int w, t_int h, const char *label)
 
 //-----------------------------------------------------------------------------------------------------------------------
 
+SocietyView::~SocietyView() {
+	Fl::remove_timeout(IdleCallback, (void*)this);
+	delete linkLayer;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
 void SocietyView::setZoomToDefault(int direction) {
 	if(direction == 0) setZoom(1);
 	else {
@@ -193,97 +234,172 @@ void SocietyView::drawLink(t_float x0, t_float y0, t_float x1, t_float y1, t_flo
 
 //-----------------------------------------------------------------------------------------------------------------------
 
-void SocietyView::draw(void) {
-	char str[32];
+void SocietyView::drawLinkBetween(const Link& l, t_float xLeft, t_float yTop, t_float trust, bool drawAsSelected) {
+	t_int src = l.source, tgt = l.target;
+	t_float xOffset = 0, yOffset = 0;
+	t_float x0 = xWorkspaceToView(curSociety->people[src].x), y0 = yWorkspaceToView(curSociety->people[src].y);
+	t_float x1 = xWorkspaceToView(curSociety->people[tgt].x), y1 = yWorkspaceToView(curSociety->people[tgt].y);
 
-	// clear
-	fl_draw_box(FL_FLAT_BOX, x() + 1, y() + 1, w() - 1, h() - 1, FL_WHITE);
+	// skip links that are out of view
+	t_float margin = (INQUIRER_CIRCLE_SIZE + ARROW_LENGTH) * zoom;
+	if((x0 < -margin && x1 < -margin) || (x0 > w() + margin && x1 > w() + margin)) return;
+	if((y0 < -margin && y1 < -margin) || (y0 > h() + margin && y1 > h() + margin)) return;
 
-	// set clipping
-	fl_push_clip(x() + 1, y() + 1, w() - 1, h() - 1);
-	t_float xLeft = x() ;
-	t_float yTop = y();
+	t_float dx = x1 - x0, dy = y1 - y0;
+	t_float d = sqrt(dx * dx + dy * dy);
 
-	// Draw links
-	if (showLinks) {
-		for (LinkIterator l = curSociety->links.begin(); l != curSociety->links.end(); ++l) {
-			int src = l->second.source, tgt = l->second.target;
-			t_float xOffset = 0, yOffset = 0;
-			t_float x0 = xWorkspaceToView(curSociety->people[src].x), y0 = yWorkspaceToView(curSociety->people[src].y);
-			t_float x1 = xWorkspaceToView(curSociety->people[tgt].x), y1 = yWorkspaceToView(curSociety->people[tgt].y);
-			t_float dx = x1 - x0, dy = y1 - y0;
-			t_float d = sqrt(dx * dx + dy * dy);
-
-			// offset a bit if there are two arrows
-			if (curSociety->getLink(tgt, src)) {
-				xOffset = -dy / d * 3.0 * zoom;
-				yOffset = dx / d * 3.0 * zoom;
-			}
+	// offset a bit if there are two arrows
+	if (curSociety->getLink(tgt, src)) {
+		xOffset = -dy / d * 3.0 * zoom;
+		yOffset = dx / d * 3.0 * zoom;
+	}
 
-			// draw back arrowhead a bit
-			d -= INQUIRER_CIRCLE_SIZE;
+	// draw back arrowhead a bit
+	d -= INQUIRER_CIRCLE_SIZE;
 
-			// draw the actual links
-			if (d > INQUIRER_CIRCLE_SIZE) {
-				drawLink(xLeft + x0 + xOffset, yTop + y0 + yOffset, xLeft + x1 + xOffset - dx / d * INQUIRER_CIRCLE_SIZE * zoom,
-					yTop + y1 + yOffset - dy / d * INQUIRER_CIRCLE_SIZE * zoom, d, l->second.listenChance,
-					l->second.trust.expectation(), isLinkSelected(src, tgt));
-			}
-		}
+	// draw the actual link
+	if (d > INQUIRER_CIRCLE_SIZE) {
+		drawLink(xLeft + x0 + xOffset, yTop + y0 + yOffset, xLeft + x1 + xOffset - dx / d * INQUIRER_CIRCLE_SIZE * zoom,
+			yTop + y1 + yOffset - dy / d * INQUIRER_CIRCLE_SIZE * zoom, d, l.listenChance, trust, drawAsSelected);
 	}
+}
 
-	// Draw currently pulled link
-	if(linkDragInProgress) {
-		t_float dx = xDragEnd - xDragStart;
-		t_float dy = yDragEnd - yDragStart;
-		t_float d = sqrt(dx * dx + dy * dy);
-		t_float x1 = xDragEnd, y1 = yDragEnd;
+//-----------------------------------------------------------------------------------------------------------------------
 
-		if(targetInquirer != INQ_NONE && targetInquirer != srcInquirer) {
-			// we have a target; pull back arrow a bit
-			x1 -= dx / (d + 4.0) * INQUIRER_CIRCLE_SIZE;
-			y1 -= dy / (d + 4.0) * INQUIRER_CIRCLE_SIZE;
-			d -= INQUIRER_CIRCLE_SIZE + 4.0;
+void SocietyView::drawLinkDensity(const SimulationSnapshot* snap) {
+	// Links are followed through cells of a few pixels, and each cell is shaded by how many pass through it, on a log
+	// scale, in the colour of their average trust. There are no arrows, but the shape of the network shows.
+	t_int gw = (w() + LOD_CELL_SIZE - 1) / LOD_CELL_SIZE, gh = (h() + LOD_CELL_SIZE - 1) / LOD_CELL_SIZE;
+	vector<float> count(gw * gh, 0), trust(gw * gh, 0);
+	t_int linkIndex = 0;
+	for (LinkIterator l = curSociety->links.begin(); l != curSociety->links.end(); ++l, ++linkIndex) {
+		const Inquirer& a = curSociety->people[l->second.source], &b = curSociety->people[l->second.target];
+		t_float x0 = xWorkspaceToView(a.x) / LOD_CELL_SIZE, y0 = yWorkspaceToView(a.y) / LOD_CELL_SIZE;
+		t_float x1 = xWorkspaceToView(b.x) / LOD_CELL_SIZE, y1 = yWorkspaceToView(b.y) / LOD_CELL_SIZE;
+		if((x0 < 0 && x1 < 0) || (x0 >= gw && x1 >= gw) || (y0 < 0 && y1 < 0) || (y0 >= gh && y1 >= gh)) continue;
+		t_float t = snap ? snap->trust[linkIndex] : l->second.trust.expectation();
+
+		// a step of at most a cell at a time
+		t_int n = (t_int)fmax(fabs(x1 - x0), fabs(y1 - y0)) + 1;
+		for(t_int k = 0; k <= n; ++k) {
+			t_int cx = (t_int)floor(x0 + (x1 - x0) * k / n), cy = (t_int)floor(y0 + (y1 - y0) * k / n);
+			if(cx < 0 || cx >= gw || cy < 0 || cy >= gh) continue;
+			count[cy * gw + cx] += 1;
+			trust[cy * gw + cx] += t;
 		}
+	}
 
-		// draw
-		if(d > INQUIRER_CIRCLE_SIZE) drawLink(xWorkspaceToView(xDragStart) + xLeft, yWorkspaceToView(yDragStart) + yTop,
-													 xWorkspaceToView(x1) + xLeft,  yWorkspaceToView(y1) + yTop, d, 1.0, 1.0, true);
+	// shade of each cell, from white to the colour of a link
+	t_float maxCount = 1;
+	for(t_int c = 0; c < gw * gh; ++c) if(count[c] > maxCount) maxCount = count[c];
+	vector<unsigned char> rgb(gw * gh * 3, 0xFF);
+	for(t_int c = 0; c < gw * gh; ++c) {
+		if(count[c] == 0) continue;
+		t_float t = trust[c] / count[c], s = log(1.0f + count[c]) / log(1.0f + maxCount);
+		t_float r = t < 0.5 ? 255.0 : 255.0 * (2.0 - t * 2.0), g = t < 0.5 ? 255.0 * t * 2.0 : 255.0;
+		rgb[c * 3] = (unsigned char)(255.0 - s * (255.0 - r));
+		rgb[c * 3 + 1] = (unsigned char)(255.0 - s * (255.0 - g));
+		rgb[c * 3 + 2] = (unsigned char)(255.0 - s * 255.0);
+	}
+
+	// blown up to pixels
+	vector<unsigned char> img(w() * h() * 3);
+	for(t_int y = 0; y < h(); ++y) {
+		for(t_int x = 0; x < w(); ++x) memcpy(&img[(y * w() + x) * 3], &rgb[((y / LOD_CELL_SIZE) * gw + x / LOD_CELL_SIZE) * 3], 3);
+	}
+	fl_draw_image(&img[0], 0, 0, w(), h());
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void SocietyView::drawLayer(const SimulationSnapshot* snap) {
+	char str[32];
+
+	// clear
+	fl_draw_box(FL_FLAT_BOX, 0, 0, w(), h(), FL_WHITE);
+
+	// Draw links - a large society, zoomed out, as density. Selected links are drawn on top, unless there are too
+	// many of them to blink.
+	linkLayer->density = curSociety->links.size() > LOD_MAX_LINKS && zoom < LOD_DETAIL_ZOOM;
+	linkLayer->selectionOnTop = !linkLayer->density || selectedLinks.size() <= LOD_MAX_LINKS;
+	if (showLinks) {
+		if(linkLayer->density) drawLinkDensity(snap);
+		else {
+			t_int linkIndex = 0;
+			for (LinkIterator l = curSociety->links.begin(); l != curSociety->links.end(); ++l, ++linkIndex) {
+				if (!selectedLinks.empty() && isLinkSelected(l->second.source, l->second.target)) continue;
+				drawLinkBetween(l->second, 0, 0, snap ? snap->trust[linkIndex] : l->second.trust.expectation(), false);
+			}
+		}
 	}
 
 	// Draw all inquirers
 	for(t_int i = 0; i < curSociety->people.size(); ++i) {
-		setInquirerColour(curSociety->people[i].belief.v());
+		setInquirerColour(snap ? snap->beliefs[i] : curSociety->people[i].belief.v());
 		fl_line_style(FL_SOLID, 2 * zoom, 0);
-		fl_pie(xWorkspaceToView(curSociety->people[i].x) + xLeft - (INQUIRER_CIRCLE_SIZE) * zoom, yWorkspaceToView(curSociety->people[i].y) + yTop - (INQUIRER_CIRCLE_SIZE) * zoom,
+		fl_pie(xWorkspaceToView(curSociety->people[i].x) - (INQUIRER_CIRCLE_SIZE) * zoom, yWorkspaceToView(curSociety->people[i].y) - (INQUIRER_CIRCLE_SIZE) * zoom,
 			(INQUIRER_CIRCLE_SIZE * 2) * zoom, (INQUIRER_CIRCLE_SIZE * 2) * zoom, 0, 360);
 		fl_color(0, 0, 0);
 		fl_line_style(FL_SOLID, 2 * zoom, 0);
-		fl_circle(xWorkspaceToView(curSociety->people[i].x) + xLeft, yWorkspaceToView(curSociety->people[i].y) + yTop,
-			INQUIRER_CIRCLE_SIZE * zoom);
+		fl_circle(xWorkspaceToView(curSociety->people[i].x), yWorkspaceToView(curSociety->people[i].y), INQUIRER_CIRCLE_SIZE * zoom);
 
 		// does inquirer have a name?
 		if(curSociety->people[i].name[0] && showInquirerNames) {
 			fl_font(FL_HELVETICA | FL_BOLD, 10 * zoom);
-			fl_draw(curSociety->people[i].name, xWorkspaceToView(curSociety->people[i].x) + xLeft - fl_width(curSociety->people[i].name) / 2,
-				yWorkspaceToView(curSociety->people[i].y) + yTop + (INQUIRER_CIRCLE_SIZE + 13) * zoom);
+			fl_draw(curSociety->people[i].name, xWorkspaceToView(curSociety->people[i].x) - fl_width(curSociety->people[i].name) / 2,
+				yWorkspaceToView(curSociety->people[i].y) + (INQUIRER_CIRCLE_SIZE + 13) * zoom);
 		}
 
 		// should we draw numbers?
 		if(showInquirerNumbers) {
 			fl_font(FL_HELVETICA, 9);
 			sprintf(str, "%d", i + 1);
-			fl_draw(str, xWorkspaceToView(curSociety->people[i].x) + xLeft - fl_width(str) / 2 + 1,
-				yWorkspaceToView(curSociety->people[i].y) + yTop + 5);
+			fl_draw(str, xWorkspaceToView(curSociety->people[i].x) - fl_width(str) / 2 + 1, yWorkspaceToView(curSociety->people[i].y) + 5);
 		}
+	}
+	fl_line_style(FL_SOLID, 0, 0);
+}
 
-		// draw selection highlight
-		if(isInquirerSelected(i) || i == srcInquirer || i == targetInquirer) {
-			fl_color(selectionColour, selectionColour, selectionColour);
-			fl_line_style(FL_SOLID, 2 * zoom, 0);
-			fl_circle(xWorkspaceToView(curSociety->people[i].x) + xLeft, yWorkspaceToView(curSociety->people[i].y) + yTop,
-				(INQUIRER_CIRCLE_SIZE + 3) * zoom);
+//-----------------------------------------------------------------------------------------------------------------------
+
+void SocietyView::drawOverlay(t_float xLeft, t_float yTop) {
+	// Draw selected links, unless there are too many to draw over the density of links
+	if (showLinks && linkLayer->selectionOnTop && (!linkLayer->density || selectedLinks.size() <= LOD_MAX_LINKS)) {
+		for (set<pair<t_int, t_int> >::iterator i = selectedLinks.begin(); i != selectedLinks.end(); ++i) {
+			Link* l = curSociety->getLink(i->first, i->second);
+			if (l) drawLinkBetween(*l, xLeft, yTop, 0, true);
+		}
+	}
+
+	// Draw currently pulled link
+	if(linkDragInProgress) {
+		t_float dx = xDragEnd - xDragStart;
+		t_float dy = yDragEnd - yDragStart;
+		t_float d = sqrt(dx * dx + dy * dy);
+		t_float x1 = xDragEnd, y1 = yDragEnd;
+
+		if(targetInquirer != INQ_NONE && targetInquirer != srcInquirer) {
+			// we have a target; pull back arrow a bit
+			x1 -= dx / (d + 4.0) * INQUIRER_CIRCLE_SIZE;
+			y1 -= dy / (d + 4.0) * INQUIRER_CIRCLE_SIZE;
+			d -= INQUIRER_CIRCLE_SIZE + 4.0;
 		}
+
+		// draw
+		if(d > INQUIRER_CIRCLE_SIZE) drawLink(xWorkspaceToView(xDragStart) + xLeft, yWorkspaceToView(yDragStart) + yTop,
+													 xWorkspaceToView(x1) + xLeft,  yWorkspaceToView(y1) + yTop, d, 1.0, 1.0, true);
+	}
+
+	// draw selection highlights
+	set<t_int> highlighted = selectedInquirers;
+	if(srcInquirer != INQ_NONE) highlighted.insert(srcInquirer);
+	if(targetInquirer != INQ_NONE) highlighted.insert(targetInquirer);
+	fl_color(selectionColour, selectionColour, selectionColour);
+	fl_line_style(FL_SOLID, 2 * zoom, 0);
+	for(set<t_int>::iterator i = highlighted.begin(); i != highlighted.end(); ++i) {
+		if(*i < 0 || *i >= curSociety->people.size()) continue;
+		fl_circle(xWorkspaceToView(curSociety->people[*i].x) + xLeft, yWorkspaceToView(curSociety->people[*i].y) + yTop,
+			(INQUIRER_CIRCLE_SIZE + 3) * zoom);
 	}
 
 	// draw selection rectangle
@@ -299,6 +415,32 @@ void SocietyView::draw(void) {
 
 		fl_frame("AAAA", xWorkspaceToView(x0) + xLeft, yWorkspaceToView(y0) + yTop, fabs(xWorkspaceToView(xDragEnd)- xWorkspaceToView(xDragStart)), fabs(yWorkspaceToView(yDragEnd) - yWorkspaceToView(yDragStart)));
 	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void SocietyView::draw(void) {
+	// while a simulation runs in the background, beliefs & trust must come from its snapshot
+	const SimulationSnapshot* snap = snapshot;
+	if (snap && (snap->beliefs.size() != curSociety->people.size() || snap->trust.size() != curSociety->links.size())) snap = 0;
+
+	// redraw the layer of links & inquirers if anything but the selection has changed, or the view has been resized
+	bool changed = (damage() & ~(DAMAGE_SELECTION | FL_DAMAGE_EXPOSE)) != 0;
+	if(!linkLayer || linkLayer->width != w() || linkLayer->height != h()) {
+		delete linkLayer;
+		linkLayer = new LinkLayer(w(), h());
+		changed = true;
+	}
+	if(changed) {
+		fl_begin_offscreen(linkLayer->offscreen);
+		drawLayer(snap);
+		fl_end_offscreen();
+	}
+	fl_copy_offscreen(x(), y(), w(), h(), linkLayer->offscreen, 0, 0);
+
+	// selection & dragging on top
+	fl_push_clip(x() + 1, y() + 1, w() - 1, h() - 1);
+	drawOverlay(x(), y());
 
 	// restore line style
 	fl_line_style(FL_SOLID, 0, 0);
@@ -469,6 +611,7 @@ t_int SocietyView::handle(t_int event) {
 			break;
 
 		case TOOL_ADD_INQUIRER:
+			app->undos.touchInquirer(*curSociety, curSociety->people.size());
 			curSociety->addInquirer(xViewToWorkspace(Fl::event_x() - xLeft), yViewToWorkspace(Fl::event_y() - yTop), &app->curSocietySetup);
 			app->touchFile();
 			updateStatistics();
@@ -513,6 +656,7 @@ t_int SocietyView::handle(t_int event) {
 				}
 
 				// move inquirers
+				app->undos.touchInquirers(*curSociety, selectedInquirers);
 				set<t_int>::iterator iter(selectedInquirers.begin());
 				while(iter != selectedInquirers.end()) {
 					curSociety->people[*iter].x += xDragEnd - xDragStart;
@@ -524,14 +668,16 @@ t_int SocietyView::handle(t_int event) {
 				xDragStart = xDragEnd;
 				yDragStart = yDragEnd;
 				app->touchFile();
+				redraw();
 			}
 			else if(selectionDragInProgress) {
-				// update which things are selected
+				// update which things are selected - the layer was drawn with nothing selected, so links selected
+				// since are drawn on top of it, and it is only redrawn without them once the drag ends
 				updateSelectionFromRect(xDragStart, yDragStart, xDragEnd, yDragEnd);
 				inquirerWindow->configure();
 				linkWindow->configure();
+				damage(DAMAGE_SELECTION);
 			}
-			redraw();
 			break;
 		case TOOL_ADD_LINK:
 			if(linkDragInProgress) {
@@ -541,7 +687,9 @@ t_int SocietyView::handle(t_int event) {
 					xDragEnd = curSociety->people[targetInquirer].x;
 					yDragEnd = curSociety->people[targetInquirer].y;
 				}
-				redraw();
+
+				// the link being pulled is drawn on top
+				damage(DAMAGE_SELECTION);
 			}
 			break;
 		default:
@@ -553,17 +701,19 @@ t_int SocietyView::handle(t_int event) {
 		// what to do depends on the tool
 		switch(app->getTool()) {
 		case TOOL_SELECT:
+			if(selectionDragInProgress) redraw();
 			inquirerDragInProgress = selectionDragInProgress = copyDragInProgress = false;
 			break;
 		case TOOL_ADD_LINK:
 			linkDragInProgress = false;
 			if(srcInquirer != INQ_NONE && targetInquirer != INQ_NONE && srcInquirer != targetInquirer) {
+				app->undos.touchLink(*curSociety, srcInquirer, targetInquirer);
 				if(curSociety->getLink(srcInquirer, targetInquirer)) curSociety->removeLink(srcInquirer, targetInquirer);
 				curSociety->addLink(srcInquirer, targetInquirer, &app->curSocietySetup);
 				updateStatistics();
+				app->touchFile();
 			}
 			srcInquirer = targetInquirer = INQ_NONE;
-            app->touchFile();
 			redraw();
 			break;
 		default:
@@ -813,9 +963,9 @@ void IdleCallback(void* v) {
 	// update selection color
 	selectionColour = 128.0f + 127.0f * sin(t);
 
-	// redraw Society view
+	// redraw the selection on top of the Society view
 	if(!((SocietyView*)v)->selectedInquirers.empty() || !((SocietyView*)v)->selectedLinks.empty())
-		((SocietyView*)v)->redraw();
+		((SocietyView*)v)->damage(DAMAGE_SELECTION);
 
 	// reinstall callback
 	Fl::repeat_timeout(SELECTION_UPDATE_INTERVAL, IdleCallback, v);
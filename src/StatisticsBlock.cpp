@@ -1,6 +1,8 @@
 #include "StatisticsBlock.h"
 
 #include <cstdlib>
+#include <climits>
+#include <new>
 #include <set>
 #include "Utility.h"
 
@@ -14,7 +16,8 @@ float* StatisticsBlock::allocate(t_int w, t_int h, t_int d) {
 	width = w;
 	height = h;
 	depth = d;
-	data = new float[w * h * d];
+	// a block too big to index, or that there isn't memory for, is left empty
+	data = (long long)w * h * d <= INT_MAX ? new (nothrow) float[(size_t)w * h * d] : 0;
 	refcount = new t_int;
 	*refcount = 1;
 	xOffset = yOffset = zOffset = 0;
@@ -0,0 +1,390 @@
+#include "Sweep.h"
+#include <FL/Fl.H>
+#include "Utility.h"
+#include "UserInterfaceItems.h"
+#include "App.h"
+#include "Profiler.h"
+#include <gsl/gsl_qrng.h>
+#include <gsl/gsl_randist.h>
+#include <time.h>
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+// Where a parameter is kept in a batch, for a stage of its setup - one of f, n & d is set, or none if there is no
+// parameter of that name. inSetup tells if it is a parameter of the society setup, which has one for each stage.
+static void LocateParameter(BatchSimulation& bs, const string& name, t_int stage, t_float*& f, t_int*& n, Distribution*& d, bool& inSetup) {
+	f = 0;
+	n = 0;
+	d = 0;
+	inSetup = false;
+
+	// batch
+	if(name == "TRIALS") n = &bs.nTrials;
+	else if(name == "MIN_TRIALS") n = &bs.minTrials;
+	else if(name == "TARGET_MARGIN") f = &bs.targetMargin;
+	else if(name == "CONFIDENCE") f = &bs.confidenceLevel;
+	else if(name.size() == 7 && name.compare(0, 6, "STEPS_") == 0 && name[6] >= '0' && name[6] < '0' + MAX_BATCH_STAGES) n = &bs.nSteps[name[6] - '0'];
+
+	// simulation
+	else if(name == "EVALUE_BELIEF_NOT_P") f = &bs.sim.val.eValues[0];
+	else if(name == "EVALUE_BELIEF_P_OR_NOT_P") f = &bs.sim.val.eValues[1];
+	else if(name == "EVALUE_BELIEF_P") f = &bs.sim.val.eValues[2];
+	else if(name == "MAJORITY_AMOUNT") f = &bs.sim.val.majorityAmt;
+	else if(name == "P_CERTAINTY_REQUIRED") f = &bs.sim.val.majorityPCert;
+	else if(name == "NOT_P_CERTAINTY_REQUIRED") f = &bs.sim.val.majorityNotPCert;
+	else if(name == "EXPONENT") f = &bs.sim.val.exponent;
+
+	// society setup
+	else {
+		SocietySetup& s = bs.setup[stage];
+		inSetup = true;
+		if(name == "INITIAL_POPULATION_PART") f = &s.initialPopulationPart;
+		else if(name == "GROWTH_BALANCE") f = &s.growthBalance;
+		else if(name == "LINK_WEIGHT_BASE") f = &s.linkWeights[WT_BASE];
+		else if(name == "LINK_WEIGHT_SYMMETRY") f = &s.linkWeights[WT_SYMMETRY];
+		else if(name == "LINK_WEIGHT_TRANSITIVITY") f = &s.linkWeights[WT_TRANSITIVITY];
+		else if(name == "LINK_WEIGHT_CLUSTERING") f = &s.linkWeights[WT_CLUSTERING];
+		else if(name == "POPULATION_DISTRIBUTION") d = &s.populationDistribution;
+		else if(name == "LINK_DENSITY_DISTRIBUTION") d = &s.linkDensityDistribution;
+		else if(name == "START_BELIEF") d = &s.inqParams.startBelief;
+		else if(name == "INQ_CHANCE") d = &s.inqParams.inquiryChance;
+		else if(name == "INQ_ACCURACY") d = &s.inqParams.inquiryAccuracy;
+		else if(name == "LISTEN_CHANCE") d = &s.linkParams.linkListenChance;
+		else if(name == "LINK_THRESHOLD") d = &s.linkParams.linkThreshold;
+		else inSetup = false;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+SweepParameter::SweepParameter(TiXmlElement* xml) {
+	const char* c = xml->Attribute("NAME");
+	name = c ? c : "";
+	kind = -1;
+	min = 0;
+	max = 1;
+	levels = 2;
+	stage = -1;
+	xml->QueryDoubleAttribute("MIN", &min);
+	xml->QueryDoubleAttribute("MAX", &max);
+	xml->QueryIntAttribute("LEVELS", &levels);
+	xml->QueryIntAttribute("STAGE", &stage);
+	if(xml->FirstChildElement("LOW")) low = Distribution(xml->FirstChildElement("LOW"));
+	if(xml->FirstChildElement("HIGH")) high = Distribution(xml->FirstChildElement("HIGH"));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+TiXmlElement* SweepParameter::toXML(void) const {
+	TiXmlElement* xml = new TiXmlElement("PARAMETER");
+	xml->SetAttribute("NAME", name.c_str());
+	if(kind == SWEEP_DISTRIBUTION) {
+		xml->LinkEndChild(low.toXML("LOW"));
+		xml->LinkEndChild(high.toXML("HIGH"));
+	}
+	else {
+		xml->SetDoubleAttribute("MIN", min);
+		xml->SetDoubleAttribute("MAX", max);
+	}
+	xml->SetAttribute("LEVELS", levels);
+	if(stage >= 0) xml->SetAttribute("STAGE", stage);
+	return xml;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool SweepParameter::locate(BatchSimulation& bs) {
+	t_float* f;
+	t_int* n;
+	Distribution* d;
+	bool inSetup;
+	LocateParameter(bs, name, stage >= 0 ? stage : 0, f, n, d, inSetup);
+	if(f) kind = SWEEP_NUMBER;
+	else if(n) kind = SWEEP_WHOLE_NUMBER;
+	else if(d) kind = SWEEP_DISTRIBUTION;
+	else kind = -1;
+	return kind >= 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void SweepParameter::apply(BatchSimulation& bs, t_float u) const {
+	for(t_int i = stage >= 0 ? stage : 0; i < MAX_BATCH_STAGES; ++i) {
+		t_float* f;
+		t_int* n;
+		Distribution* d;
+		bool inSetup;
+		LocateParameter(bs, name, i, f, n, d, inSetup);
+		if(f) *f = value(u);
+		else if(n) *n = (t_int)value(u);
+		else if(d) *d = Distribution(low, high, u);
+
+		// parameters of the batch & simulation are only set once, as are those of a given stage
+		if(!inSetup || stage >= 0) break;
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_float SweepParameter::value(t_float u) const {
+	if(kind == SWEEP_DISTRIBUTION) return Distribution(low, high, u).getMean();
+	t_float v = min * (1.0 - u) + max * u;
+	if(kind == SWEEP_WHOLE_NUMBER) v = floor(v + 0.5);
+	return v;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+Sweep::Sweep(TiXmlElement* xml, const BatchSimulation& defaultBatch) {
+	// read fields
+	design = SWEEP_FACTORIAL;
+	const char* c = xml->Attribute("DESIGN");
+	if(c && !strcmp(c, "latin hypercube")) design = SWEEP_LATIN_HYPERCUBE;
+	else if(c && !strcmp(c, "sobol")) design = SWEEP_SOBOL;
+	nPoints = 0;
+	xml->QueryIntAttribute("POINTS", &nPoints);
+	seed = runSeed = 0;
+	xml->QueryIntAttribute("SEED", &seed);
+	pointsDone = 0;
+	filename[0] = '\0';
+	file = 0;
+	out = 0;
+
+	// parameters, and the batch they are varied in - the current batch if none is given
+	for(TiXmlElement* p = xml->FirstChildElement("PARAMETER"); p; p = p->NextSiblingElement("PARAMETER")) parameters.push_back(SweepParameter(p));
+	if(xml->FirstChildElement("BATCH")) batch = BatchSimulation(xml->FirstChildElement("BATCH"));
+	else batch = defaultBatch;
+	batch.displayResults = false;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+TiXmlElement* Sweep::toXML(void) {
+	TiXmlElement* xml = new TiXmlElement("SWEEP");
+	if(design == SWEEP_LATIN_HYPERCUBE) xml->SetAttribute("DESIGN", "latin hypercube");
+	else if(design == SWEEP_SOBOL) xml->SetAttribute("DESIGN", "sobol");
+	else xml->SetAttribute("DESIGN", "factorial");
+	if(design != SWEEP_FACTORIAL) xml->SetAttribute("POINTS", nPoints);
+	xml->SetAttribute("SEED", seed);
+	for(t_int j = 0; j < parameters.size(); ++j) xml->LinkEndChild(parameters[j].toXML());
+	xml->LinkEndChild(batch.toXML("BATCH"));
+	return xml;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+string Sweep::check(void) {
+	if(parameters.empty()) return "The sweep has no parameters.";
+	for(t_int j = 0; j < parameters.size(); ++j) {
+		SweepParameter& p = parameters[j];
+		if(!p.locate(batch)) return "There is no parameter called \"" + p.name + "\".";
+		if(p.stage >= batch.nStages) return "The batch has no stage " + string(IntToString(p.stage)) + " for " + p.name + ".";
+		if(design == SWEEP_FACTORIAL && p.levels < 1) return "Every parameter needs at least one level.";
+
+		// trials & steps can't run out, and confidence is a probability
+		if(p.kind == SWEEP_WHOLE_NUMBER && (p.min < 1 || p.max < 1)) return p.name + " has to be at least 1.";
+		if(p.name == "CONFIDENCE" && (p.min < 0 || p.min > 1 || p.max < 0 || p.max > 1)) return "CONFIDENCE has to be between 0 and 1.";
+	}
+	if(design != SWEEP_FACTORIAL && nPoints < 1) return "The sweep needs at least one point.";
+	if(design == SWEEP_SOBOL && parameters.size() > SWEEP_MAX_SOBOL_PARAMETERS)
+		return "A Sobol design can have at most " + string(IntToString(SWEEP_MAX_SOBOL_PARAMETERS)) + " parameters.";
+	return "";
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Sweep::makeDesign(void) {
+	t_int D = parameters.size();
+
+	if(design == SWEEP_FACTORIAL) {
+		// every combination of levels, with the first parameter changing fastest
+		nPoints = 1;
+		for(t_int j = 0; j < D; ++j) nPoints *= parameters[j].levels;
+		points.resize(nPoints * D);
+		for(t_int i = 0; i < nPoints; ++i) {
+			t_int k = i;
+			for(t_int j = 0; j < D; ++j) {
+				t_int l = parameters[j].levels;
+				points[i * D + j] = l > 1 ? (t_float)(k % l) / (t_float)(l - 1) : 0;
+				k /= l;
+			}
+		}
+	}
+	else if(design == SWEEP_LATIN_HYPERCUBE) {
+		// each parameter's range cut in nPoints pieces, every piece used once, at random within it. The dice come from
+		// a stream of the master seed after those of the batches.
+		points.resize(nPoints * D);
+		gsl_rng* r = gsl_rng_alloc(RandomGeneratorType(batch.sim.randomGenerator));
+		SeedRandomStream(r, runSeed, nPoints);
+		vector<t_int> order(nPoints);
+		for(t_int j = 0; j < D; ++j) {
+			for(t_int i = 0; i < nPoints; ++i) order[i] = i;
+			gsl_ran_shuffle(r, &order[0], nPoints, sizeof(t_int));
+			for(t_int i = 0; i < nPoints; ++i) points[i * D + j] = ((t_float)order[i] + gsl_rng_uniform(r)) / (t_float)nPoints;
+		}
+		gsl_rng_free(r);
+	}
+	else {
+		// low-discrepancy sequence, starting at the middle of the space
+		points.resize(nPoints * D);
+		gsl_qrng* q = gsl_qrng_alloc(gsl_qrng_sobol, D);
+		vector<double> x(D);
+		for(t_int i = 0; i < nPoints; ++i) {
+			gsl_qrng_get(q, &x[0]);
+			for(t_int j = 0; j < D; ++j) points[i * D + j] = x[j];
+		}
+		gsl_qrng_free(q);
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+BatchSimulation* Sweep::makeBatch(t_int point) {
+	BatchSimulation* bs = new BatchSimulation;
+	*bs = batch;
+	t_int D = parameters.size();
+	for(t_int j = 0; j < D; ++j) parameters[j].apply(*bs, points[point * D + j]);
+	bs->curTrial = bs->sim.curStep = bs->curStage = bs->nTrialsRun = 0;
+	bs->seed = DeriveRandomSeed(runSeed, point);
+	return bs;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool Sweep::start(const char* resultsFile) {
+	if(!openResults(resultsFile)) return false;
+	runSeed = seed ? seed : NewRandomSeed();
+	pointsDone = 0;
+	makeDesign();
+	if(batch.templateSociety) delete batch.templateSociety;
+	batch.templateSociety = new Society(*curSociety);
+
+	// run the batches on all cores, and collect them here as they finish
+	ResetProfile();
+	societyWindow->showDialog(DIALOG_SWEEP_PROGRESS, this);
+	batchScheduler.start(nPoints, [this](t_int point) { return makeBatch(point); });
+	Fl::add_timeout(SWEEP_POLL_INTERVAL, SweepProcess, this);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool Sweep::openResults(const char* resultsFile) {
+	strcpy(filename, resultsFile);
+	file = fopen(filename, "w");
+	if(!file) return false;
+	out = new FileWriter(file);
+
+	// table heading
+	out->put("Point");
+	for(t_int j = 0; j < parameters.size(); ++j) {
+		out->put('\t');
+		out->put(parameters[j].name.c_str());
+		if(parameters[j].stage >= 0) {
+			out->put('_');
+			out->putInt(parameters[j].stage);
+		}
+	}
+	out->put("\tE-value\tE-value delta\tPolarisation\tPolarisation delta\tTrials");
+	out->newLine();
+	out->flush();
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Sweep::writeResults(t_int point, const BatchStatistics& s, t_int nTrialsRun) {
+	t_int D = parameters.size();
+	out->putInt(point);
+	for(t_int j = 0; j < D; ++j) {
+		out->put('\t');
+		out->putFloat(parameters[j].value(points[point * D + j]), 6);
+	}
+	out->put('\t');
+	out->putFloat(s.totalEValue, 6);
+	out->put('\t');
+	out->putFloat(s.totalEValueDelta, 6);
+	out->put('\t');
+	out->putFloat(s.totalPolarisation, 6);
+	out->put('\t');
+	out->putFloat(s.totalPolarisationDelta, 6);
+	out->put('\t');
+	out->putInt(nTrialsRun);
+	out->newLine();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Sweep::process(void) {
+	// write out batches as they finish, in whatever order that is
+	BatchSimulation* bs;
+	t_int before = pointsDone;
+	for(t_int point = batchScheduler.takeFinished(bs); point >= 0; point = batchScheduler.takeFinished(bs)) {
+		writeResults(point, bs->stats, bs->nTrialsRun);
+		delete bs;
+		++pointsDone;
+	}
+	if(pointsDone > before) {
+		out->flush();
+		fflush(file);
+	}
+
+	// fill out progress
+	doubleProgressWindow->barProgress->value((t_float)pointsDone * 100.0 / (t_float)nPoints);
+	string str = string(IntToString(pointsDone)) + string(" / ") + string(IntToString(nPoints));
+	doubleProgressWindow->outputSecondProgress->value(str.c_str());
+	long long trials, inquirerSteps, linkVisits;
+	batchScheduler.workDone(trials, inquirerSteps, linkVisits);
+	if(doubleProgressWindow->throughput.update(pointsDone, trials, inquirerSteps, linkVisits)) doubleProgressWindow->boxThroughput->copy_label(doubleProgressWindow->throughput.describe().c_str());
+
+	if(pointsDone == nPoints) {
+		batchScheduler.stop();
+		finish();
+		saveManifest();
+		if(ProfileEnabled()) SaveProfile(ProfileFileName(filename).c_str());
+		doubleProgressWindow->closeDialog(true);
+	}
+	else Fl::repeat_timeout(SWEEP_POLL_INTERVAL, SweepProcess, this);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Sweep::finish(void) {
+	if(out) delete out;
+	out = 0;
+	if(file) fclose(file);
+	file = 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void Sweep::saveManifest(void) {
+	// a sweep file, which runs the same batches again when opened
+	TiXmlDocument f;
+	TiXmlDeclaration* decl = new TiXmlDeclaration( "1.0", "UTF-8", "true" );
+	f.LinkEndChild(decl);
+	TiXmlElement *root = new TiXmlElement("SWEEP_FILE");
+	root->SetAttribute("VERSION", LAPUTA_VERSION);
+	root->SetAttribute("RESULTS", fl_filename_name(filename));
+	time_t now = time(0);
+	char date[64];
+	strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&now));
+	root->SetAttribute("DATE", date);
+	f.LinkEndChild(root);
+	TiXmlElement *xml = toXML();
+	xml->SetAttribute("SEED", runSeed);
+	root->LinkEndChild(xml);
+
+	// write out everything
+	char manifest[FL_PATH_MAX];
+	strcpy(manifest, filename);
+	fl_filename_setext(manifest, FL_PATH_MAX, ".manifest.sweep");
+	f.SaveFile(manifest);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void SweepProcess(void* data) {
+	Sweep* sw = (Sweep*)data;
+	sw->process();
+}
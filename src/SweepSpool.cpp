@@ -0,0 +1,339 @@
+#include "SweepSpool.h"
+#include "Society.h"
+#include "Random.h"
+#include <FL/filename.H>
+#include <FL/fl_utf8.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <chrono>
+#include <time.h>
+#include <sys/stat.h>
+#ifdef _WINDOWS
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+SweepSpool::SweepSpool(const char* d) : dir(d) {
+	sweep = 0;
+	nUnits = 0;
+	lastReport = lastRenewal = 0;
+	unitPoints = SWEEP_UNIT_POINTS;
+
+	// workers started at the same moment on different computers still get different ids
+	char s[16];
+	sprintf(s, "%08x", (unsigned)DeriveRandomSeed(NewRandomSeed(), getpid()));
+	id = s;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+string SweepSpool::unitName(t_int unit) const {
+	char s[32];
+	sprintf(s, "unit%06d", unit);
+	return string(s);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+string SweepSpool::claimName(t_int unit) const {
+	return unitName(unit) + "." + id;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool SweepSpool::create(Sweep& sw, Society* soc) {
+	if(fl_filename_isdir(dir.c_str())) return false;
+	if(fl_mkdir(dir.c_str(), 0777) != 0 || fl_mkdir((dir + "/todo").c_str(), 0777) != 0 ||
+	   fl_mkdir((dir + "/claimed").c_str(), 0777) != 0 || fl_mkdir((dir + "/done").c_str(), 0777) != 0) return false;
+
+	// the sweep, with the seed every worker is to use
+	sw.runSeed = sw.seed ? sw.seed : NewRandomSeed();
+	sw.makeDesign();
+	unitPoints = SWEEP_UNIT_POINTS;
+	nUnits = (sw.nPoints + unitPoints - 1) / unitPoints;
+	TiXmlElement* xml = sw.toXML();
+	xml->SetAttribute("SEED", sw.runSeed);
+	xml->SetAttribute("UNIT_POINTS", unitPoints);
+	xml->SetAttribute("UNITS", nUnits);
+	CheckpointFile f;
+	if(!f.create((dir + "/sweep").c_str(), CHECKPOINT_SWEEP_SPOOL, xml, soc) || !f.commit()) return false;
+
+	// units of work, & the token taken by whoever merges the results
+	for(t_int i = 0; i < nUnits; ++i) {
+		FILE* u = fopen((dir + "/todo/" + unitName(i)).c_str(), "w");
+		if(!u) return false;
+		fclose(u);
+	}
+	FILE* m = fopen((dir + "/merge").c_str(), "w");
+	if(!m) return false;
+	fclose(m);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool SweepSpool::open(void) {
+	CheckpointFile f;
+	if(!f.open((dir + "/sweep").c_str()) || f.kind != CHECKPOINT_SWEEP_SPOOL || !f.society()) return false;
+
+	// society the sweep is run on
+	delete curSociety;
+	curSociety = new Society;
+	curSociety->fromXML(f.society());
+
+	// sweep, with the same design as every other worker
+	if(sweep) delete sweep;
+	sweep = new Sweep(f.runSettings(), BatchSimulation());
+	f.runSettings()->QueryIntAttribute("UNIT_POINTS", &unitPoints);
+	f.runSettings()->QueryIntAttribute("UNITS", &nUnits);
+	if(sweep->check() != "" || unitPoints < 1) return false;
+	sweep->runSeed = sweep->seed;
+	sweep->makeDesign();
+	if(sweep->batch.templateSociety) delete sweep->batch.templateSociety;
+	sweep->batch.templateSociety = new Society(*curSociety);
+
+	// rates are counted from here
+	throughput.start(sweep->nPoints);
+	report(0);
+	lastReport = time(0);
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int SweepSpool::claim(void) {
+	// units of workers that died are run again once there is nothing else to do
+	t_int unit = takeUnit();
+	if(unit < 0 && requeue() > 0) unit = takeUnit();
+	return unit;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int SweepSpool::takeUnit(void) {
+	string todo = dir + "/todo/";
+	dirent** list;
+	t_int n = fl_filename_list(todo.c_str(), &list);
+	t_int unit = -1;
+
+	// the first unit no other worker has taken first
+	for(t_int i = 0; i < n && unit < 0; ++i) {
+		const char* name = list[i]->d_name;
+		if(strncmp(name, "unit", 4)) continue;
+		t_int u = atoi(name + 4);
+		if(rename((todo + name).c_str(), (dir + "/claimed/" + claimName(u)).c_str()) != 0) continue;
+
+		// a unit put back may still have been finished by the worker that was thought dead
+		FILE* f = fopen((dir + "/done/" + unitName(u)).c_str(), "rb");
+		if(f) {
+			fclose(f);
+			remove((dir + "/claimed/" + claimName(u)).c_str());
+			continue;
+		}
+		unit = u;
+		renewClaim(unit);
+	}
+	if(n > 0) fl_filename_free_list(&list, n);
+	return unit;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void SweepSpool::renewClaim(t_int unit) {
+	// write the time in the claim, which only updates it if it is still there
+	FILE* f = fopen((dir + "/claimed/" + claimName(unit)).c_str(), "r+");
+	if(f) {
+		fprintf(f, "%ld\n", (long)time(0));
+		fclose(f);
+	}
+	lastRenewal = time(0);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int SweepSpool::requeue(void) {
+	string claimed = dir + "/claimed/";
+	dirent** list;
+	t_int n = fl_filename_list(claimed.c_str(), &list);
+	t_int nRequeued = 0;
+	time_t now = time(0);
+
+	// claims of other workers that haven't been renewed in time go back without the worker's id - only one worker
+	// can move each
+	for(t_int i = 0; i < n; ++i) {
+		const char* name = list[i]->d_name;
+		const char* dot = strchr(name, '.');
+		if(strncmp(name, "unit", 4) || !dot || id == dot + 1) continue;
+		struct stat st;
+		if(stat((claimed + name).c_str(), &st) != 0 || now - st.st_mtime < SWEEP_CLAIM_TIMEOUT) continue;
+		if(rename((claimed + name).c_str(), (dir + "/todo/" + string(name, dot - name)).c_str()) == 0) ++nRequeued;
+	}
+	if(n > 0) fl_filename_free_list(&list, n);
+	return nRequeued;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int SweepSpool::claimsHeld(void) {
+	dirent** list;
+	t_int n = fl_filename_list((dir + "/claimed/").c_str(), &list);
+	t_int held = 0;
+	for(t_int i = 0; i < n; ++i) if(!strncmp(list[i]->d_name, "unit", 4)) ++held;
+	if(n > 0) fl_filename_free_list(&list, n);
+	return held;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool SweepSpool::runUnit(t_int unit) {
+	// run the points of the unit on all cores
+	t_int first = unit * unitPoints;
+	t_int n = first + unitPoints > sweep->nPoints ? sweep->nPoints - first : unitPoints;
+	if(n < 1) return false;
+	vector<BatchSimulation*> batches(n, (BatchSimulation*)0);
+	batchScheduler.start(n, [this, first](t_int i) { return sweep->makeBatch(first + i); });
+	for(t_int got = 0; got < n;) {
+		BatchSimulation* bs;
+		t_int i = batchScheduler.takeFinished(bs);
+		if(i >= 0) {
+			batches[i] = bs;
+			++got;
+		}
+		else this_thread::sleep_for(chrono::duration<double>(SWEEP_POLL_INTERVAL));
+		if(time(0) - lastReport >= THROUGHPUT_REPORT_INTERVAL) report(got);
+		if(time(0) - lastRenewal >= SWEEP_CLAIM_RENEWAL) renewClaim(unit);
+	}
+	batchScheduler.stop();
+
+	// statistics of every point, put in place once they are all written
+	TiXmlElement* xml = new TiXmlElement("UNIT");
+	xml->SetAttribute("INDEX", unit);
+	xml->SetAttribute("POINTS", n);
+	CheckpointFile f;
+	f.create((dir + "/done/" + unitName(unit)).c_str(), CHECKPOINT_SWEEP_UNIT, xml, 0);
+	for(t_int i = 0; i < n; ++i) {
+		f.putInt(first + i);
+		f.putInt(batches[i]->nTrialsRun);
+		batches[i]->stats.saveCheckpoint(f);
+		delete batches[i];
+	}
+	if(!f.commit()) return false;
+	remove((dir + "/claimed/" + claimName(unit)).c_str());
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void SweepSpool::report(t_int pointsDone) {
+	// points of this unit that are done, & of every unit any worker has finished
+	pointsDone += unitsDone() * unitPoints;
+	if(pointsDone > sweep->nPoints) pointsDone = sweep->nPoints;
+	long long trials, inquirerSteps, linkVisits;
+	batchScheduler.workDone(trials, inquirerSteps, linkVisits);
+	if(!throughput.update(pointsDone, trials, inquirerSteps, linkVisits)) return;
+	fprintf(stderr, "%s: %d / %d points   %s\n", dir.c_str(), pointsDone, sweep->nPoints, throughput.describe().c_str());
+	lastReport = time(0);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int SweepSpool::unitsDone(void) {
+	dirent** list;
+	t_int n = fl_filename_list((dir + "/done/").c_str(), &list);
+	t_int done = 0;
+
+	// results still being written have an extension
+	for(t_int i = 0; i < n; ++i) if(!strncmp(list[i]->d_name, "unit", 4) && !strchr(list[i]->d_name, '.')) ++done;
+	if(n > 0) fl_filename_free_list(&list, n);
+	return done;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool SweepSpool::claimMerge(void) {
+	return rename((dir + "/merge").c_str(), (dir + "/merge." + id).c_str()) == 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool SweepSpool::merge(void) {
+	if(unitsDone() < nUnits || !sweep->openResults((dir + "/results.txt").c_str())) return false;
+
+	// units are in order of their points, so lines can be written as they are read
+	for(t_int unit = 0; unit < nUnits; ++unit) {
+		CheckpointFile f;
+		t_int n = 0;
+		if(!f.open((dir + "/done/" + unitName(unit)).c_str()) || f.kind != CHECKPOINT_SWEEP_UNIT) n = -1;
+		else f.runSettings()->QueryIntAttribute("POINTS", &n);
+		for(t_int i = 0; i < n && f.good(); ++i) {
+			BatchStatistics s;
+			t_int point = f.getInt();
+			t_int nTrialsRun = f.getInt();
+			s.loadCheckpoint(f);
+			if(f.good()) sweep->writeResults(point, s, nTrialsRun);
+		}
+		if(n < 0 || !f.good()) {
+			sweep->finish();
+			return false;
+		}
+	}
+	sweep->finish();
+	sweep->saveManifest();
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int RunSweepWorker(const char* dir) {
+	SweepSpool spool(dir);
+	if(!spool.open()) {
+		fprintf(stderr, "%s is not a sweep spool made by this version of Laputa.\n", dir);
+		return 1;
+	}
+
+	// take units until there are none left, waiting while other workers hold claims, in case they die
+	while(spool.unitsDone() < spool.nUnits) {
+		t_int unit = spool.claim();
+		if(unit < 0) {
+			if(!spool.claimsHeld()) break;
+			this_thread::sleep_for(chrono::seconds(SWEEP_CLAIM_RENEWAL));
+		}
+		else if(!spool.runUnit(unit)) {
+			fprintf(stderr, "Could not write the results of unit %d to %s.\n", unit, dir);
+			return 1;
+		}
+	}
+
+	// the last worker to finish puts the results together
+	if(spool.unitsDone() == spool.nUnits && spool.claimMerge() && !spool.merge()) {
+		fprintf(stderr, "Could not merge the results in %s.\n", dir);
+		return 1;
+	}
+	return 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int MergeSweepSpool(const char* dir) {
+	SweepSpool spool(dir);
+	if(!spool.open()) {
+		fprintf(stderr, "%s is not a sweep spool made by this version of Laputa.\n", dir);
+		return 1;
+	}
+	t_int done = spool.unitsDone();
+	if(done < spool.nUnits) {
+		fprintf(stderr, "Only %d of %d units in %s are done.\n", done, spool.nUnits, dir);
+		return 1;
+	}
+	if(!spool.merge()) {
+		fprintf(stderr, "Could not merge the results in %s.\n", dir);
+		return 1;
+	}
+	return 0;
+}
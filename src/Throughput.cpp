@@ -0,0 +1,116 @@
+#include "Throughput.h"
+#include <stdio.h>
+#ifdef _WINDOWS
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+#endif
+
+using namespace std::chrono;
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void ThroughputMonitor::start(long long totalUnits) {
+	total = totalUnits;
+	startTime = steady_clock::now();
+	samples.clear();
+	inquirerStepsPerSecond = linkVisitsPerSecond = trialsPerSecond = 0;
+	secondsLeft = -1;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool ThroughputMonitor::update(long long unitsDone, long long trials, long long inquirerSteps, long long linkVisits) {
+	// the first sample is where the run is counted from, which needn't be from nothing if it was resumed
+	double t = duration<double>(steady_clock::now() - startTime).count();
+	if(!samples.empty() && t - samples.back().t < THROUGHPUT_SAMPLE_INTERVAL) return false;
+	Sample s = {t, unitsDone, trials, inquirerSteps, linkVisits};
+	samples.push_back(s);
+	if(samples.size() == 1) return false;
+
+	// rates over the window, keeping the first sample so that units that take longer than that can still be timed
+	while(samples.size() > 2 && t - samples[1].t > THROUGHPUT_WINDOW) samples.erase(samples.begin() + 1);
+	const Sample& w = samples.size() > 2 && t - samples[0].t > THROUGHPUT_WINDOW ? samples[1] : samples[0];
+	double dt = t - w.t;
+	inquirerStepsPerSecond = (double)(inquirerSteps - w.inquirerSteps) / dt;
+	linkVisitsPerSecond = (double)(linkVisits - w.linkVisits) / dt;
+	trialsPerSecond = (double)(trials - w.trials) / dt;
+
+	// time left, from units done lately, or since the start if none were done lately
+	double unitsPerSecond = unitsDone > w.units ? (double)(unitsDone - w.units) / dt : (double)(unitsDone - samples[0].units) / (t - samples[0].t);
+	secondsLeft = unitsPerSecond > 0 ? (double)(total - unitsDone) / unitsPerSecond : -1;
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+// a number with a suffix for thousands, millions, ...
+static string ShortNumber(double v) {
+	const char* suffix[] = {"", "k", "M", "G", "T"};
+	t_int i = 0;
+	while(v >= 1000.0 && i < 4) {
+		v /= 1000.0;
+		++i;
+	}
+	char s[32];
+	sprintf(s, v < 10.0 && i > 0 ? "%.1f%s" : "%.0f%s", v, suffix[i]);
+	return string(s);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+string ThroughputMonitor::describe(void) const {
+	char eta[32];
+	if(secondsLeft < 0) sprintf(eta, "-");
+	else {
+		long long s = (long long)(secondsLeft + 0.5);
+		if(s >= 3600) sprintf(eta, "%lld:%02lld:%02lld", s / 3600, (s / 60) % 60, s % 60);
+		else sprintf(eta, "%lld:%02lld", s / 60, s % 60);
+	}
+
+	char line[256];
+	sprintf(line, "%s inquirer-steps/s   %s link-visits/s   %.1f trials/s   ETA %s   Memory %lld MB", ShortNumber(inquirerStepsPerSecond).c_str(),
+		ShortNumber(linkVisitsPerSecond).c_str(), trialsPerSecond, eta, CurrentMemoryUse() >> 20);
+	return string(line);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+long long CurrentMemoryUse(void) {
+#ifdef _WINDOWS
+	PROCESS_MEMORY_COUNTERS pmc;
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return (long long)pmc.WorkingSetSize;
+	return 0;
+#elif defined(__APPLE__)
+	mach_task_basic_info info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS) return (long long)info.resident_size;
+	return 0;
+#else
+	// resident pages are the second number
+	long long pages = 0, resident = 0;
+	FILE* f = fopen("/proc/self/statm", "r");
+	if(!f) return 0;
+	if(fscanf(f, "%lld %lld", &pages, &resident) != 2) resident = 0;
+	fclose(f);
+	return resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+long long PhysicalMemory(void) {
+#ifdef _WINDOWS
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	if(GlobalMemoryStatusEx(&status)) return (long long)status.ullTotalPhys;
+	return 0;
+#else
+	long long pages = sysconf(_SC_PHYS_PAGES), size = sysconf(_SC_PAGESIZE);
+	return pages > 0 && size > 0 ? pages * size : 0;
+#endif
+}
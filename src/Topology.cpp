@@ -13,8 +13,8 @@ NetworkTopology::NetworkTopology(Society* s) {
 
 //-----------------------------------------------------------------------------------------------------------------------
 
-string NetworkTopology::description(float minListenChance, t_int weights) {
-	
+void NetworkTopology::write(FileWriter& w, float minListenChance, t_int weights) const {
+
 	// get boundary
 	t_float xMin = INFINITY, yMin = INFINITY, xMax = -INFINITY, yMax = -INFINITY;
 	for (t_int i = 0; i < nodes.size(); ++i) {
@@ -28,22 +28,204 @@ string NetworkTopology::description(float minListenChance, t_int weights) {
 	t_float dx = (xMax - xMin) / .9, dy = (yMax - yMin) / .9;
 
 	// vertices
-	string s = string("*Vertices ") + string(IntToString(nodes.size())) + string("\r\n");
+	w.put("*Vertices ");
+	w.putInt(nodes.size());
+	w.newLine();
 	for (t_int i = 0; i < nodes.size(); ++i) {
-		s += string(IntToString(i + 1)) + " \"" + IntToString(i + 1) + "\" " + DoubleToString((nodes[i].x - xMin) / dx + .05, 3);
-		s += string(" ") + DoubleToString((nodes[i].y - yMin) / dy + .05, 3) + "\r\n";
+		w.putInt(i + 1);
+		w.put(" \"");
+		w.putInt(i + 1);
+		w.put("\" ");
+		w.putFloat((nodes[i].x - xMin) / dx + .05, 3);
+		w.put(' ');
+		w.putFloat((nodes[i].y - yMin) / dy + .05, 3);
+		w.newLine();
 	}
 
 	// edges
-	s += string("*Arcs ") + string(IntToString(edges.size())) + string("\r\n");
+	w.put("*Arcs ");
+	w.putInt(edges.size());
+	w.newLine();
 	for (t_int i = 0; i < edges.size(); ++i) {
 		if (edges[i].listenChance > minListenChance) {
-			s += string(IntToString(edges[i].src)) + string(" ") + string(IntToString(edges[i].dst)) + string(" ");
-			if (weights == WTS_NONE) s += string("1.0") + string("\r\n");
-			else if (weights == WTS_LISTEN_CHANCE) s += string(DoubleToString(edges[i].listenChance, 3)) + string("\r\n");
-			else if (weights == WTS_TRUST) s += string(DoubleToString(edges[i].expTrust, 3)) + string("\r\n");
+			w.putInt(edges[i].src);
+			w.put(' ');
+			w.putInt(edges[i].dst);
+			w.put(' ');
+			if (weights == WTS_NONE) w.put("1.0");
+			else if (weights == WTS_LISTEN_CHANCE) w.putFloat(edges[i].listenChance, 3);
+			else if (weights == WTS_TRUST) w.putFloat(edges[i].expTrust, 3);
+			w.newLine();
 		}
 	}
-	
-	return s;
-}
\ No newline at end of file
+}
+//-----------------------------------------------------------------------------------------------------------------------
+
+static unsigned long long HashBytes(const void* data, size_t n, unsigned long long h = 14695981039346656037ULL) {
+	// FNV-1a
+	const unsigned char* p = (const unsigned char*)data;
+	for (size_t i = 0; i < n; ++i) {
+		h ^= p[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+static void PutVarint(vector<unsigned char>& v, unsigned t_int n) {
+	while (n >= 0x80) {
+		v.push_back((unsigned char)(n | 0x80));
+		n >>= 7;
+	}
+	v.push_back((unsigned char)n);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+static unsigned t_int GetVarint(const unsigned char*& p) {
+	unsigned t_int n = 0;
+	for (t_int shift = 0; ; shift += 7) {
+		n |= (unsigned t_int)(*p & 0x7F) << shift;
+		if (!(*p++ & 0x80)) break;
+	}
+	return n;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void TopologyStore::clear(void) {
+	structures.clear();
+	weights.clear();
+	records.clear();
+	structureIndex.clear();
+	weightsIndex.clear();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void TopologyStore::add(Society* s) {
+	TopologyStructure ts;
+	TopologyWeights tw;
+
+	// node positions
+	ts.positions.reserve(s->people.size() * 2);
+	for (t_int i = 0; i < s->people.size(); ++i) {
+		ts.positions.push_back(s->people[i].x);
+		ts.positions.push_back(s->people[i].y);
+	}
+
+	// links are ordered by target, then source, so store the target as a delta and the source as a delta within the same target
+	ts.nArcs = s->links.size();
+	ts.arcs.reserve(ts.nArcs * 2);
+	tw.listenChance.reserve(ts.nArcs);
+	tw.expTrust.reserve(ts.nArcs);
+	t_int prevSrc = 0, prevDst = 0;
+	for (LinkIterator l = s->links.begin(); l != s->links.end(); ++l) {
+		t_int src = l->second.source, dst = l->second.target;
+		PutVarint(ts.arcs, dst - prevDst);
+		PutVarint(ts.arcs, dst == prevDst ? src - prevSrc : src);
+		prevSrc = src;
+		prevDst = dst;
+		tw.listenChance.push_back(l->second.listenChance + 1);
+		tw.expTrust.push_back(l->second.trust.expectation());
+	}
+
+	records.push_back(pair<t_int, t_int>(findOrAddStructure(ts), findOrAddWeights(tw)));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int TopologyStore::findOrAddStructure(TopologyStructure& ts) {
+	ts.hash = HashBytes(ts.positions.data(), ts.positions.size() * sizeof(float));
+	ts.hash = HashBytes(ts.arcs.data(), ts.arcs.size(), ts.hash);
+
+	// look for an identical structure
+	pair<multimap<unsigned long long, t_int>::iterator, multimap<unsigned long long, t_int>::iterator> r = structureIndex.equal_range(ts.hash);
+	for (multimap<unsigned long long, t_int>::iterator i = r.first; i != r.second; ++i) if (structures[i->second] == ts) return i->second;
+
+	// new structure
+	structures.push_back(ts);
+	structureIndex.insert(pair<unsigned long long, t_int>(ts.hash, structures.size() - 1));
+	return structures.size() - 1;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+t_int TopologyStore::findOrAddWeights(TopologyWeights& tw) {
+	tw.hash = HashBytes(tw.listenChance.data(), tw.listenChance.size() * sizeof(float));
+	tw.hash = HashBytes(tw.expTrust.data(), tw.expTrust.size() * sizeof(float), tw.hash);
+
+	// look for identical weights
+	pair<multimap<unsigned long long, t_int>::iterator, multimap<unsigned long long, t_int>::iterator> r = weightsIndex.equal_range(tw.hash);
+	for (multimap<unsigned long long, t_int>::iterator i = r.first; i != r.second; ++i) if (weights[i->second] == tw) return i->second;
+
+	// new weights
+	weights.push_back(tw);
+	weightsIndex.insert(pair<unsigned long long, t_int>(tw.hash, weights.size() - 1));
+	return weights.size() - 1;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+NetworkTopology TopologyStore::topology(t_int i) const {
+	const TopologyStructure& ts = structures[records[i].first];
+	const TopologyWeights& tw = weights[records[i].second];
+	NetworkTopology top;
+
+	// nodes
+	top.nodes.reserve(ts.positions.size() / 2);
+	for (t_int j = 0; j < ts.positions.size(); j += 2) top.nodes.push_back(NetworkNode(ts.positions[j], ts.positions[j + 1]));
+
+	// decode edges
+	top.edges.reserve(ts.nArcs);
+	const unsigned char* p = ts.arcs.data();
+	t_int src = 0, dst = 0;
+	for (t_int j = 0; j < ts.nArcs; ++j) {
+		t_int dDst = GetVarint(p), s = GetVarint(p);
+		dst += dDst;
+		src = dDst ? s : src + s;
+		top.edges.push_back(NetworkEdge(src + 1, dst + 1, tw.listenChance[j], tw.expTrust[j]));
+	}
+	return top;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void TopologyStore::saveCheckpoint(CheckpointFile& f) const {
+	f.putInt(structures.size());
+	for (t_int i = 0; i < structures.size(); ++i) {
+		f.putVector(structures[i].positions);
+		f.putVector(structures[i].arcs);
+		f.putInt(structures[i].nArcs);
+	}
+	f.putInt(weights.size());
+	for (t_int i = 0; i < weights.size(); ++i) {
+		f.putVector(weights[i].listenChance);
+		f.putVector(weights[i].expTrust);
+	}
+	f.putVector(records);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void TopologyStore::loadCheckpoint(CheckpointFile& f) {
+	// the indices are made again as things are added
+	clear();
+	t_int n = f.getInt();
+	for (t_int i = 0; i < n && f.good(); ++i) {
+		TopologyStructure ts;
+		f.getVector(ts.positions);
+		f.getVector(ts.arcs);
+		ts.nArcs = f.getInt();
+		findOrAddStructure(ts);
+	}
+	n = f.getInt();
+	for (t_int i = 0; i < n && f.good(); ++i) {
+		TopologyWeights tw;
+		f.getVector(tw.listenChance);
+		f.getVector(tw.expTrust);
+		findOrAddWeights(tw);
+	}
+	f.getVector(records);
+}
@@ -1,5 +1,6 @@
 #include "Trust.h"
 #include "App.h"
+#include "Profiler.h"
 #include <FL/fl_draw.H>
 #include <cmath>
 #include <immintrin.h>
@@ -128,13 +129,14 @@ float TrustFunction::expectation(void) {
 #ifdef __APPLE__
 	static float r0vec[TRUST_FUNCTION_RESOLUTION] __attribute__((aligned(16)));
 #endif
-	static bool firstTime = true;
 
-	if(firstTime) {
-		// fill out vector of r0 values
+	// fill out vector of r0 values the first time through. Done as a static initialiser, since inquirers may be
+	// handled by several threads at once.
+	static const bool r0Filled = []() {
 		for(t_int i = 0; i < TRUST_FUNCTION_RESOLUTION; ++i) r0vec[i] = i * TRUST_FUNCTION_RESOLUTION_INV;
-		firstTime = false;
-	}
+		return true;
+	}();
+	(void)r0Filled;
 
 	if(!expValid) {
 		// init values
@@ -215,6 +217,7 @@ float TrustFunction::expectation(void) {
 #ifdef __AVX__
 void TrustFunction::update(float belief, bool pTrue) {
 	__m128 beliefVec, beliefVecInv, r, rInv, dr, vTotalVec, v1, v2, v3;
+	PROFILE_COUNT(PROFILE_TRUST_UPDATES, 1);
 #ifdef _WINDOWS
 	__declspec(align(16)) static const float rVec[4] = {0, TRUST_FUNCTION_RESOLUTION_INV, 2 * TRUST_FUNCTION_RESOLUTION_INV, 3 * TRUST_FUNCTION_RESOLUTION_INV};
 	__declspec(align(16)) static const float rVecInv[4] = {1.0 , 1.0 - TRUST_FUNCTION_RESOLUTION_INV, 1.0 - 2 * TRUST_FUNCTION_RESOLUTION_INV, 1.0 - 3 * TRUST_FUNCTION_RESOLUTION_INV};
@@ -293,6 +296,7 @@ void TrustFunction::update(float belief, bool pTrue) {
 // C++ version of the same code
 void TrustFunction::update(float belief, bool pTrue) {
 	float negBelief = 1.0 - belief, r, dr;
+	PROFILE_COUNT(PROFILE_TRUST_UPDATES, 1);
 
 	if(pTrue) {
 		r = 0;
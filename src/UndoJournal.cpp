@@ -0,0 +1,226 @@
+#include "UndoJournal.h"
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void UndoJournal::clear(void) {
+	for (t_int i = 0; i < steps.size(); ++i) delete steps[i];
+	steps.clear();
+	cur = 0;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void UndoJournal::reset(const Society& s) {
+	clear();
+	state = s;
+	forget(s);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void UndoJournal::forget(const Society& s) {
+	// the journal is in step with the society, with nothing noted
+	generation = s.generation;
+	touchedPeople.clear();
+	touchedLinks.clear();
+	untracked = false;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void UndoJournal::touchInquirer(const Society& s, t_int i) {
+	if (s.generation != generation) untracked = true;
+	touchedPeople.insert(i);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void UndoJournal::touchInquirers(const Society& s, const set<t_int>& inqs) {
+	for (set<t_int>::const_iterator i = inqs.begin(); i != inqs.end(); ++i) touchInquirer(s, *i);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void UndoJournal::touchLink(const Society& s, t_int source, t_int target) {
+	touchInquirer(s, source);
+	touchInquirer(s, target);
+	touchedLinks.insert(COUPLE(source, target));
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void UndoJournal::touchLinks(const Society& s, const set<pair<t_int, t_int> >& lnks) {
+	for (set<pair<t_int, t_int> >::const_iterator l = lnks.begin(); l != lnks.end(); ++l) touchedLinks.insert(COUPLE(l->first, l->second));
+	if (s.generation != generation) untracked = true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+bool UndoJournal::record(const Society& s) {
+	UndoStep* step = new UndoStep;
+	step->nPeople = state.people.size();
+	if (untracked || (touchedPeople.empty() && touchedLinks.empty())) compareAll(s, step);
+	else compareTouched(s, step);
+	forget(s);
+
+	// has an actual change occurred?
+	if (step->people.empty() && step->links.empty() && step->absentLinks.empty() && step->nPeople == s.people.size()) {
+		delete step;
+		return false;
+	}
+
+	t_int nChanges = step->people.size() + step->links.size() + step->absentLinks.size();
+	if (nChanges > UNDO_CHECKPOINT_FRACTION * (s.people.size() + s.links.size())) {
+		// most of the society changed, so keep the whole previous state instead
+		step->people.clear();
+		step->links.clear();
+		step->absentLinks.clear();
+		step->checkpoint = new Society(state);
+		state = s;
+	}
+	else {
+		// bring our state up to date with the changes only
+		t_int nOld = state.people.size();
+		state.people.resize(s.people.size());
+		for (t_int i = 0; i < step->people.size(); ++i) if (step->people[i].first < s.people.size()) state.people[step->people[i].first] = s.people[step->people[i].first];
+		for (t_int i = nOld; i < s.people.size(); ++i) state.people[i] = s.people[i];
+		for (t_int i = 0; i < step->links.size(); ++i) {
+			ConstLinkIterator l = s.links.find(step->links[i].first);
+			if (l != s.links.end()) state.links[l->first] = l->second;
+			else state.links.erase(step->links[i].first);
+		}
+		for (t_int i = 0; i < step->absentLinks.size(); ++i) state.links[step->absentLinks[i]] = s.links.find(step->absentLinks[i])->second;
+	}
+
+	// forget any edits after this one
+	for (t_int i = cur; i < steps.size(); ++i) delete steps[i];
+	steps.resize(cur);
+
+	// add to list, dropping the oldest edit if it is full
+	steps.push_back(step);
+	++cur;
+	if (steps.size() > MAX_UNDOS) {
+		delete steps.front();
+		steps.pop_front();
+		--cur;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void UndoJournal::undo(Society& s) {
+	if (!canUndo()) return;
+	--cur;
+	apply(steps[cur], s);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void UndoJournal::redo(Society& s) {
+	if (!canRedo()) return;
+	apply(steps[cur], s);
+	++cur;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void UndoJournal::apply(UndoStep* step, Society& s) {
+	if (step->checkpoint) {
+		// exchange whole states
+		s = *step->checkpoint;
+		*step->checkpoint = state;
+		state = s;
+		forget(s);
+		return;
+	}
+
+	// the society may have been changed without being recorded, e.g. by running a simulation
+	if (s.generation != generation) s = state;
+
+	// values to put in the step afterwards, so it can take us back again
+	UndoStep other;
+	other.nPeople = state.people.size();
+
+	// inquirers
+	for (t_int i = step->nPeople; i < state.people.size(); ++i) other.people.push_back(pair<t_int, Inquirer>(i, state.people[i]));
+	for (t_int i = 0; i < step->people.size(); ++i)
+		if (step->people[i].first < state.people.size()) other.people.push_back(pair<t_int, Inquirer>(step->people[i].first, state.people[step->people[i].first]));
+	state.people.resize(step->nPeople);
+	s.people.resize(step->nPeople);
+	for (t_int i = 0; i < step->people.size(); ++i) {
+		state.people[step->people[i].first] = step->people[i].second;
+		s.people[step->people[i].first] = step->people[i].second;
+	}
+
+	// links
+	for (t_int i = 0; i < step->absentLinks.size(); ++i) {
+		LinkIterator l = state.links.find(step->absentLinks[i]);
+		other.links.push_back(pair<unsigned t_int, Link>(l->first, l->second));
+		state.links.erase(l);
+		s.links.erase(step->absentLinks[i]);
+	}
+	for (t_int i = 0; i < step->links.size(); ++i) {
+		LinkIterator l = state.links.find(step->links[i].first);
+		if (l != state.links.end()) {
+			other.links.push_back(pair<unsigned t_int, Link>(l->first, l->second));
+			l->second = step->links[i].second;
+		}
+		else {
+			other.absentLinks.push_back(step->links[i].first);
+			state.links[step->links[i].first] = step->links[i].second;
+		}
+		s.links[step->links[i].first] = step->links[i].second;
+	}
+	s.newGeneration();
+	forget(s);
+
+	// reverse the step
+	step->nPeople = other.nPeople;
+	step->people.swap(other.people);
+	step->links.swap(other.links);
+	step->absentLinks.swap(other.absentLinks);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void UndoJournal::compareAll(const Society& s, UndoStep* step) {
+	// changed & removed inquirers
+	for (t_int i = 0; i < state.people.size(); ++i)
+		if (i >= s.people.size() || state.people[i] != s.people[i]) step->people.push_back(pair<t_int, Inquirer>(i, state.people[i]));
+
+	// changed, removed & added links - both maps are ordered by key, so walk through them together
+	ConstLinkIterator a = state.links.begin(), b = s.links.begin();
+	while (a != state.links.end() || b != s.links.end()) {
+		if (b == s.links.end() || (a != state.links.end() && a->first < b->first)) {
+			step->links.push_back(pair<unsigned t_int, Link>(a->first, a->second));
+			++a;
+		}
+		else if (a == state.links.end() || b->first < a->first) {
+			step->absentLinks.push_back(b->first);
+			++b;
+		}
+		else {
+			if (a->second != b->second) step->links.push_back(pair<unsigned t_int, Link>(a->first, a->second));
+			++a;
+			++b;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void UndoJournal::compareTouched(const Society& s, UndoStep* step) {
+	// changed inquirers that were noted, and any that were removed
+	for (set<t_int>::iterator i = touchedPeople.begin(); i != touchedPeople.end(); ++i)
+		if (*i < state.people.size() && *i < s.people.size() && state.people[*i] != s.people[*i]) step->people.push_back(pair<t_int, Inquirer>(*i, state.people[*i]));
+	for (t_int i = s.people.size(); i < state.people.size(); ++i) step->people.push_back(pair<t_int, Inquirer>(i, state.people[i]));
+
+	// changed, removed & added links that were noted
+	for (set<unsigned t_int>::iterator k = touchedLinks.begin(); k != touchedLinks.end(); ++k) {
+		ConstLinkIterator a = state.links.find(*k), b = s.links.find(*k);
+		if (a != state.links.end() && (b == s.links.end() || a->second != b->second)) step->links.push_back(pair<unsigned t_int, Link>(a->first, a->second));
+		else if (a == state.links.end() && b != s.links.end()) step->absentLinks.push_back(*k);
+	}
+}
+
@@ -4,7 +4,11 @@
 #include "tinyxml.h"
 #include <gsl/gsl_math.h>
 #include "Utility.h"
+#include "Profiler.h"
+#include "BatchEstimate.h"
 #include <FL/Fl.H>
+#include <thread>
+#include <atomic>
 
 #define INDEX_FILE "index.htm"
 
@@ -186,6 +190,8 @@ void DialogFactory::showDialog(t_int d, const void *data) {
 		societyWindow->view->deselectAll();
 		progressWindow->bs = (BatchSimulation*)data;
 		progressWindow->barProgress->value(0);
+		progressWindow->throughput.start(progressWindow->bs->nTrials);
+		progressWindow->boxThroughput->copy_label("");
 		progressWindow->show();
 		break;
 
@@ -256,14 +262,30 @@ void DialogFactory::showDialog(t_int d, const void *data) {
 		societyWindow->view->deselectAll();
 		doubleProgressWindow->mb = (MultiBatch*)data;
 		doubleProgressWindow->barProgress->value(0);
+		doubleProgressWindow->throughput.start(doubleProgressWindow->mb->points.size());
+		doubleProgressWindow->boxThroughput->copy_label("");
 		{
-			char str[48] = "1 / ";
+			char str[48] = "0 / ";
 			strcat(str, IntToString(doubleProgressWindow->mb->stepsAtoB * doubleProgressWindow->mb->stepsAtoC));
 			doubleProgressWindow->outputSecondProgress->value(str);
 		}
 		doubleProgressWindow->show();
 		break;
 
+	case DIALOG_SWEEP_PROGRESS:
+		societyWindow->view->deselectAll();
+		doubleProgressWindow->sweep = (Sweep*)data;
+		doubleProgressWindow->barProgress->value(0);
+		doubleProgressWindow->throughput.start(doubleProgressWindow->sweep->nPoints);
+		doubleProgressWindow->boxThroughput->copy_label("");
+		{
+			char str[48] = "0 / ";
+			strcat(str, IntToString(doubleProgressWindow->sweep->nPoints));
+			doubleProgressWindow->outputSecondProgress->value(str);
+		}
+		doubleProgressWindow->show();
+		break;
+
 	case DIALOG_DEGREE_DISTRIBUTION:
         degreeDistributionWindow->configure((vector<t_float>*)data);
 		degreeDistributionWindow->show();
@@ -331,8 +353,8 @@ void DialogFactory::closeDialog(t_int d, bool ok) {
 		break;
 
 	case DIALOG_SIMULATION:
-		if(Fl::has_idle(RunSimulation, app->getCurSimulation())) {
-			Fl::remove_idle(RunSimulation, app->getCurSimulation());
+		if(SimulationRunning(app->getCurSimulation())) {
+			PauseSimulation(app->getCurSimulation());
 			simulationWindow->buttonStep->activate();
 			simulationWindow->buttonRun->activate();
 			simulationWindow->buttonPause->deactivate();
@@ -367,7 +389,29 @@ void DialogFactory::closeDialog(t_int d, bool ok) {
 				societyWindow->view->updateStatistics();
 				app->touchFile();
 			}
-			if(batchSimulationWindow->dialogForm == BS_FORM_SIMULATION) StartBatchSimulation(batchSimulationWindow->bsEdited);
+			if(batchSimulationWindow->dialogForm == BS_FORM_SIMULATION) {
+				// ask where to keep checkpoints, if they are wanted
+				BatchSimulation* bs = batchSimulationWindow->bsEdited;
+
+				// check that what it records fits in memory - trials are only timed when asked for in the record tab
+				BatchEstimate estimate;
+				estimate.estimate(*bs, true, 0);
+				if(!estimate.fits()) {
+					fl_message_font(FL_COURIER, FL_NORMAL_SIZE);
+					t_int r = fl_choice("%s", "Cancel", "Start", estimate.suggestion ? "Use Suggested" : 0, estimate.describe().c_str());
+					fl_message_font(FL_HELVETICA, FL_NORMAL_SIZE);
+					if(r == 0) break;
+					if(r == 2) estimate.applySuggestion(*bs);
+				}
+				if(bs->checkpoint) {
+					string filename = SaveFileDialog("Save Checkpoints As", "*.checkpoint", "Untitled.checkpoint");
+					if (filename == "") break;
+					char absName[FL_PATH_MAX];
+					fl_filename_absolute(absName, FL_PATH_MAX, filename.c_str());
+					bs->checkpointFile = absName;
+				}
+				StartBatchSimulation(bs);
+			}
 		}
 		break;
 
@@ -426,11 +470,13 @@ void DialogFactory::closeDialog(t_int d, bool ok) {
 
 	case DIALOG_DOUBLE_PROGRESS:
 		if(!ok) {
-			if(Fl::has_idle(MultiBatchProcess, doubleProgressWindow->mb)) Fl::remove_idle(MultiBatchProcess, doubleProgressWindow->mb);
-			*curSociety = *doubleProgressWindow->mb->curBatch.templateSociety;
+			Fl::remove_timeout(MultiBatchProcess, doubleProgressWindow->mb);
+			batchScheduler.stop();
 			if(doubleProgressWindow->mb) {
-				delete [] doubleProgressWindow->mb->values;
-				delete [] doubleProgressWindow->mb->titles;
+				// keep what is done, so that it can be resumed
+				if(doubleProgressWindow->mb->checkpoint) doubleProgressWindow->mb->saveCheckpoint();
+				doubleProgressWindow->mb->points.clear();
+				doubleProgressWindow->mb->cells.clear();
 			}
 			doubleProgressWindow->mb = 0;
 		}
@@ -438,6 +484,18 @@ void DialogFactory::closeDialog(t_int d, bool ok) {
 		if(ok) fl_alert("Metadistribution simulation complete. Results saved in file %s.", doubleProgressWindow->mb->filename);
 		break;
 
+	case DIALOG_SWEEP_PROGRESS:
+		if(!ok) {
+			// results so far are kept
+			Fl::remove_timeout(SweepProcess, doubleProgressWindow->sweep);
+			batchScheduler.stop();
+			doubleProgressWindow->sweep->finish();
+		}
+		doubleProgressWindow->hide();
+		if(ok) fl_alert("Sweep complete. Results saved in file %s.", doubleProgressWindow->sweep->filename);
+		doubleProgressWindow->sweep = 0;
+		break;
+
 	case DIALOG_DEGREE_DISTRIBUTION:
         degreeDistributionWindow->hide();
 		break;
@@ -735,7 +793,8 @@ void StatisticsWindow::fillOutStatistics(void) {
 	outputPolarisation->value(DoubleToString(bsShown->stats.totalPolarisation, 4));
 	outputPolarisationDelta->value(DoubleToString(bsShown->stats.totalPolarisationDelta, 4));
 	outputNumSteps->value(IntToString(bsShown->totalSteps()));
-	outputNumSocieties->value(IntToString(bsShown->nTrials));
+	outputNumSocieties->value(IntToString(bsShown->nTrialsRun));
+	outputSeed->value(IntToString(bsShown->runSeed));
 	outputMessagesSentTotal->value(DoubleToString(bsShown->stats.avgMessagesSentTotal, 2));
 	outputMessagesSentPerInquirer->value(DoubleToString(bsShown->stats.avgMessagesSentPerInquirer, 2));
 	outputInquiryResultsTotal->value(DoubleToString(bsShown->stats.avgInquiryResultsTotal, 2));
@@ -763,19 +822,75 @@ void StatisticsWindow::fillOutStatistics(void) {
 	}
 	if (bsShown->stats.recordTopologies) buttonExportTopologies->activate();
 	else buttonExportTopologies->deactivate();
+
+	// profile of the batch, in builds that make one
+	if(ProfileEnabled()) buttonProfile->show();
+	else buttonProfile->hide();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void StatisticsWindow::replayTrial(void) {
+	const char* answ = fl_input("Trial to replay (1 - %d):", "1", bsShown->nTrialsRun);
+	if(!answ) return;
+	t_int trial = atoi(answ);
+	if(trial < 1 || trial > bsShown->nTrialsRun) {
+		fl_alert("There is no trial %s in this batch simulation.", answ);
+		return;
+	}
+	closeDialog(true);
+
+	// make the society the trial started with, leaving the dice where the trial's simulation went on from - and plain
+	// again afterwards, since the dice are shared with everything else
+	Simulation* s = app->getCurSimulation();
+	PauseSimulation(s);
+	UseRandomGenerator(bsShown->sim.randomGenerator);
+	bsShown->seedTrial(trial - 1);
+	*curSociety = Society(&bsShown->setup[0], bsShown->templateSociety);
+	bsShown->seedSimulation(trial - 1);
+	SetAntithetic(rng, false);
+	app->touchFile();
+
+	// simulate it the same way, one step at a time with everything in the log
+	s->val = bsShown->sim.val;
+	s->beliefEngine = bsShown->sim.beliefEngine;
+	s->eventSampling = bsShown->sim.eventSampling;
+	s->timing = bsShown->sim.timing;
+	s->stepEngine = bsShown->sim.stepEngine;
+	s->randomGenerator = bsShown->sim.randomGenerator;
+	s->uniforms.clear();
+	s->logLevel = LOG_DETAILED;
+	s->reset();
+	s->setSimulationWindowFrom();
+	societyWindow->view->updateStatistics();
+	societyWindow->view->deselectAll();
+	societyWindow->view->redraw();
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
+void StatisticsWindow::showProfile(void) {
+	// columns line up in a fixed-width font
+	fl_message_font(FL_COURIER, FL_NORMAL_SIZE);
+	t_int r = fl_choice("%s", "Close", "Save...", 0, ProfileSummary().c_str());
+	fl_message_font(FL_HELVETICA, FL_NORMAL_SIZE);
+	if(r != 1) return;
+
+	string filename = SaveFileDialog("Save Profile As", "*.json", "Untitled.profile.json");
+	if(filename != "" && !SaveProfile(filename.c_str())) fl_alert("Could not save profile to %s.", filename.c_str());
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
 
 void StatisticsWindow::computeConfidences(t_float level) {
-	t_float confSize = gsl_cdf_tdist_Pinv((1.0 + level) / 2.0, bsShown->nTrials - 1);
-	t_float val = bsShown->stats.totalEValueS / sqrt((t_float)bsShown->nTrials) * confSize;
+	t_float confSize = gsl_cdf_tdist_Pinv((1.0 + level) / 2.0, bsShown->nTrialsRun - 1);
+	t_float val = bsShown->stats.totalEValueS / sqrt((t_float)bsShown->nTrialsRun) * confSize;
 	outputAvgEValueMargin->value(DoubleToString(val));
-	val = bsShown->stats.totalEValueDeltaS / sqrt((t_float)bsShown->nTrials) * confSize;
+	val = bsShown->stats.totalEValueDeltaS / sqrt((t_float)bsShown->nTrialsRun) * confSize;
 	outputEValueDeltaMargin->value(DoubleToString(val));
-	val = bsShown->stats.totalPolarisationS / sqrt((t_float)bsShown->nTrials) * confSize;
+	val = bsShown->stats.totalPolarisationS / sqrt((t_float)bsShown->nTrialsRun) * confSize;
 	outputPolarisationMargin->value(DoubleToString(val));
-	val = bsShown->stats.totalPolarisationDeltaS / sqrt((t_float)bsShown->nTrials) * confSize;
+	val = bsShown->stats.totalPolarisationDeltaS / sqrt((t_float)bsShown->nTrialsRun) * confSize;
 	outputPolarisationDeltaMargin->value(DoubleToString(val));
 }
 
@@ -889,6 +1004,22 @@ void MultiBatchWindow::configure(void) {
 		for(t_int i = 2; i < 8; ++i) multiBatchWindow->btnCopyBatch[i]->activate();
 	}
 
+	// random numbers
+	multiBatchWindow->btnCommonRandomNumbers->value(multiBatchWindow->mb.commonRandomNumbers);
+	multiBatchWindow->btnAntithetic->value(multiBatchWindow->mb.antithetic);
+
+	// refinement
+	multiBatchWindow->btnRefine->value(multiBatchWindow->mb.refine);
+	multiBatchWindow->inputRefineThreshold->value(multiBatchWindow->mb.refineThreshold);
+	multiBatchWindow->inputRefineBudget->value(multiBatchWindow->mb.refineBudget);
+	if(multiBatchWindow->mb.refine) {
+		multiBatchWindow->inputRefineThreshold->activate();
+		multiBatchWindow->inputRefineBudget->activate();
+	}
+	else {
+		multiBatchWindow->inputRefineThreshold->deactivate();
+		multiBatchWindow->inputRefineBudget->deactivate();
+	}
 }
 
 //-----------------------------------------------------------------------------------------------------------------------
@@ -900,6 +1031,16 @@ void MultiBatchWindow::showPreview(void) {
 
 //-----------------------------------------------------------------------------------------------------------------------
 
+void MultiBatchWindow::showEstimate(void) {
+	BatchEstimate estimate;
+	estimate.estimate(mb, ESTIMATE_CALIBRATION_TIME);
+	fl_message_font(FL_COURIER, FL_NORMAL_SIZE);
+	fl_message("%s", estimate.describe().c_str());
+	fl_message_font(FL_HELVETICA, FL_NORMAL_SIZE);
+}
+
+//-----------------------------------------------------------------------------------------------------------------------
+
 void MultiBatchWindow::loadMultibatch(void) {
   string filename = OpenFileDialog("Open Multibatch", "*.mbatch");
 
@@ -1194,6 +1335,7 @@ bool ExportStatisticsWindow::save(void) {
 			fl_alert("There was not memory enough to export in this format. Try exporting only a part of the data, averaging over some dimensions, or getting more memory.");
 			return false;
 		}
+		bs->saveManifest(relName);
 	}
 	else return false;
 
@@ -1391,17 +1533,23 @@ bool ExportTopologyWindow::exportToFile(char* filename) {
 	if (buttonWeightNone->value()) wts = WTS_NONE;
 	else if (buttonWeightListenChance->value()) wts = WTS_LISTEN_CHANCE;
 	else wts = WTS_TRUST;
+	float minListenChance = fieldMinListenChance->value();
 
 	if (bs) {
 		if (buttonSingleFile->value()) {
 			// write a single file
 			FILE *f = fopen(filename, "w");
+			if (!f) return false;
+			FileWriter w(f);
 
 			for (t_int i = 0; i < bs->stats.topologies.size(); ++i) {
-				string s = string("*Network NW") + string(IntToString(i + 1)) + string("\r\n");
-				s += bs->stats.topologies[i].description(fieldMinListenChance->value(), wts) + string("\r\n");
-				fwrite(s.c_str(), 1, strlen(s.c_str()), f);
+				w.put("*Network NW");
+				w.putInt(i + 1);
+				w.newLine();
+				bs->stats.topologies.write(i, w, minListenChance, wts);
+				w.newLine();
 			}
+			w.flush();
 			fclose(f);
 		}
 		else {
@@ -1413,23 +1561,37 @@ bool ExportTopologyWindow::exportToFile(char* filename) {
 			for (i = strlen(filename) - 1; i >= 0; --i) if (filename[i] == '/' || filename[i] == '\\') break;
 			file = string(filename + i + 1);
 
-			// write files
-			for (t_int i = 0; i < bs->stats.topologies.size(); ++i) {
-				string numberedFileName = dir + file + " " + IntToString(i + 1) + ".net";
-				MakePathNative(numberedFileName);
-				FILE *f = fopen(numberedFileName.c_str(), "w");
-				string top = bs->stats.topologies[i].description(fieldMinListenChance->value(), wts);
-				fwrite(top.c_str(), 1, strlen(top.c_str()), f);
-				fclose(f);
-			}
+			// write files, one network per thread at a time
+			const TopologyStore& topologies = bs->stats.topologies;
+			atomic<t_int> next(0);
+			auto writeFiles = [&]() {
+				for (t_int i = next++; i < topologies.size(); i = next++) {
+					string numberedFileName = dir + file + " " + to_string(i + 1) + ".net";
+					MakePathNative(numberedFileName);
+					FILE *f = fopen(numberedFileName.c_str(), "w");
+					if (!f) continue;
+					FileWriter w(f);
+					topologies.write(i, w, minListenChance, wts);
+					w.flush();
+					fclose(f);
+				}
+			};
+			t_int nThreads = thread::hardware_concurrency();
+			if (nThreads > topologies.size()) nThreads = topologies.size();
+			vector<thread> threads;
+			for (t_int i = 1; i < nThreads; ++i) threads.push_back(thread(writeFiles));
+			writeFiles();
+			for (t_int i = 0; i < threads.size(); ++i) threads[i].join();
 		}
 	}
 	else {
 		// save a single network in a single file
 		FILE *f = fopen(filename, "w");
+		if (!f) return false;
+		FileWriter w(f);
 		NetworkTopology top(curSociety);
-		string d = top.description(fieldMinListenChance->value(), wts);
-		fwrite(d.c_str(), 1, strlen(d.c_str()), f);
+		top.write(w, minListenChance, wts);
+		w.flush();
 		fclose(f);
 	}
 	return true;
@@ -1,4 +1,5 @@
 #include "App.h"
+#include "SweepSpool.h"
 #ifdef __APPLE__
 #include <unistd.h>
 #endif
@@ -72,6 +73,10 @@ int main(int argc, char* argv[]) {
 	// create society
 	curSociety = new Society();
 
+	// work on a sharded sweep, or merge its results, without opening any windows
+	if(argc == 3 && !strcmp(argv[1], "-worker")) return RunSweepWorker(argv[2]);
+	if(argc == 3 && !strcmp(argv[1], "-merge")) return MergeSweepSpool(argv[2]);
+
 	// create & run application object
 	app = new App(argc, argv, dataPath, docsPath);
 	return app->run();
@@ -121,6 +121,27 @@ void UserInterface::cb_Multibatch(Fl_Menu_* o, void* v) {
   ((UserInterface*)(o->parent()->user_data()))->cb_Multibatch_i(o,v);
 }
 
+void UserInterface::cb_Sweep_i(Fl_Menu_*, void*) {
+  app->runSweep();
+}
+void UserInterface::cb_Sweep(Fl_Menu_* o, void* v) {
+  ((UserInterface*)(o->parent()->user_data()))->cb_Sweep_i(o,v);
+}
+
+void UserInterface::cb_Shard_i(Fl_Menu_*, void*) {
+  app->shardSweep();
+}
+void UserInterface::cb_Shard(Fl_Menu_* o, void* v) {
+  ((UserInterface*)(o->parent()->user_data()))->cb_Shard_i(o,v);
+}
+
+void UserInterface::cb_Resume_i(Fl_Menu_*, void*) {
+  app->resumeRun();
+}
+void UserInterface::cb_Resume(Fl_Menu_* o, void* v) {
+  ((UserInterface*)(o->parent()->user_data()))->cb_Resume_i(o,v);
+}
+
 void UserInterface::cb_Generate_i(Fl_Menu_*, void*) {
   societyWindow->showDialog(DIALOG_BATCH_SIMULATION_GENERATE, &app->curBatchSimulation);
 }
@@ -206,6 +227,9 @@ Fl_Menu_Item UserInterface::menu_societyWindow[] = {
  {"Interactive...", 0x40069,  (Fl_Callback*)UserInterface::cb_Interactive, 0, 0, (uchar)FL_NORMAL_LABEL, 2, 14, 0},
  {"Batch...", 0x40062,  (Fl_Callback*)UserInterface::cb_Batch, 0, 0, (uchar)FL_NORMAL_LABEL, 2, 14, 0},
  {"Multibatch...", 0x4006d,  (Fl_Callback*)UserInterface::cb_Multibatch, 0, 0, (uchar)FL_NORMAL_LABEL, 2, 14, 0},
+ {"Sweep...", 0,  (Fl_Callback*)UserInterface::cb_Sweep, 0, 0, (uchar)FL_NORMAL_LABEL, 2, 14, 0},
+ {"Shard Sweep...", 0,  (Fl_Callback*)UserInterface::cb_Shard, 0, 0, (uchar)FL_NORMAL_LABEL, 2, 14, 0},
+ {"Resume...", 0,  (Fl_Callback*)UserInterface::cb_Resume, 0, 0, (uchar)FL_NORMAL_LABEL, 2, 14, 0},
  {0,0,0,0,0,0,0,0,0},
  {"Society", 0,  0, 0, 64, (uchar)FL_NORMAL_LABEL, 2, 14, 0},
  {"Generate Society...", 0,  (Fl_Callback*)UserInterface::cb_Generate, 0, 0, (uchar)FL_NORMAL_LABEL, 2, 14, 0},
@@ -569,8 +593,8 @@ void UserInterface::cb_1(Fl_Button* o, void* v) {
 }
 
 void UserInterface::cb_simulationWindow_i(Fl_Button*, void*) {
-  if(!Fl::has_idle(RunSimulation, app->getCurSimulation())) {
-	Fl::add_idle(RunSimulation, app->getCurSimulation());
+  if(!SimulationRunning(app->getCurSimulation())) {
+	StartSimulation(app->getCurSimulation());
 	simulationWindow->buttonPause->activate();
 	simulationWindow->buttonRun->deactivate();
 	simulationWindow->buttonStep->deactivate();
@@ -581,7 +605,7 @@ void UserInterface::cb_simulationWindow(Fl_Button* o, void* v) {
 }
 
 void UserInterface::cb_simulationWindow1_i(Fl_Button*, void*) {
-  if(!Fl::has_idle(RunSimulation, app->getCurSimulation())) {
+  if(!SimulationRunning(app->getCurSimulation())) {
 	app->getCurSimulation()->step();
 	app->getCurSimulation()->setSimulationWindowFrom();
 };
@@ -591,8 +615,8 @@ void UserInterface::cb_simulationWindow1(Fl_Button* o, void* v) {
 }
 
 void UserInterface::cb_simulationWindow2_i(Fl_Button*, void*) {
-  if(Fl::has_idle(RunSimulation, app->getCurSimulation())) {
-	Fl::remove_idle(RunSimulation, app->getCurSimulation());
+  if(SimulationRunning(app->getCurSimulation())) {
+	PauseSimulation(app->getCurSimulation());
 	simulationWindow->buttonPause->deactivate();
 	simulationWindow->buttonRun->activate();
 	simulationWindow->buttonStep->activate();
@@ -604,32 +628,28 @@ void UserInterface::cb_simulationWindow2(Fl_Button* o, void* v) {
 }
 
 void UserInterface::cb_None_i(Fl_Menu_*, void*) {
-  app->curSimulation.logLevel = LOG_NONE;
-app->curSimulation.setSimulationWindowFrom();
+  SetSimulationLogLevel(&app->curSimulation, LOG_NONE);
 }
 void UserInterface::cb_None(Fl_Menu_* o, void* v) {
   ((UserInterface*)(o->parent()->user_data()))->cb_None_i(o,v);
 }
 
 void UserInterface::cb_Summary_i(Fl_Menu_*, void*) {
-  app->curSimulation.logLevel = LOG_SUMMARY;
-app->curSimulation.setSimulationWindowFrom();
+  SetSimulationLogLevel(&app->curSimulation, LOG_SUMMARY);
 }
 void UserInterface::cb_Summary(Fl_Menu_* o, void* v) {
   ((UserInterface*)(o->parent()->user_data()))->cb_Summary_i(o,v);
 }
 
 void UserInterface::cb_Standard_i(Fl_Menu_*, void*) {
-  app->curSimulation.logLevel = LOG_STANDARD;
-app->curSimulation.setSimulationWindowFrom();
+  SetSimulationLogLevel(&app->curSimulation, LOG_STANDARD);
 }
 void UserInterface::cb_Standard(Fl_Menu_* o, void* v) {
   ((UserInterface*)(o->parent()->user_data()))->cb_Standard_i(o,v);
 }
 
 void UserInterface::cb_Detailed_i(Fl_Menu_*, void*) {
-  app->curSimulation.logLevel = LOG_DETAILED;
-app->curSimulation.setSimulationWindowFrom();
+  SetSimulationLogLevel(&app->curSimulation, LOG_DETAILED);
 }
 void UserInterface::cb_Detailed(Fl_Menu_* o, void* v) {
   ((UserInterface*)(o->parent()->user_data()))->cb_Detailed_i(o,v);
@@ -651,8 +671,8 @@ void UserInterface::cb_Cancel(Fl_Button* o, void* v) {
 }
 
 void UserInterface::cb_simulationWindow3_i(Fl_Button*, void*) {
-  if(Fl::has_idle(RunSimulation, app->getCurSimulation())) {
-	Fl::remove_idle(RunSimulation, app->getCurSimulation());
+  if(SimulationRunning(app->getCurSimulation())) {
+	PauseSimulation(app->getCurSimulation());
 	simulationWindow->buttonPause->deactivate();
 	simulationWindow->buttonRun->activate();
 	simulationWindow->buttonStep->activate();
@@ -1718,6 +1738,99 @@ void UserInterface::cb_batchSimulationWindow30(Fl_Value_Input* o, void* v) {
   ((UserInterface*)(o->parent()->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow30_i(o,v);
 }
 
+void UserInterface::cb_batchSimulationWindow43_i(Fl_Check_Button* o, void*) {
+  if(o->value()) batchSimulationWindow->bs.sim.beliefEngine = BELIEF_ENGINE_LOG_ODDS;
+else batchSimulationWindow->bs.sim.beliefEngine = BELIEF_ENGINE_AMOUNT;
+}
+void UserInterface::cb_batchSimulationWindow43(Fl_Check_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow43_i(o,v);
+}
+
+void UserInterface::cb_batchSimulationWindow44_i(Fl_Check_Button* o, void*) {
+  if(o->value()) batchSimulationWindow->bs.sim.eventSampling = EVENT_SAMPLING_SKIP;
+else batchSimulationWindow->bs.sim.eventSampling = EVENT_SAMPLING_EVERY_STEP;
+batchSimulationWindow->configureEValues();
+}
+void UserInterface::cb_batchSimulationWindow44(Fl_Check_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow44_i(o,v);
+}
+
+void UserInterface::cb_batchSimulationWindow45_i(Fl_Check_Button* o, void*) {
+  if(o->value()) batchSimulationWindow->bs.sim.timing = TIMING_CONTINUOUS;
+else batchSimulationWindow->bs.sim.timing = TIMING_SYNCHRONOUS;
+batchSimulationWindow->configureEValues();
+}
+void UserInterface::cb_batchSimulationWindow45(Fl_Check_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow45_i(o,v);
+}
+
+void UserInterface::cb_batchSimulationWindow4e_i(Fl_Check_Button* o, void*) {
+  if(o->value()) batchSimulationWindow->bs.sim.stepEngine = STEP_ENGINE_BLOCKS;
+else batchSimulationWindow->bs.sim.stepEngine = STEP_ENGINE_SERIAL;
+}
+void UserInterface::cb_batchSimulationWindow4e(Fl_Check_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow4e_i(o,v);
+}
+
+void UserInterface::cb_batchSimulationWindow46_i(Fl_Choice* o, void*) {
+  batchSimulationWindow->bs.sim.randomGenerator = o->value();
+}
+void UserInterface::cb_batchSimulationWindow46(Fl_Choice* o, void* v) {
+  ((UserInterface*)(o->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow46_i(o,v);
+}
+
+Fl_Menu_Item UserInterface::menu_batchSimulationWindow2[] = {
+ {"GSL taus", 0,  0, 0, 0, (uchar)FL_NORMAL_LABEL, 2, 14, 0},
+ {"GSL MT19937", 0,  0, 0, 0, (uchar)FL_NORMAL_LABEL, 2, 14, 0},
+ {"xoshiro256++", 0,  0, 0, 0, (uchar)FL_NORMAL_LABEL, 2, 14, 0},
+ {"PCG64", 0,  0, 0, 0, (uchar)FL_NORMAL_LABEL, 2, 14, 0},
+ {"Philox4x32", 0,  0, 0, 0, (uchar)FL_NORMAL_LABEL, 2, 14, 0},
+ {0,0,0,0,0,0,0,0,0}
+};
+
+void UserInterface::cb_batchSimulationWindow47_i(Fl_Check_Button* o, void*) {
+  batchSimulationWindow->bs.adaptive = o->value();
+batchSimulationWindow->configureTrials();
+}
+void UserInterface::cb_batchSimulationWindow47(Fl_Check_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow47_i(o,v);
+}
+
+void UserInterface::cb_batchSimulationWindow48_i(Fl_Value_Input* o, void*) {
+  batchSimulationWindow->bs.minTrials = o->value();
+}
+void UserInterface::cb_batchSimulationWindow48(Fl_Value_Input* o, void* v) {
+  ((UserInterface*)(o->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow48_i(o,v);
+}
+
+void UserInterface::cb_batchSimulationWindow49_i(Fl_Value_Input* o, void*) {
+  batchSimulationWindow->bs.targetMargin = o->value();
+}
+void UserInterface::cb_batchSimulationWindow49(Fl_Value_Input* o, void* v) {
+  ((UserInterface*)(o->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow49_i(o,v);
+}
+
+void UserInterface::cb_batchSimulationWindow4a_i(Fl_Value_Input* o, void*) {
+  batchSimulationWindow->bs.confidenceLevel = o->value() / 100.0;
+}
+void UserInterface::cb_batchSimulationWindow4a(Fl_Value_Input* o, void* v) {
+  ((UserInterface*)(o->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow4a_i(o,v);
+}
+
+void UserInterface::cb_batchSimulationWindow4b_i(Fl_Check_Button* o, void*) {
+  batchSimulationWindow->bs.adaptivePolarisation = o->value();
+}
+void UserInterface::cb_batchSimulationWindow4b(Fl_Check_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow4b_i(o,v);
+}
+
+void UserInterface::cb_batchSimulationWindow4c_i(Fl_Check_Button* o, void*) {
+  batchSimulationWindow->bs.checkpoint = o->value();
+}
+void UserInterface::cb_batchSimulationWindow4c(Fl_Check_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow4c_i(o,v);
+}
+
 void UserInterface::cb_batchSimulationWindow31_i(Fl_Check_Button* o, void*) {
   batchSimulationWindow->bs.stats.recordEValueStats = o->value();
 if(o->value()) {
@@ -1752,6 +1865,13 @@ void UserInterface::cb_batchSimulationWindow33(Fl_Value_Input* o, void* v) {
   ((UserInterface*)(o->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow33_i(o,v);
 }
 
+void UserInterface::cb_batchSimulationWindow4d_i(Fl_Button*, void*) {
+  batchSimulationWindow->showEstimate();
+}
+void UserInterface::cb_batchSimulationWindow4d(Fl_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->parent()->parent()->user_data()))->cb_batchSimulationWindow4d_i(o,v);
+}
+
 void UserInterface::cb_batchSimulationWindow34_i(Fl_Check_Button* o, void*) {
   batchSimulationWindow->bs.stats.recordTopologies = o->value();
 if(o->value()) {
@@ -1977,6 +2097,20 @@ void UserInterface::cb_statisticsWindow2(Fl_Button* o, void* v) {
   ((UserInterface*)(o->parent()->user_data()))->cb_statisticsWindow2_i(o,v);
 }
 
+void UserInterface::cb_statisticsWindow3_i(Fl_Button*, void*) {
+  statisticsWindow->replayTrial();
+}
+void UserInterface::cb_statisticsWindow3(Fl_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->user_data()))->cb_statisticsWindow3_i(o,v);
+}
+
+void UserInterface::cb_statisticsWindow4_i(Fl_Button*, void*) {
+  statisticsWindow->showProfile();
+}
+void UserInterface::cb_statisticsWindow4(Fl_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->user_data()))->cb_statisticsWindow4_i(o,v);
+}
+
 void UserInterface::cb_aboutWindow_i(Fl_Button*, void*) {
   aboutWindow->closeDialog(true);
 }
@@ -2379,6 +2513,49 @@ void UserInterface::cb_10(Fl_Button* o, void* v) {
   ((UserInterface*)(o->parent()->user_data()))->cb_10_i(o,v);
 }
 
+void UserInterface::cb_multiBatchWindow11_i(Fl_Check_Button* o, void*) {
+  multiBatchWindow->mb.refine = o->value();
+multiBatchWindow->configure();
+}
+void UserInterface::cb_multiBatchWindow11(Fl_Check_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->user_data()))->cb_multiBatchWindow11_i(o,v);
+}
+
+void UserInterface::cb_multiBatchWindow12_i(Fl_Value_Input* o, void*) {
+  multiBatchWindow->mb.refineThreshold = o->value();
+}
+void UserInterface::cb_multiBatchWindow12(Fl_Value_Input* o, void* v) {
+  ((UserInterface*)(o->parent()->user_data()))->cb_multiBatchWindow12_i(o,v);
+}
+
+void UserInterface::cb_multiBatchWindow13_i(Fl_Spinner* o, void*) {
+  multiBatchWindow->mb.refineBudget = o->value();
+}
+void UserInterface::cb_multiBatchWindow13(Fl_Spinner* o, void* v) {
+  ((UserInterface*)(o->parent()->user_data()))->cb_multiBatchWindow13_i(o,v);
+}
+
+void UserInterface::cb_multiBatchWindow14_i(Fl_Check_Button* o, void*) {
+  multiBatchWindow->mb.commonRandomNumbers = o->value();
+}
+void UserInterface::cb_multiBatchWindow14(Fl_Check_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->user_data()))->cb_multiBatchWindow14_i(o,v);
+}
+
+void UserInterface::cb_multiBatchWindow15_i(Fl_Check_Button* o, void*) {
+  multiBatchWindow->mb.antithetic = o->value();
+}
+void UserInterface::cb_multiBatchWindow15(Fl_Check_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->user_data()))->cb_multiBatchWindow15_i(o,v);
+}
+
+void UserInterface::cb_multiBatchWindow16_i(Fl_Button*, void*) {
+  multiBatchWindow->showEstimate();
+}
+void UserInterface::cb_multiBatchWindow16(Fl_Button* o, void* v) {
+  ((UserInterface*)(o->parent()->user_data()))->cb_multiBatchWindow16_i(o,v);
+}
+
 void UserInterface::cb_Cancela_i(Fl_Button*, void*) {
   doubleProgressWindow->closeDialog(false);
 }
@@ -4569,8 +4746,104 @@ mation");
           } // Fl_Value_Input* batchSimulationWindow->inputExponent
           o->end();
         } // Fl_Group* o
+        { batchSimulationWindow->buttonLogOdds = new Fl_Check_Button(75, 283, 20, 20, "Log-odds beliefs");
+          batchSimulationWindow->buttonLogOdds->tooltip("Combine evidence by adding log-odds, which keeps beliefs very close to 0 or 1 apart");
+          batchSimulationWindow->buttonLogOdds->down_box(FL_DOWN_BOX);
+          batchSimulationWindow->buttonLogOdds->labeltype(FL_ENGRAVED_LABEL);
+          batchSimulationWindow->buttonLogOdds->labelfont(2);
+          batchSimulationWindow->buttonLogOdds->callback((Fl_Callback*)cb_batchSimulationWindow43);
+          batchSimulationWindow->buttonLogOdds->align(Fl_Align(FL_ALIGN_RIGHT));
+        } // Fl_Check_Button* batchSimulationWindow->buttonLogOdds
+        { batchSimulationWindow->buttonSkipSampling = new Fl_Check_Button(210, 283, 20, 20, "Skip-sample events");
+          batchSimulationWindow->buttonSkipSampling->tooltip("Draw the time until each inquirer or link is next used, instead of rolling for all of them at every step. Faster when inquiry and listen chances are small.");
+          batchSimulationWindow->buttonSkipSampling->down_box(FL_DOWN_BOX);
+          batchSimulationWindow->buttonSkipSampling->labeltype(FL_ENGRAVED_LABEL);
+          batchSimulationWindow->buttonSkipSampling->labelfont(2);
+          batchSimulationWindow->buttonSkipSampling->callback((Fl_Callback*)cb_batchSimulationWindow44);
+          batchSimulationWindow->buttonSkipSampling->align(Fl_Align(FL_ALIGN_RIGHT));
+        } // Fl_Check_Button* batchSimulationWindow->buttonSkipSampling
+        { batchSimulationWindow->buttonContinuousTime = new Fl_Check_Button(360, 283, 20, 20, "Continuous time");
+          batchSimulationWindow->buttonContinuousTime->tooltip("Let inquiry results and messages arrive one at a time and take effect at once, rather than everyone updating together at each step");
+          batchSimulationWindow->buttonContinuousTime->down_box(FL_DOWN_BOX);
+          batchSimulationWindow->buttonContinuousTime->labeltype(FL_ENGRAVED_LABEL);
+          batchSimulationWindow->buttonContinuousTime->labelfont(2);
+          batchSimulationWindow->buttonContinuousTime->callback((Fl_Callback*)cb_batchSimulationWindow45);
+          batchSimulationWindow->buttonContinuousTime->align(Fl_Align(FL_ALIGN_RIGHT));
+        } // Fl_Check_Button* batchSimulationWindow->buttonContinuousTime
+        { batchSimulationWindow->buttonBlockSteps = new Fl_Check_Button(395, 59, 20, 20, "Block steps");
+          batchSimulationWindow->buttonBlockSteps->tooltip("Take each step in blocks of inquirers, on several threads for large societies. News then always reaches listeners a step later, so results differ from the usual steps.");
+          batchSimulationWindow->buttonBlockSteps->down_box(FL_DOWN_BOX);
+          batchSimulationWindow->buttonBlockSteps->labeltype(FL_ENGRAVED_LABEL);
+          batchSimulationWindow->buttonBlockSteps->labelfont(2);
+          batchSimulationWindow->buttonBlockSteps->callback((Fl_Callback*)cb_batchSimulationWindow4e);
+          batchSimulationWindow->buttonBlockSteps->align(Fl_Align(FL_ALIGN_RIGHT));
+        } // Fl_Check_Button* batchSimulationWindow->buttonBlockSteps
+        { batchSimulationWindow->choiceRandomGenerator = new Fl_Choice(250, 57, 130, 22, "Random numbers:");
+          batchSimulationWindow->choiceRandomGenerator->tooltip("Which random number generator to use. The GSL generators give the same results as earlier versions, the others are faster.");
+          batchSimulationWindow->choiceRandomGenerator->down_box(FL_BORDER_BOX);
+          batchSimulationWindow->choiceRandomGenerator->labeltype(FL_ENGRAVED_LABEL);
+          batchSimulationWindow->choiceRandomGenerator->labelfont(2);
+          batchSimulationWindow->choiceRandomGenerator->callback((Fl_Callback*)cb_batchSimulationWindow46);
+          batchSimulationWindow->choiceRandomGenerator->menu(menu_batchSimulationWindow2);
+        } // Fl_Choice* batchSimulationWindow->choiceRandomGenerator
         batchSimulationWindow->groupEValues->end();
       } // Fl_Group* batchSimulationWindow->groupEValues
+      { batchSimulationWindow->groupTrials = new Fl_Group(65, 45, 440, 265, "Trials");
+        batchSimulationWindow->groupTrials->labeltype(FL_ENGRAVED_LABEL);
+        batchSimulationWindow->groupTrials->labelfont(2);
+        batchSimulationWindow->groupTrials->hide();
+        { batchSimulationWindow->buttonAdaptiveTrials = new Fl_Check_Button(90, 65, 300, 20, "Stop when results are precise enough");
+          batchSimulationWindow->buttonAdaptiveTrials->tooltip("Run trials in blocks until the margin of error of the average e-value is small enough. The number of trials is then the most that are run.");
+          batchSimulationWindow->buttonAdaptiveTrials->down_box(FL_DOWN_BOX);
+          batchSimulationWindow->buttonAdaptiveTrials->labeltype(FL_ENGRAVED_LABEL);
+          batchSimulationWindow->buttonAdaptiveTrials->labelfont(2);
+          batchSimulationWindow->buttonAdaptiveTrials->callback((Fl_Callback*)cb_batchSimulationWindow47);
+        } // Fl_Check_Button* batchSimulationWindow->buttonAdaptiveTrials
+        { batchSimulationWindow->inputMinTrials = new Fl_Value_Input(250, 100, 80, 24, "Minimum trials");
+          batchSimulationWindow->inputMinTrials->tooltip("Least number of trials to run");
+          batchSimulationWindow->inputMinTrials->labeltype(FL_ENGRAVED_LABEL);
+          batchSimulationWindow->inputMinTrials->labelfont(2);
+          batchSimulationWindow->inputMinTrials->minimum(2);
+          batchSimulationWindow->inputMinTrials->maximum(1e+06);
+          batchSimulationWindow->inputMinTrials->step(1);
+          batchSimulationWindow->inputMinTrials->value(100);
+          batchSimulationWindow->inputMinTrials->callback((Fl_Callback*)cb_batchSimulationWindow48);
+        } // Fl_Value_Input* batchSimulationWindow->inputMinTrials
+        { batchSimulationWindow->inputTargetMargin = new Fl_Value_Input(250, 134, 80, 24, "Margin of error");
+          batchSimulationWindow->inputTargetMargin->tooltip("Stop once the average e-value is known to within this much");
+          batchSimulationWindow->inputTargetMargin->labeltype(FL_ENGRAVED_LABEL);
+          batchSimulationWindow->inputTargetMargin->labelfont(2);
+          batchSimulationWindow->inputTargetMargin->maximum(1000);
+          batchSimulationWindow->inputTargetMargin->step(0.0001);
+          batchSimulationWindow->inputTargetMargin->value(0.01);
+          batchSimulationWindow->inputTargetMargin->callback((Fl_Callback*)cb_batchSimulationWindow49);
+        } // Fl_Value_Input* batchSimulationWindow->inputTargetMargin
+        { batchSimulationWindow->inputConfidenceLevel = new Fl_Value_Input(250, 168, 80, 24, "Confidence level %");
+          batchSimulationWindow->inputConfidenceLevel->tooltip("Confidence level of the margin of error");
+          batchSimulationWindow->inputConfidenceLevel->labeltype(FL_ENGRAVED_LABEL);
+          batchSimulationWindow->inputConfidenceLevel->labelfont(2);
+          batchSimulationWindow->inputConfidenceLevel->minimum(50);
+          batchSimulationWindow->inputConfidenceLevel->maximum(99.99);
+          batchSimulationWindow->inputConfidenceLevel->step(0.01);
+          batchSimulationWindow->inputConfidenceLevel->value(95);
+          batchSimulationWindow->inputConfidenceLevel->callback((Fl_Callback*)cb_batchSimulationWindow4a);
+        } // Fl_Value_Input* batchSimulationWindow->inputConfidenceLevel
+        { batchSimulationWindow->buttonAdaptivePolarisation = new Fl_Check_Button(90, 202, 300, 20, "Polarisation must be as precise");
+          batchSimulationWindow->buttonAdaptivePolarisation->tooltip("Also run until the margin of error of the average polarisation is small enough");
+          batchSimulationWindow->buttonAdaptivePolarisation->down_box(FL_DOWN_BOX);
+          batchSimulationWindow->buttonAdaptivePolarisation->labeltype(FL_ENGRAVED_LABEL);
+          batchSimulationWindow->buttonAdaptivePolarisation->labelfont(2);
+          batchSimulationWindow->buttonAdaptivePolarisation->callback((Fl_Callback*)cb_batchSimulationWindow4b);
+        } // Fl_Check_Button* batchSimulationWindow->buttonAdaptivePolarisation
+        { batchSimulationWindow->buttonCheckpoint = new Fl_Check_Button(90, 247, 300, 20, "Save checkpoints");
+          batchSimulationWindow->buttonCheckpoint->tooltip("Save progress every minute, so that the batch can be resumed if it is stopped");
+          batchSimulationWindow->buttonCheckpoint->down_box(FL_DOWN_BOX);
+          batchSimulationWindow->buttonCheckpoint->labeltype(FL_ENGRAVED_LABEL);
+          batchSimulationWindow->buttonCheckpoint->labelfont(2);
+          batchSimulationWindow->buttonCheckpoint->callback((Fl_Callback*)cb_batchSimulationWindow4c);
+        } // Fl_Check_Button* batchSimulationWindow->buttonCheckpoint
+        batchSimulationWindow->groupTrials->end();
+      } // Fl_Group* batchSimulationWindow->groupTrials
       { batchSimulationWindow->groupRecord = new Fl_Group(70, 45, 435, 265, "Record");
         batchSimulationWindow->groupRecord->labeltype(FL_ENGRAVED_LABEL);
         batchSimulationWindow->groupRecord->labelfont(2);
@@ -4612,6 +4885,12 @@ mation");
           batchSimulationWindow->labelEValueTimeSteps->align(Fl_Align(FL_ALIGN_LEFT|FL_ALIGN_INSIDE));
           batchSimulationWindow->labelEValueTimeSteps->deactivate();
         } // Fl_Box* batchSimulationWindow->labelEValueTimeSteps
+        { batchSimulationWindow->buttonEstimate = new Fl_Button(90, 170, 150, 25, "Estimate...");
+          batchSimulationWindow->buttonEstimate->tooltip("Work out how much memory and time the batch will take, by running a few trials");
+          batchSimulationWindow->buttonEstimate->labeltype(FL_ENGRAVED_LABEL);
+          batchSimulationWindow->buttonEstimate->labelfont(2);
+          batchSimulationWindow->buttonEstimate->callback((Fl_Callback*)cb_batchSimulationWindow4d);
+        } // Fl_Button* batchSimulationWindow->buttonEstimate
         { batchSimulationWindow->buttonRecordTopologies = new Fl_Check_Button(315, 65, 180, 20, "Record Topologies");
           batchSimulationWindow->buttonRecordTopologies->down_box(FL_DOWN_BOX);
           batchSimulationWindow->buttonRecordTopologies->labeltype(FL_ENGRAVED_LABEL);
@@ -4739,7 +5018,7 @@ mation");
     batchSimulationWindow->clear_border();
     batchSimulationWindow->end();
   } // BatchSimulationWindow* batchSimulationWindow
-  { progressWindow = new ProgressWindow(747, 40, "Progress");
+  { progressWindow = new ProgressWindow(747, 60, "Progress");
     progressWindow->box(FL_UP_BOX);
     progressWindow->color(FL_BACKGROUND_COLOR);
     progressWindow->selection_color(FL_BACKGROUND_COLOR);
@@ -4762,6 +5041,11 @@ mation");
       o->labelfont(1);
       o->callback((Fl_Callback*)cb_Cancel4);
     } // Fl_Button* o
+    { progressWindow->boxThroughput = new Fl_Box(10, 35, 725, 18);
+      progressWindow->boxThroughput->tooltip("Simulated steps of inquirers and links per second, trials per second, time left and memory in use");
+      progressWindow->boxThroughput->labelsize(12);
+      progressWindow->boxThroughput->align(Fl_Align(FL_ALIGN_LEFT|FL_ALIGN_INSIDE));
+    } // Fl_Box* progressWindow->boxThroughput
     progressWindow->set_modal();
     progressWindow->clear_border();
     progressWindow->end();
@@ -4831,6 +5115,11 @@ mation");
       statisticsWindow->outputNumSteps->labeltype(FL_ENGRAVED_LABEL);
       statisticsWindow->outputNumSteps->labelfont(2);
     } // Fl_Output* statisticsWindow->outputNumSteps
+    { statisticsWindow->outputSeed = new Fl_Output(545, 425, 100, 20, "Seed");
+      statisticsWindow->outputSeed->tooltip("Seed of the trials\' random numbers - running with the same seed gives the same results");
+      statisticsWindow->outputSeed->labeltype(FL_ENGRAVED_LABEL);
+      statisticsWindow->outputSeed->labelfont(2);
+    } // Fl_Output* statisticsWindow->outputSeed
     { statisticsWindow->boxDiagramYValue[2] = new Fl_Box(-15, 132, 55, 20, "0");
       statisticsWindow->boxDiagramYValue[2]->align(Fl_Align(FL_ALIGN_RIGHT|FL_ALIGN_INSIDE));
     } // Fl_Box* statisticsWindow->boxDiagramYValue[2]
@@ -4988,6 +5277,18 @@ ld have been using only inquiry, in such cases");
       statisticsWindow->buttonExportEValues->labelfont(1);
       statisticsWindow->buttonExportEValues->callback((Fl_Callback*)cb_statisticsWindow2);
     } // Fl_Button* statisticsWindow->buttonExportEValues
+    { statisticsWindow->buttonReplayTrial = new Fl_Button(495, 455, 150, 30, "Replay Trial...");
+      statisticsWindow->buttonReplayTrial->tooltip("Run one trial again in the main window, step by step with a detailed log");
+      statisticsWindow->buttonReplayTrial->labeltype(FL_ENGRAVED_LABEL);
+      statisticsWindow->buttonReplayTrial->labelfont(1);
+      statisticsWindow->buttonReplayTrial->callback((Fl_Callback*)cb_statisticsWindow3);
+    } // Fl_Button* statisticsWindow->buttonReplayTrial
+    { statisticsWindow->buttonProfile = new Fl_Button(495, 415, 150, 30, "Profile...");
+      statisticsWindow->buttonProfile->tooltip("Show how long each phase of the batch simulation took");
+      statisticsWindow->buttonProfile->labeltype(FL_ENGRAVED_LABEL);
+      statisticsWindow->buttonProfile->labelfont(1);
+      statisticsWindow->buttonProfile->callback((Fl_Callback*)cb_statisticsWindow4);
+    } // Fl_Button* statisticsWindow->buttonProfile
     { Fl_Box* o = new Fl_Box(25, 499, 635, 2);
       o->box(FL_THIN_DOWN_BOX);
     } // Fl_Box* o
@@ -5660,7 +5961,7 @@ ulation\'s parameters. Constant: never vary.");
     setValuesWindow->clear_border();
     setValuesWindow->end();
   } // SetValuesWindow* setValuesWindow
-  { multiBatchWindow = new MultiBatchWindow(441, 254, "Multibatch Simulation");
+  { multiBatchWindow = new MultiBatchWindow(441, 354, "Multibatch Simulation");
     multiBatchWindow->box(FL_UP_BOX);
     multiBatchWindow->color(FL_BACKGROUND_COLOR);
     multiBatchWindow->selection_color(FL_BACKGROUND_COLOR);
@@ -5671,13 +5972,13 @@ ulation\'s parameters. Constant: never vary.");
     multiBatchWindow->user_data((void*)(this));
     multiBatchWindow->align(Fl_Align(FL_ALIGN_CLIP|FL_ALIGN_INSIDE));
     multiBatchWindow->when(FL_WHEN_RELEASE);
-    { Fl_Return_Button* o = new Fl_Return_Button(355, 211, 70, 25, "OK");
+    { Fl_Return_Button* o = new Fl_Return_Button(355, 311, 70, 25, "OK");
       o->tooltip("Run multibatch simulation");
       o->labeltype(FL_ENGRAVED_LABEL);
       o->labelfont(1);
       o->callback((Fl_Callback*)cb_OK7);
     } // Fl_Return_Button* o
-    { Fl_Button* o = new Fl_Button(280, 211, 70, 25, "Cancel");
+    { Fl_Button* o = new Fl_Button(280, 311, 70, 25, "Cancel");
       o->tooltip("Exit without starting simulation");
       o->labeltype(FL_ENGRAVED_LABEL);
       o->labelfont(1);
@@ -5790,19 +6091,19 @@ ulation\'s parameters. Constant: never vary.");
       } // Fl_Box* o
       o->end();
     } // Fl_Group* o
-    { multiBatchWindow->btnPreview = new Fl_Button(20, 211, 85, 25, "Preview...");
+    { multiBatchWindow->btnPreview = new Fl_Button(20, 311, 85, 25, "Preview...");
       multiBatchWindow->btnPreview->tooltip("Show how the batch simulation X, Y will look");
       multiBatchWindow->btnPreview->labeltype(FL_ENGRAVED_LABEL);
       multiBatchWindow->btnPreview->labelfont(1);
       multiBatchWindow->btnPreview->callback((Fl_Callback*)cb_multiBatchWindow10);
     } // Fl_Button* multiBatchWindow->btnPreview
-    { Fl_Button* o = new Fl_Button(120, 211, 70, 25, "Load...");
+    { Fl_Button* o = new Fl_Button(120, 311, 70, 25, "Load...");
       o->tooltip("Exit without starting simulation");
       o->labeltype(FL_ENGRAVED_LABEL);
       o->labelfont(1);
       o->callback((Fl_Callback*)cb_Load);
     } // Fl_Button* o
-    { Fl_Button* o = new Fl_Button(195, 211, 70, 25, "Save...");
+    { Fl_Button* o = new Fl_Button(195, 311, 70, 25, "Save...");
       o->tooltip("Exit without starting simulation");
       o->labeltype(FL_ENGRAVED_LABEL);
       o->labelfont(1);
@@ -5813,11 +6114,56 @@ ulation\'s parameters. Constant: never vary.");
       o->labelfont(1);
       o->callback((Fl_Callback*)cb_10);
     } // Fl_Button* o
+    { multiBatchWindow->btnRefine = new Fl_Check_Button(20, 206, 150, 24, "Refine where steep");
+      multiBatchWindow->btnRefine->tooltip("After running the grid, add points in cells where the e-value or polarisation changes more than the threshold between corners");
+      multiBatchWindow->btnRefine->down_box(FL_DOWN_BOX);
+      multiBatchWindow->btnRefine->labeltype(FL_ENGRAVED_LABEL);
+      multiBatchWindow->btnRefine->labelfont(2);
+      multiBatchWindow->btnRefine->callback((Fl_Callback*)cb_multiBatchWindow11);
+    } // Fl_Check_Button* multiBatchWindow->btnRefine
+    { multiBatchWindow->inputRefineThreshold = new Fl_Value_Input(245, 206, 50, 24, "Threshold");
+      multiBatchWindow->inputRefineThreshold->tooltip("Least difference in e-value or polarisation between the corners of a cell for it to be split");
+      multiBatchWindow->inputRefineThreshold->labeltype(FL_ENGRAVED_LABEL);
+      multiBatchWindow->inputRefineThreshold->labelfont(2);
+      multiBatchWindow->inputRefineThreshold->maximum(1);
+      multiBatchWindow->inputRefineThreshold->step(0.001);
+      multiBatchWindow->inputRefineThreshold->value(0.05);
+      multiBatchWindow->inputRefineThreshold->callback((Fl_Callback*)cb_multiBatchWindow12);
+    } // Fl_Value_Input* multiBatchWindow->inputRefineThreshold
+    { multiBatchWindow->inputRefineBudget = new Fl_Spinner(375, 206, 50, 24, "Extra points");
+      multiBatchWindow->inputRefineBudget->tooltip("Most points to add to the grid");
+      multiBatchWindow->inputRefineBudget->labeltype(FL_ENGRAVED_LABEL);
+      multiBatchWindow->inputRefineBudget->labelfont(2);
+      multiBatchWindow->inputRefineBudget->minimum(1);
+      multiBatchWindow->inputRefineBudget->maximum(100000);
+      multiBatchWindow->inputRefineBudget->value(100);
+      multiBatchWindow->inputRefineBudget->callback((Fl_Callback*)cb_multiBatchWindow13);
+    } // Fl_Spinner* multiBatchWindow->inputRefineBudget
+    { multiBatchWindow->btnCommonRandomNumbers = new Fl_Check_Button(20, 236, 190, 24, "Common random numbers");
+      multiBatchWindow->btnCommonRandomNumbers->tooltip("Run trial i of every point with the same random numbers, so that differences between points are not swamped by chance");
+      multiBatchWindow->btnCommonRandomNumbers->down_box(FL_DOWN_BOX);
+      multiBatchWindow->btnCommonRandomNumbers->labeltype(FL_ENGRAVED_LABEL);
+      multiBatchWindow->btnCommonRandomNumbers->labelfont(2);
+      multiBatchWindow->btnCommonRandomNumbers->callback((Fl_Callback*)cb_multiBatchWindow14);
+    } // Fl_Check_Button* multiBatchWindow->btnCommonRandomNumbers
+    { multiBatchWindow->btnAntithetic = new Fl_Check_Button(245, 236, 150, 24, "Antithetic pairs");
+      multiBatchWindow->btnAntithetic->tooltip("Run every second trial with the random numbers of the one before turned around");
+      multiBatchWindow->btnAntithetic->down_box(FL_DOWN_BOX);
+      multiBatchWindow->btnAntithetic->labeltype(FL_ENGRAVED_LABEL);
+      multiBatchWindow->btnAntithetic->labelfont(2);
+      multiBatchWindow->btnAntithetic->callback((Fl_Callback*)cb_multiBatchWindow15);
+    } // Fl_Check_Button* multiBatchWindow->btnAntithetic
+    { multiBatchWindow->btnEstimate = new Fl_Button(20, 271, 85, 25, "Estimate...");
+      multiBatchWindow->btnEstimate->tooltip("Work out how much memory and time the multibatch will take, by running a few trials at its corners");
+      multiBatchWindow->btnEstimate->labeltype(FL_ENGRAVED_LABEL);
+      multiBatchWindow->btnEstimate->labelfont(1);
+      multiBatchWindow->btnEstimate->callback((Fl_Callback*)cb_multiBatchWindow16);
+    } // Fl_Button* multiBatchWindow->btnEstimate
     multiBatchWindow->set_modal();
     multiBatchWindow->clear_border();
     multiBatchWindow->end();
   } // MultiBatchWindow* multiBatchWindow
-  { doubleProgressWindow = new DoubleProgressWindow(747, 40, "Progress");
+  { doubleProgressWindow = new DoubleProgressWindow(747, 60, "Progress");
     doubleProgressWindow->box(FL_UP_BOX);
     doubleProgressWindow->color(FL_BACKGROUND_COLOR);
     doubleProgressWindow->selection_color(FL_BACKGROUND_COLOR);
@@ -5842,6 +6188,11 @@ ulation\'s parameters. Constant: never vary.");
     } // Fl_Button* o
     { doubleProgressWindow->outputSecondProgress = new Fl_Output(15, 11, 80, 18);
     } // Fl_Output* doubleProgressWindow->outputSecondProgress
+    { doubleProgressWindow->boxThroughput = new Fl_Box(15, 35, 720, 18);
+      doubleProgressWindow->boxThroughput->tooltip("Simulated steps of inquirers and links per second, trials per second, time left and memory in use");
+      doubleProgressWindow->boxThroughput->labelsize(12);
+      doubleProgressWindow->boxThroughput->align(Fl_Align(FL_ALIGN_LEFT|FL_ALIGN_INSIDE));
+    } // Fl_Box* doubleProgressWindow->boxThroughput
     doubleProgressWindow->set_modal();
     doubleProgressWindow->clear_border();
     doubleProgressWindow->end();
@@ -68,6 +68,12 @@ private:
   static void cb_Batch(Fl_Menu_*, void*);
   inline void cb_Multibatch_i(Fl_Menu_*, void*);
   static void cb_Multibatch(Fl_Menu_*, void*);
+  inline void cb_Sweep_i(Fl_Menu_*, void*);
+  static void cb_Sweep(Fl_Menu_*, void*);
+  inline void cb_Shard_i(Fl_Menu_*, void*);
+  static void cb_Shard(Fl_Menu_*, void*);
+  inline void cb_Resume_i(Fl_Menu_*, void*);
+  static void cb_Resume(Fl_Menu_*, void*);
   inline void cb_Generate_i(Fl_Menu_*, void*);
   static void cb_Generate(Fl_Menu_*, void*);
   inline void cb_Randomise_i(Fl_Menu_*, void*);
@@ -469,12 +475,37 @@ private:
   static void cb_batchSimulationWindow2f(Fl_Value_Input*, void*);
   inline void cb_batchSimulationWindow30_i(Fl_Value_Input*, void*);
   static void cb_batchSimulationWindow30(Fl_Value_Input*, void*);
+  inline void cb_batchSimulationWindow43_i(Fl_Check_Button*, void*);
+  static void cb_batchSimulationWindow43(Fl_Check_Button*, void*);
+  inline void cb_batchSimulationWindow44_i(Fl_Check_Button*, void*);
+  static void cb_batchSimulationWindow44(Fl_Check_Button*, void*);
+  inline void cb_batchSimulationWindow45_i(Fl_Check_Button*, void*);
+  static void cb_batchSimulationWindow45(Fl_Check_Button*, void*);
+  inline void cb_batchSimulationWindow4e_i(Fl_Check_Button*, void*);
+  static void cb_batchSimulationWindow4e(Fl_Check_Button*, void*);
+  inline void cb_batchSimulationWindow46_i(Fl_Choice*, void*);
+  static void cb_batchSimulationWindow46(Fl_Choice*, void*);
+  static Fl_Menu_Item menu_batchSimulationWindow2[];
+  inline void cb_batchSimulationWindow47_i(Fl_Check_Button*, void*);
+  static void cb_batchSimulationWindow47(Fl_Check_Button*, void*);
+  inline void cb_batchSimulationWindow48_i(Fl_Value_Input*, void*);
+  static void cb_batchSimulationWindow48(Fl_Value_Input*, void*);
+  inline void cb_batchSimulationWindow49_i(Fl_Value_Input*, void*);
+  static void cb_batchSimulationWindow49(Fl_Value_Input*, void*);
+  inline void cb_batchSimulationWindow4a_i(Fl_Value_Input*, void*);
+  static void cb_batchSimulationWindow4a(Fl_Value_Input*, void*);
+  inline void cb_batchSimulationWindow4b_i(Fl_Check_Button*, void*);
+  static void cb_batchSimulationWindow4b(Fl_Check_Button*, void*);
+  inline void cb_batchSimulationWindow4c_i(Fl_Check_Button*, void*);
+  static void cb_batchSimulationWindow4c(Fl_Check_Button*, void*);
   inline void cb_batchSimulationWindow31_i(Fl_Check_Button*, void*);
   static void cb_batchSimulationWindow31(Fl_Check_Button*, void*);
   inline void cb_batchSimulationWindow32_i(Fl_Value_Input*, void*);
   static void cb_batchSimulationWindow32(Fl_Value_Input*, void*);
   inline void cb_batchSimulationWindow33_i(Fl_Value_Input*, void*);
   static void cb_batchSimulationWindow33(Fl_Value_Input*, void*);
+  inline void cb_batchSimulationWindow4d_i(Fl_Button*, void*);
+  static void cb_batchSimulationWindow4d(Fl_Button*, void*);
   inline void cb_batchSimulationWindow34_i(Fl_Check_Button*, void*);
   static void cb_batchSimulationWindow34(Fl_Check_Button*, void*);
   inline void cb_batchSimulationWindow35_i(Fl_Value_Input*, void*);
@@ -537,6 +568,10 @@ private:
   static Fl_Menu_Item menu_statisticsWindow1[];
   inline void cb_statisticsWindow2_i(Fl_Button*, void*);
   static void cb_statisticsWindow2(Fl_Button*, void*);
+  inline void cb_statisticsWindow3_i(Fl_Button*, void*);
+  static void cb_statisticsWindow3(Fl_Button*, void*);
+  inline void cb_statisticsWindow4_i(Fl_Button*, void*);
+  static void cb_statisticsWindow4(Fl_Button*, void*);
 public:
   AboutWindow *aboutWindow;
 private:
@@ -668,6 +703,18 @@ private:
   static void cb_Save2(Fl_Button*, void*);
   inline void cb_10_i(Fl_Button*, void*);
   static void cb_10(Fl_Button*, void*);
+  inline void cb_multiBatchWindow11_i(Fl_Check_Button*, void*);
+  static void cb_multiBatchWindow11(Fl_Check_Button*, void*);
+  inline void cb_multiBatchWindow12_i(Fl_Value_Input*, void*);
+  static void cb_multiBatchWindow12(Fl_Value_Input*, void*);
+  inline void cb_multiBatchWindow13_i(Fl_Spinner*, void*);
+  static void cb_multiBatchWindow13(Fl_Spinner*, void*);
+  inline void cb_multiBatchWindow14_i(Fl_Check_Button*, void*);
+  static void cb_multiBatchWindow14(Fl_Check_Button*, void*);
+  inline void cb_multiBatchWindow15_i(Fl_Check_Button*, void*);
+  static void cb_multiBatchWindow15(Fl_Check_Button*, void*);
+  inline void cb_multiBatchWindow16_i(Fl_Button*, void*);
+  static void cb_multiBatchWindow16(Fl_Button*, void*);
 public:
   DoubleProgressWindow *doubleProgressWindow;
 private: